@@ -482,6 +482,87 @@ extern int lttng_enable_event_with_exclusions(struct lttng_handle *handle,
 		const char *filter_expression,
 		int exclusion_count, char **exclusion_names);
 
+/*
+ * A batch of events to enable in a channel with a single command to the
+ * session daemon.
+ */
+struct lttng_event_batch;
+
+/*
+ * Create an empty batch of events to enable in the channel channel_name of
+ * the session and domain of a handle.
+ *
+ * If channel_name is NULL, the default channel is used (channel0) and created
+ * if not found.
+ *
+ * Return a newly allocated batch or NULL on error.
+ */
+extern struct lttng_event_batch *lttng_event_batch_create(
+		struct lttng_handle *handle, const char *channel_name);
+
+/*
+ * Add an event to a batch. The arguments are the same as those of
+ * lttng_enable_event_with_exclusions(); the filter expression is parsed and
+ * the event is copied, the caller keeps ownership of its arguments.
+ *
+ * Userspace probe events can't be batched and must be enabled with
+ * lttng_enable_event_with_exclusions().
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+extern int lttng_event_batch_add(struct lttng_event_batch *batch,
+		struct lttng_event *event, const char *filter_expression,
+		int exclusion_count, char **exclusion_names);
+
+/*
+ * Add an event to a batch, as lttng_event_batch_add(), with the filter
+ * bytecode previously compiled for filter_expression by this library, as
+ * found in a saved session configuration, instead of compiling it again.
+ * The bytecode is native-endian and is not checked against the expression.
+ *
+ * Only kernel and userspace domain events can be added with their bytecode.
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+extern int lttng_event_batch_add_with_filter_bytecode(
+		struct lttng_event_batch *batch, struct lttng_event *event,
+		const char *filter_expression, const void *filter_bytecode,
+		size_t filter_bytecode_len, int exclusion_count,
+		char **exclusion_names);
+
+/*
+ * Return the number of events of a batch or a negative LTTng error code.
+ */
+extern int lttng_event_batch_get_count(const struct lttng_event_batch *batch);
+
+/*
+ * Return the name of the event at index of a batch or NULL on error.
+ */
+extern const char *lttng_event_batch_get_event_name(
+		const struct lttng_event_batch *batch, unsigned int index);
+
+/*
+ * Enable all the events of a batch, in the order they were added. The
+ * outcome of each event is available through lttng_event_batch_get_status().
+ *
+ * Return 0 if the session daemon processed the batch, else a negative LTTng
+ * error code in which case none of the events may have been enabled.
+ */
+extern int lttng_enable_event_batch(struct lttng_event_batch *batch);
+
+/*
+ * Return 0 if the event at index of a batch was enabled by
+ * lttng_enable_event_batch(), else the negative LTTng error code with which
+ * lttng_enable_event_with_exclusions() would have failed.
+ */
+extern int lttng_event_batch_get_status(const struct lttng_event_batch *batch,
+		unsigned int index);
+
+/*
+ * Destroy a batch of events.
+ */
+extern void lttng_event_batch_destroy(struct lttng_event_batch *batch);
+
 /*
  * Disable event(s) of a channel and domain.
  *
@@ -83,6 +83,31 @@ extern int lttng_session_daemon_alive(void);
  */
 extern int lttng_set_tracing_group(const char *name);
 
+/*
+ * Keep the connection to the session daemon open across the calls made to
+ * this library until lttng_persistent_connection_close() is called, instead
+ * of connecting for every call. The connection is transparently re-established
+ * if the session daemon closes it.
+ *
+ * Calls can be nested: the connection is closed when every call has been
+ * matched by a call to lttng_persistent_connection_close().
+ *
+ * As the rest of this library, the connection must not be used concurrently
+ * by many threads nor shared with a forked process.
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+extern int lttng_persistent_connection_open(void);
+
+/*
+ * Close the connection opened by lttng_persistent_connection_open(). Once the
+ * outermost open call is matched, the following calls connect to the session
+ * daemon for every call again.
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+extern int lttng_persistent_connection_close(void);
+
 /*
  * This call registers an "outside consumer" for a session and an lttng domain.
  * No consumer will be spawned and all fds/commands will go through the socket
@@ -123,6 +123,10 @@ static void rcu_free_connection(struct rcu_head *head)
 		caa_container_of(head, struct relay_connection, rcu_node);
 
 	lttcomm_destroy_sock(conn->sock);
+	if (conn->type == RELAY_VIEWER_NOTIFICATION) {
+		lttng_dynamic_buffer_reset(
+				&conn->protocol.notification.session_ids);
+	}
 	if (conn->viewer_session) {
 		viewer_session_destroy(conn->viewer_session);
 		conn->viewer_session = NULL;
@@ -136,6 +136,16 @@ struct relay_connection {
 			} state;
 			struct lttng_dynamic_buffer reception_buffer;
 		} ctrl;
+		struct {
+			/* Array of subscribed relay session IDs (uint64_t). */
+			struct lttng_dynamic_buffer session_ids;
+			/*
+			 * Set when a notification was dropped because the
+			 * viewer's socket buffer was full. An OVERFLOW
+			 * notification is owed before any other one is sent.
+			 */
+			bool overflow;
+		} notification;
 	} protocol;
 };
 
@@ -260,6 +260,45 @@ void relay_index_put(struct relay_index *index)
 	rcu_read_unlock();
 }
 
+/*
+ * Create an index file whose file descriptor is kept in the stream fd cache.
+ *
+ * Return the index file, NULL on error.
+ */
+struct lttng_index_file *relay_index_file_create(const char *path_name,
+		char *stream_name, int uid, int gid, uint64_t size,
+		uint64_t count, uint32_t major, uint32_t minor)
+{
+	struct lttng_index_file *index_file;
+
+	index_file = lttng_index_file_create(path_name, stream_name, uid, gid,
+			size, count, major, minor);
+	if (index_file) {
+		stream_fd_cache_add_index_file(index_file);
+	}
+	return index_file;
+}
+
+/*
+ * Open an index file for reading, keeping its file descriptor in the stream
+ * fd cache.
+ *
+ * Return the index file, NULL on error.
+ */
+struct lttng_index_file *relay_index_file_open(const char *path_name,
+		const char *channel_name, uint64_t tracefile_count,
+		uint64_t tracefile_count_current)
+{
+	struct lttng_index_file *index_file;
+
+	index_file = lttng_index_file_open(path_name, channel_name,
+			tracefile_count, tracefile_count_current);
+	if (index_file) {
+		stream_fd_cache_add_index_file(index_file);
+	}
+	return index_file;
+}
+
 /*
  * Try to flush index to disk. Releases self-reference to index once
  * flush succeeds.
@@ -272,7 +311,6 @@ int relay_index_try_flush(struct relay_index *index)
 {
 	int ret = 1;
 	bool flushed = false;
-	int fd;
 
 	pthread_mutex_lock(&index->lock);
 	if (index->flushed) {
@@ -282,10 +320,8 @@ int relay_index_try_flush(struct relay_index *index)
 	if (!index->has_index_data || !index->index_file) {
 		goto skip;
 	}
-	fd = index->index_file->fd;
-	DBG2("Writing index for stream ID %" PRIu64 " and seq num %" PRIu64
-			" on fd %d", index->stream->stream_handle,
-			index->index_n.key, fd);
+	DBG2("Writing index for stream ID %" PRIu64 " and seq num %" PRIu64,
+			index->stream->stream_handle, index->index_n.key);
 	flushed = true;
 	index->flushed = true;
 	ret = lttng_index_file_write(index->index_file, &index->index_data);
@@ -400,7 +436,8 @@ int relay_index_switch_all_files(struct relay_stream *stream)
 	rcu_read_lock();
 	cds_lfht_for_each_entry(stream->indexes_ht->ht, &iter.iter,
 			index, index_n.node) {
-		DBG("Update index to fd %d", stream->index_file->fd);
+		DBG("Update index of stream %" PRIu64 " to its new index file",
+				stream->stream_handle);
 		ret = relay_index_switch_file(index, stream->index_file,
 				stream->pos_after_last_complete_data_index);
 		if (ret) {
@@ -72,6 +72,13 @@ int relay_index_set_data(struct relay_index *index,
                 const struct ctf_packet_index *data);
 int relay_index_try_flush(struct relay_index *index);
 
+struct lttng_index_file *relay_index_file_create(const char *path_name,
+		char *stream_name, int uid, int gid, uint64_t size,
+		uint64_t count, uint32_t major, uint32_t minor);
+struct lttng_index_file *relay_index_file_open(const char *path_name,
+		const char *channel_name, uint64_t tracefile_count,
+		uint64_t tracefile_count_current);
+
 void relay_index_close_all(struct relay_stream *stream);
 void relay_index_close_partial_fd(struct relay_stream *stream);
 uint64_t relay_index_find_last(struct relay_stream *stream);
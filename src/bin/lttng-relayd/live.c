@@ -61,6 +61,7 @@
 #include "health-relayd.h"
 #include "testpoint.h"
 #include "viewer-stream.h"
+#include "index.h"
 #include "stream.h"
 #include "session.h"
 #include "ctf-trace.h"
@@ -72,17 +73,58 @@
 static struct lttng_uri *live_uri;
 
 /*
- * This pipe is used to inform the worker thread that a command is queued and
- * ready to be processed.
+ * Live viewer worker thread.
+ *
+ * Viewer connections are handed over by the dispatcher to one of the
+ * workers and stay bound to it for their whole lifetime. This way, a viewer
+ * performing a long read (e.g. a large packet) only delays the other
+ * connections served by the same worker.
+ */
+struct live_worker {
+	pthread_t thread;
+	/*
+	 * This pipe is used to inform the worker thread that a connection is
+	 * queued and ready to be processed.
+	 */
+	int conn_pipe[2];
+	/* Number of viewer connections owned by this worker. */
+	unsigned long connection_count;
+	/*
+	 * Non-blocking pipe on which the main worker thread posts
+	 * struct live_notification records for this worker's subscribers.
+	 */
+	int notification_pipe[2];
+	/* Number of session subscriptions held by this worker's connections. */
+	unsigned long subscription_count;
+	/* Set when a notification could not be posted because of a full pipe. */
+	int notification_overflow;
+};
+
+/*
+ * Record posted on a worker's notification pipe. Small enough for pipe
+ * writes to be atomic.
  */
-static int live_conn_pipe[2] = { -1, -1 };
+struct live_notification {
+	uint64_t session_id;
+	uint64_t stream_id;
+	enum lttng_viewer_notification_type type;
+};
+
+#define LIVE_NOTIFICATION_BATCH		64
+
+static struct live_worker *live_workers;
+static unsigned int live_worker_count;
+/*
+ * Protects the live_workers array against the notifying threads, which
+ * can outlive the live threads.
+ */
+static pthread_mutex_t live_workers_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /* Shared between threads */
 static int live_dispatch_thread_exit;
 
 static pthread_t live_listener_thread;
 static pthread_t live_dispatcher_thread;
-static pthread_t live_worker_thread;
 
 /*
  * Relay command queue.
@@ -102,9 +144,19 @@ static pthread_mutex_t last_relay_viewer_session_id_lock =
 static
 void cleanup_relayd_live(void)
 {
+	unsigned int i;
+
 	DBG("Cleaning up");
 
 	free(live_uri);
+	pthread_mutex_lock(&live_workers_lock);
+	for (i = 0; i < live_worker_count; i++) {
+		utils_close_pipe(live_workers[i].notification_pipe);
+	}
+	free(live_workers);
+	live_workers = NULL;
+	live_worker_count = 0;
+	pthread_mutex_unlock(&live_workers_lock);
 }
 
 /*
@@ -271,11 +323,16 @@ end_unlock:
  * viewer stream of the session, the number of unsent stream and the number of
  * stream created. Those counters can be NULL and thus will be ignored.
  *
+ * seek_timestamp is only used with LTTNG_VIEWER_SEEK_TIMESTAMP: the viewer
+ * streams of the session, new or existing, are positioned on the first packet
+ * ending at or after it.
+ *
  * Return 0 on success or else a negative value.
  */
 static
 int make_viewer_streams(struct relay_session *session,
-		enum lttng_viewer_seek seek_t, uint32_t *nb_total, uint32_t *nb_unsent,
+		enum lttng_viewer_seek seek_t, uint64_t seek_timestamp,
+		uint32_t *nb_total, uint32_t *nb_unsent,
 		uint32_t *nb_created, bool *closed)
 {
 	int ret;
@@ -323,7 +380,9 @@ int make_viewer_streams(struct relay_session *session,
 			}
 			vstream = viewer_stream_get_by_id(stream->stream_handle);
 			if (!vstream) {
-				vstream = viewer_stream_create(stream, seek_t);
+				vstream = viewer_stream_create(stream,
+						seek_t == LTTNG_VIEWER_SEEK_TIMESTAMP ?
+						LTTNG_VIEWER_SEEK_BEGINNING : seek_t);
 				if (!vstream) {
 					ret = -1;
 					ctf_trace_put(ctf_trace);
@@ -331,6 +390,20 @@ int make_viewer_streams(struct relay_session *session,
 					goto error_unlock;
 				}
 
+				if (seek_t == LTTNG_VIEWER_SEEK_TIMESTAMP) {
+					pthread_mutex_lock(&stream->lock);
+					ret = viewer_stream_seek_timestamp(vstream,
+							seek_timestamp);
+					pthread_mutex_unlock(&stream->lock);
+					if (ret < 0) {
+						/* Release the creation reference. */
+						viewer_stream_put(vstream);
+						ctf_trace_put(ctf_trace);
+						stream_put(stream);
+						goto error_unlock;
+					}
+				}
+
 				if (nb_created) {
 					/* Update number of created stream counter. */
 					(*nb_created)++;
@@ -344,6 +417,23 @@ int make_viewer_streams(struct relay_session *session,
 					abort();
 				}
 			} else {
+				/*
+				 * A viewer stream kept from a previous attach is
+				 * repositioned as well.
+				 */
+				if (seek_t == LTTNG_VIEWER_SEEK_TIMESTAMP) {
+					pthread_mutex_lock(&stream->lock);
+					ret = viewer_stream_seek_timestamp(vstream,
+							seek_timestamp);
+					pthread_mutex_unlock(&stream->lock);
+					if (ret < 0) {
+						/* Put local reference. */
+						viewer_stream_put(vstream);
+						ctf_trace_put(ctf_trace);
+						stream_put(stream);
+						goto error_unlock;
+					}
+				}
 				if (!vstream->sent_flag && nb_unsent) {
 					/* Update number of unsent stream counter. */
 					(*nb_unsent)++;
@@ -629,6 +719,30 @@ error_sock_control:
 	return NULL;
 }
 
+/*
+ * Pick the worker thread that will own a new viewer connection: the one
+ * currently serving the fewest connections.
+ */
+static
+struct live_worker *live_worker_select(void)
+{
+	unsigned int i;
+	struct live_worker *selected = &live_workers[0];
+	unsigned long selected_count = uatomic_read(&selected->connection_count);
+
+	for (i = 1; i < live_worker_count; i++) {
+		unsigned long count =
+				uatomic_read(&live_workers[i].connection_count);
+
+		if (count < selected_count) {
+			selected = &live_workers[i];
+			selected_count = count;
+		}
+	}
+
+	return selected;
+}
+
 /*
  * This thread manages the dispatching of the requests to worker threads
  */
@@ -661,6 +775,8 @@ void *thread_dispatcher(void *data)
 		}
 
 		do {
+			struct live_worker *worker;
+
 			health_code_update();
 
 			/* Dequeue commands */
@@ -673,8 +789,17 @@ void *thread_dispatcher(void *data)
 				break;
 			}
 			conn = caa_container_of(node, struct relay_connection, qnode);
-			DBG("Dispatching viewer request waiting on sock %d",
-					conn->sock->fd);
+			worker = live_worker_select();
+			DBG("Dispatching viewer request waiting on sock %d to worker %u",
+					conn->sock->fd,
+					(unsigned int) (worker - live_workers));
+
+			/*
+			 * Account for the connection before handing it over
+			 * so the next selection sees it even if the worker
+			 * has not picked it up yet.
+			 */
+			uatomic_inc(&worker->connection_count);
 
 			/*
 			 * Inform worker thread of the new request. This
@@ -682,9 +807,10 @@ void *thread_dispatcher(void *data)
 			 * the data will be read at some point in time
 			 * or wait to the end of the world :)
 			 */
-			ret = lttng_write(live_conn_pipe[1], &conn, sizeof(conn));
+			ret = lttng_write(worker->conn_pipe[1], &conn, sizeof(conn));
 			if (ret < 0) {
 				PERROR("write conn pipe");
+				uatomic_dec(&worker->connection_count);
 				connection_put(conn);
 				goto error;
 			}
@@ -761,6 +887,8 @@ int viewer_connect(struct relay_connection *conn)
 		conn->type = RELAY_VIEWER_COMMAND;
 	} else if (be32toh(msg.type) == LTTNG_VIEWER_CLIENT_NOTIFICATION) {
 		conn->type = RELAY_VIEWER_NOTIFICATION;
+		lttng_dynamic_buffer_init(
+				&conn->protocol.notification.session_ids);
 	} else {
 		ERR("Unknown connection type : %u", be32toh(msg.type));
 		ret = -1;
@@ -946,8 +1074,8 @@ int viewer_get_new_streams(struct relay_connection *conn)
 	send_streams = 1;
 	response.status = htobe32(LTTNG_VIEWER_NEW_STREAMS_OK);
 
-	ret = make_viewer_streams(session, LTTNG_VIEWER_SEEK_LAST, &nb_total, &nb_unsent,
-			&nb_created, &closed);
+	ret = make_viewer_streams(session, LTTNG_VIEWER_SEEK_LAST, 0, &nb_total,
+			&nb_unsent, &nb_created, &closed);
 	if (ret < 0) {
 		goto end_put_session;
 	}
@@ -1063,6 +1191,7 @@ int viewer_attach_session(struct relay_connection *conn)
 	switch (be32toh(request.seek)) {
 	case LTTNG_VIEWER_SEEK_BEGINNING:
 	case LTTNG_VIEWER_SEEK_LAST:
+	case LTTNG_VIEWER_SEEK_TIMESTAMP:
 		response.status = htobe32(LTTNG_VIEWER_ATTACH_OK);
 		seek_type = be32toh(request.seek);
 		break;
@@ -1073,8 +1202,8 @@ int viewer_attach_session(struct relay_connection *conn)
 		goto send_reply;
 	}
 
-	ret = make_viewer_streams(session, seek_type, &nb_streams, NULL,
-			NULL, &closed);
+	ret = make_viewer_streams(session, seek_type, be64toh(request.offset),
+			&nb_streams, NULL, NULL, &closed);
 	if (ret < 0) {
 		goto end_put_session;
 	}
@@ -1150,7 +1279,7 @@ static int try_open_index(struct relay_viewer_stream *vstream,
 		ret = -ENOENT;
 		goto end;
 	}
-	vstream->index_file = lttng_index_file_open(vstream->path_name,
+	vstream->index_file = relay_index_file_open(vstream->path_name,
 			vstream->channel_name,
 			vstream->stream->tracefile_count,
 			vstream->current_tracefile_id);
@@ -1399,16 +1528,43 @@ int viewer_get_next_index(struct relay_connection *conn)
 		viewer_index.flags |= LTTNG_VIEWER_FLAG_NEW_STREAM;
 	}
 
-	ret = lttng_index_file_read(vstream->index_file, &packet_index);
-	if (ret) {
-		ERR("Relay error reading index file %d",
-				vstream->index_file->fd);
-		viewer_index.status = htobe32(LTTNG_VIEWER_INDEX_ERR);
-		goto send_reply;
+	/*
+	 * Recent indexes are served from the stream's index cache. The index
+	 * file position is still advanced so that a later read from the file
+	 * (cache miss) returns the following entry.
+	 */
+	ret = stream_index_cache_get(rstream, vstream->index_sent_seqcount,
+			&packet_index);
+	if (!ret) {
+		int fd;
+		off_t lseek_ret = -1;
+
+		DBG3("Index %" PRIu64 " of stream %" PRIu64 " served from cache",
+				vstream->index_sent_seqcount,
+				rstream->stream_handle);
+		fd = lttng_index_file_get_fd(vstream->index_file);
+		if (fd >= 0) {
+			lseek_ret = lseek(fd, vstream->index_file->element_len,
+					SEEK_CUR);
+			lttng_index_file_put_fd(vstream->index_file);
+		}
+		if (lseek_ret < 0) {
+			PERROR("Relay error seeking index file of stream %" PRIu64,
+					rstream->stream_handle);
+			viewer_index.status = htobe32(LTTNG_VIEWER_INDEX_ERR);
+			goto send_reply;
+		}
 	} else {
-		viewer_index.status = htobe32(LTTNG_VIEWER_INDEX_OK);
-		vstream->index_sent_seqcount++;
+		ret = lttng_index_file_read(vstream->index_file, &packet_index);
+		if (ret) {
+			ERR("Relay error reading index file of stream %" PRIu64,
+					rstream->stream_handle);
+			viewer_index.status = htobe32(LTTNG_VIEWER_INDEX_ERR);
+			goto send_reply;
+		}
 	}
+	viewer_index.status = htobe32(LTTNG_VIEWER_INDEX_OK);
+	vstream->index_sent_seqcount++;
 
 	/*
 	 * Indexes are stored in big endian, no need to switch before sending.
@@ -1484,11 +1640,11 @@ static
 int viewer_get_packet(struct relay_connection *conn)
 {
 	int ret;
-	off_t lseek_ret;
 	char *reply = NULL;
 	struct lttng_viewer_get_packet get_packet_info;
 	struct lttng_viewer_trace_packet reply_header;
 	struct relay_viewer_stream *vstream = NULL;
+	struct stream_fd *stream_fd = NULL;
 	uint32_t reply_size = sizeof(reply_header);
 	uint32_t packet_data_len = 0;
 	ssize_t read_len;
@@ -1525,23 +1681,38 @@ int viewer_get_packet(struct relay_connection *conn)
 		goto error;
 	}
 
+	/*
+	 * Only hold the stream lock long enough to grab a reference to the
+	 * trace file. The read itself is positional and can be performed
+	 * without blocking the other viewers of this stream or the data
+	 * path of the relay stream.
+	 */
 	pthread_mutex_lock(&vstream->stream->lock);
-	lseek_ret = lseek(vstream->stream_fd->fd, be64toh(get_packet_info.offset),
-			SEEK_SET);
-	if (lseek_ret < 0) {
-		PERROR("lseek fd %d to offset %" PRIu64, vstream->stream_fd->fd,
-			(uint64_t) be64toh(get_packet_info.offset));
+	stream_fd = vstream->stream_fd;
+	if (stream_fd) {
+		stream_fd_get(stream_fd);
+	}
+	pthread_mutex_unlock(&vstream->stream->lock);
+	if (!stream_fd) {
+		ERR("Client requested packet of stream id %" PRIu64
+				" before its trace file was opened",
+				(uint64_t) be64toh(get_packet_info.stream_id));
 		goto error;
 	}
-	read_len = lttng_read(vstream->stream_fd->fd,
-			reply + sizeof(reply_header),
-			packet_data_len);
+
+	if (stream_fd_get_fd(stream_fd) < 0) {
+		goto error;
+	}
+	read_len = lttng_pread(stream_fd->fd, reply + sizeof(reply_header),
+			packet_data_len, be64toh(get_packet_info.offset));
 	if (read_len < packet_data_len) {
 		PERROR("Relay reading trace file, fd: %d, offset: %" PRIu64,
-				vstream->stream_fd->fd,
+				stream_fd->fd,
 				(uint64_t) be64toh(get_packet_info.offset));
+		stream_fd_put_fd(stream_fd);
 		goto error;
 	}
+	stream_fd_put_fd(stream_fd);
 	reply_header.status = htobe32(LTTNG_VIEWER_GET_PACKET_OK);
 	reply_header.len = htobe32(packet_data_len);
 	goto send_reply;
@@ -1550,8 +1721,8 @@ error:
 	reply_header.status = htobe32(LTTNG_VIEWER_GET_PACKET_ERR);
 
 send_reply:
-	if (vstream) {
-		pthread_mutex_unlock(&vstream->stream->lock);
+	if (stream_fd) {
+		stream_fd_put(stream_fd);
 	}
 send_reply_nolock:
 
@@ -1673,7 +1844,11 @@ int viewer_get_metadata(struct relay_connection *conn)
 		goto error;
 	}
 
+	if (stream_fd_get_fd(vstream->stream_fd) < 0) {
+		goto error;
+	}
 	read_len = lttng_read(vstream->stream_fd->fd, data, len);
+	stream_fd_put_fd(vstream->stream_fd);
 	if (read_len < len) {
 		PERROR("Relay reading metadata file");
 		goto error;
@@ -1832,6 +2007,146 @@ end:
 	return ret;
 }
 
+/*
+ * Return 1 if the notification connection is subscribed to the session, 0 if
+ * not.
+ */
+static
+int notification_conn_is_subscribed(struct relay_connection *conn,
+		uint64_t session_id)
+{
+	const struct lttng_dynamic_buffer *session_ids =
+			&conn->protocol.notification.session_ids;
+	const uint64_t *ids = (const uint64_t *) session_ids->data;
+	size_t i, count = session_ids->size / sizeof(uint64_t);
+
+	for (i = 0; i < count; i++) {
+		if (ids[i] == session_id) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Drop all the session subscriptions of a notification connection.
+ */
+static
+void notification_conn_unsubscribe_all(struct live_worker *worker,
+		struct relay_connection *conn)
+{
+	struct lttng_dynamic_buffer *session_ids;
+	const uint64_t *ids;
+	size_t i, count;
+
+	if (conn->type != RELAY_VIEWER_NOTIFICATION) {
+		return;
+	}
+
+	session_ids = &conn->protocol.notification.session_ids;
+	ids = (const uint64_t *) session_ids->data;
+	count = session_ids->size / sizeof(uint64_t);
+	for (i = 0; i < count; i++) {
+		struct relay_session *session;
+
+		session = session_get_by_id(ids[i]);
+		if (!session) {
+			/* Already destroyed, nobody left to notify about. */
+			continue;
+		}
+		uatomic_dec(&session->viewer_subscribers);
+		session_put(session);
+	}
+	uatomic_sub(&worker->subscription_count, count);
+	(void) lttng_dynamic_buffer_set_size(session_ids, 0);
+}
+
+/*
+ * Subscribe a notification connection to a session.
+ *
+ * Once subscribed, the viewer is notified on this connection whenever a
+ * stream of the session has a new index or when new streams are added,
+ * instead of having to poll the relayd.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static
+int viewer_subscribe(struct relay_connection *conn, struct live_worker *worker)
+{
+	int ret;
+	struct lttng_viewer_subscribe_request request;
+	struct lttng_viewer_subscribe_response response;
+	struct relay_session *session = NULL;
+	uint64_t session_id;
+
+	assert(conn);
+
+	health_code_update();
+
+	ret = recv_request(conn->sock, &request, sizeof(request));
+	if (ret < 0) {
+		goto end;
+	}
+	session_id = be64toh(request.session_id);
+
+	health_code_update();
+
+	memset(&response, 0, sizeof(response));
+
+	if (conn->type != RELAY_VIEWER_NOTIFICATION) {
+		DBG("Subscribe command received on a non-notification connection");
+		response.status = htobe32(LTTNG_VIEWER_SUBSCRIBE_ERR);
+		goto send_reply;
+	}
+
+	session = session_get_by_id(session_id);
+	if (!session) {
+		DBG("Relay session %" PRIu64 " not found", session_id);
+		response.status = htobe32(LTTNG_VIEWER_SUBSCRIBE_UNK);
+		goto send_reply;
+	}
+
+	if (!session->live_timer) {
+		DBG("Relay session %" PRIu64 " is not live", session_id);
+		response.status = htobe32(LTTNG_VIEWER_SUBSCRIBE_NOT_LIVE);
+		goto send_reply;
+	}
+
+	if (notification_conn_is_subscribed(conn, session_id)) {
+		response.status = htobe32(LTTNG_VIEWER_SUBSCRIBE_OK);
+		goto send_reply;
+	}
+
+	ret = lttng_dynamic_buffer_append(
+			&conn->protocol.notification.session_ids,
+			&session_id, sizeof(session_id));
+	if (ret) {
+		ERR("Failed to add subscription to session %" PRIu64,
+				session_id);
+		response.status = htobe32(LTTNG_VIEWER_SUBSCRIBE_ERR);
+		goto send_reply;
+	}
+	uatomic_inc(&session->viewer_subscribers);
+	uatomic_inc(&worker->subscription_count);
+	response.status = htobe32(LTTNG_VIEWER_SUBSCRIBE_OK);
+	DBG("Viewer subscribed to session %" PRIu64, session_id);
+
+send_reply:
+	if (session) {
+		session_put(session);
+	}
+	health_code_update();
+	ret = send_response(conn->sock, &response, sizeof(response));
+	if (ret < 0) {
+		goto end;
+	}
+	health_code_update();
+	ret = 0;
+
+end:
+	return ret;
+}
+
 /*
  * live_relay_unknown_command: send -1 if received unknown command
  */
@@ -1850,7 +2165,7 @@ void live_relay_unknown_command(struct relay_connection *conn)
  */
 static
 int process_control(struct lttng_viewer_cmd *recv_hdr,
-		struct relay_connection *conn)
+		struct relay_connection *conn, struct live_worker *worker)
 {
 	int ret = 0;
 	uint32_t msg_value;
@@ -1895,6 +2210,9 @@ int process_control(struct lttng_viewer_cmd *recv_hdr,
 	case LTTNG_VIEWER_DETACH_SESSION:
 		ret = viewer_detach_session(conn);
 		break;
+	case LTTNG_VIEWER_SUBSCRIBE:
+		ret = viewer_subscribe(conn, worker);
+		break;
 	default:
 		ERR("Received unknown viewer command (%u)",
 				be32toh(recv_hdr->cmd));
@@ -1908,9 +2226,13 @@ end:
 }
 
 static
-void cleanup_connection_pollfd(struct lttng_poll_event *events, int pollfd)
+void cleanup_connection_pollfd(struct live_worker *worker,
+		struct lttng_poll_event *events, struct relay_connection *conn)
 {
 	int ret;
+	int pollfd = conn->sock->fd;
+
+	notification_conn_unsubscribe_all(worker, conn);
 
 	(void) lttng_poll_del(events, pollfd);
 
@@ -1918,6 +2240,145 @@ void cleanup_connection_pollfd(struct lttng_poll_event *events, int pollfd)
 	if (ret < 0) {
 		ERR("Closing pollfd %d", pollfd);
 	}
+	uatomic_dec(&worker->connection_count);
+}
+
+/*
+ * Send a notification on a notification connection without blocking the
+ * worker thread.
+ *
+ * Return 0 on success, 1 if the socket buffer is full and nothing was sent,
+ * or else a negative value (including on a short send, after which the
+ * stream can't be resynchronized).
+ */
+static
+int send_notification(struct relay_connection *conn, uint64_t session_id,
+		uint64_t stream_id, enum lttng_viewer_notification_type type)
+{
+	ssize_t ret;
+	struct lttng_viewer_notification msg;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.session_id = htobe64(session_id);
+	msg.stream_id = htobe64(stream_id);
+	msg.type = htobe32(type);
+
+	do {
+		ret = send(conn->sock->fd, &msg, sizeof(msg),
+				MSG_DONTWAIT | MSG_NOSIGNAL);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 1;
+		}
+		if (errno != EPIPE || !lttng_opt_quiet) {
+			PERROR("send viewer notification");
+		}
+		return -1;
+	}
+	if (ret != sizeof(msg)) {
+		ERR("Short send of viewer notification on socket %d",
+				conn->sock->fd);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Drain the worker's notification pipe and forward the notifications to the
+ * subscribed notification connections.
+ *
+ * Notifications are sent without blocking: when a viewer's socket buffer is
+ * full, the remaining notifications for that viewer are dropped and the
+ * connection is marked as overflowed. An OVERFLOW notification is sent to it
+ * on a later dispatch, once its buffer has room again, so the viewer knows
+ * to resynchronize. Connections on which a send fails are closed.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static
+int dispatch_notifications(struct live_worker *worker,
+		struct lttng_ht *viewer_connections_ht,
+		struct lttng_poll_event *events)
+{
+	int ret = 0;
+	ssize_t len;
+	size_t i, count;
+	int overflow;
+	struct live_notification notifications[LIVE_NOTIFICATION_BATCH];
+	struct relay_connection *conn;
+	struct lttng_ht_iter iter;
+
+	len = lttng_read(worker->notification_pipe[0], notifications,
+			sizeof(notifications));
+	if (len < 0) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK) {
+			len = 0;
+		} else {
+			PERROR("read live notification pipe");
+			ret = -1;
+			goto end;
+		}
+	}
+	count = len / sizeof(notifications[0]);
+	/* Read the flag after draining so no dropped notification is missed. */
+	overflow = uatomic_xchg(&worker->notification_overflow, 0);
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(viewer_connections_ht->ht, &iter.iter, conn,
+			sock_n.node) {
+		health_code_update();
+
+		if (conn->type != RELAY_VIEWER_NOTIFICATION ||
+				!conn->protocol.notification.session_ids.size) {
+			continue;
+		}
+
+		if (overflow || conn->protocol.notification.overflow) {
+			ret = send_notification(conn, -1ULL, -1ULL,
+					LTTNG_VIEWER_NOTIFICATION_OVERFLOW);
+			if (ret < 0) {
+				goto close_conn;
+			} else if (ret > 0) {
+				/* Still full, this batch is lost for it too. */
+				conn->protocol.notification.overflow = true;
+				ret = 0;
+				continue;
+			}
+			conn->protocol.notification.overflow = false;
+		}
+		for (i = 0; i < count; i++) {
+			if (!notification_conn_is_subscribed(conn,
+					notifications[i].session_id)) {
+				continue;
+			}
+			ret = send_notification(conn,
+					notifications[i].session_id,
+					notifications[i].stream_id,
+					notifications[i].type);
+			if (ret < 0) {
+				goto close_conn;
+			} else if (ret > 0) {
+				DBG("Viewer notification conn %d overflowed",
+						conn->sock->fd);
+				conn->protocol.notification.overflow = true;
+				ret = 0;
+				break;
+			}
+		}
+		continue;
+
+	close_conn:
+		DBG("Viewer notification conn closed with %d", conn->sock->fd);
+		cleanup_connection_pollfd(worker, events, conn);
+		/* Put "create" ownership reference. */
+		connection_put(conn);
+		ret = 0;
+	}
+	rcu_read_unlock();
+
+end:
+	return ret;
 }
 
 /*
@@ -1933,8 +2394,10 @@ void *thread_worker(void *data)
 	struct lttng_ht_iter iter;
 	struct lttng_viewer_cmd recv_hdr;
 	struct relay_connection *destroy_conn;
+	struct live_worker *worker = data;
 
-	DBG("[thread] Live viewer relay worker started");
+	DBG("[thread] Live viewer relay worker %u started",
+			(unsigned int) (worker - live_workers));
 
 	rcu_register_thread();
 
@@ -1950,12 +2413,17 @@ void *thread_worker(void *data)
 		goto viewer_connections_ht_error;
 	}
 
-	ret = create_thread_poll_set(&events, 2);
+	ret = create_thread_poll_set(&events, 3);
 	if (ret < 0) {
 		goto error_poll_create;
 	}
 
-	ret = lttng_poll_add(&events, live_conn_pipe[0], LPOLLIN | LPOLLRDHUP);
+	ret = lttng_poll_add(&events, worker->conn_pipe[0], LPOLLIN | LPOLLRDHUP);
+	if (ret < 0) {
+		goto error;
+	}
+
+	ret = lttng_poll_add(&events, worker->notification_pipe[0], LPOLLIN);
 	if (ret < 0) {
 		goto error;
 	}
@@ -2003,11 +2471,11 @@ restart:
 			}
 
 			/* Inspect the relay conn pipe for new connection. */
-			if (pollfd == live_conn_pipe[0]) {
+			if (pollfd == worker->conn_pipe[0]) {
 				if (revents & LPOLLIN) {
 					struct relay_connection *conn;
 
-					ret = lttng_read(live_conn_pipe[0],
+					ret = lttng_read(worker->conn_pipe[0],
 							&conn, sizeof(conn));
 					if (ret < 0) {
 						goto error;
@@ -2023,6 +2491,18 @@ restart:
 					ERR("Unexpected poll events %u for sock %d", revents, pollfd);
 					goto error;
 				}
+			} else if (pollfd == worker->notification_pipe[0]) {
+				if (revents & LPOLLIN) {
+					ret = dispatch_notifications(worker,
+							viewer_connections_ht,
+							&events);
+					if (ret < 0) {
+						goto error;
+					}
+				} else {
+					ERR("Relay live notification pipe error");
+					goto error;
+				}
 			} else {
 				/* Connection activity. */
 				struct relay_connection *conn;
@@ -2037,22 +2517,22 @@ restart:
 							sizeof(recv_hdr), 0);
 					if (ret <= 0) {
 						/* Connection closed. */
-						cleanup_connection_pollfd(&events, pollfd);
+						cleanup_connection_pollfd(worker, &events, conn);
 						/* Put "create" ownership reference. */
 						connection_put(conn);
 						DBG("Viewer control conn closed with %d", pollfd);
 					} else {
-						ret = process_control(&recv_hdr, conn);
+						ret = process_control(&recv_hdr, conn, worker);
 						if (ret < 0) {
 							/* Clear the session on error. */
-							cleanup_connection_pollfd(&events, pollfd);
+							cleanup_connection_pollfd(worker, &events, conn);
 							/* Put "create" ownership reference. */
 							connection_put(conn);
 							DBG("Viewer connection closed with %d", pollfd);
 						}
 					}
 				} else if (revents & (LPOLLERR | LPOLLHUP | LPOLLRDHUP)) {
-					cleanup_connection_pollfd(&events, pollfd);
+					cleanup_connection_pollfd(worker, &events, conn);
 					/* Put "create" ownership reference. */
 					connection_put(conn);
 				} else {
@@ -2076,6 +2556,7 @@ error:
 			destroy_conn,
 			sock_n.node) {
 		health_code_update();
+		notification_conn_unsubscribe_all(worker, destroy_conn);
 		connection_put(destroy_conn);
 	}
 	rcu_read_unlock();
@@ -2083,7 +2564,7 @@ error_poll_create:
 	lttng_ht_destroy(viewer_connections_ht);
 viewer_connections_ht_error:
 	/* Close relay conn pipes */
-	utils_close_pipe(live_conn_pipe);
+	utils_close_pipe(worker->conn_pipe);
 	if (err) {
 		DBG("Viewer worker thread exited with error");
 	}
@@ -2102,12 +2583,134 @@ error_testpoint:
 }
 
 /*
- * Create the relay command pipe to wake thread_manage_apps.
- * Closed in cleanup().
+ * Allocate the live worker descriptors and create the pipes used to hand
+ * over connections to them. The connection pipes are closed by their worker
+ * thread on exit, the notification pipes by cleanup_relayd_live().
  */
-static int create_conn_pipe(void)
+static int create_live_workers(unsigned int count)
 {
-	return utils_create_pipe_cloexec(live_conn_pipe);
+	int ret;
+	unsigned int i;
+
+	pthread_mutex_lock(&live_workers_lock);
+	live_workers = zmalloc(count * sizeof(*live_workers));
+	if (!live_workers) {
+		PERROR("zmalloc live workers");
+		ret = -1;
+		pthread_mutex_unlock(&live_workers_lock);
+		goto end;
+	}
+	live_worker_count = count;
+
+	for (i = 0; i < count; i++) {
+		live_workers[i].conn_pipe[0] = -1;
+		live_workers[i].conn_pipe[1] = -1;
+		live_workers[i].notification_pipe[0] = -1;
+		live_workers[i].notification_pipe[1] = -1;
+	}
+	pthread_mutex_unlock(&live_workers_lock);
+
+	for (i = 0; i < count; i++) {
+		ret = utils_create_pipe_cloexec(live_workers[i].conn_pipe);
+		if (ret) {
+			goto error;
+		}
+		ret = utils_create_pipe_cloexec_nonblock(
+				live_workers[i].notification_pipe);
+		if (ret) {
+			goto error;
+		}
+	}
+	ret = 0;
+end:
+	return ret;
+
+error:
+	for (i = 0; i < count; i++) {
+		utils_close_pipe(live_workers[i].conn_pipe);
+	}
+	return ret;
+}
+
+/*
+ * Join the first "count" live worker threads.
+ */
+static int join_live_workers(unsigned int count)
+{
+	int ret, retval = 0;
+	unsigned int i;
+	void *status;
+
+	for (i = 0; i < count; i++) {
+		ret = pthread_join(live_workers[i].thread, &status);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_join live worker");
+			retval = -1;
+		}
+	}
+
+	return retval;
+}
+
+/*
+ * Post a notification to the live workers having subscribers. Never blocks:
+ * if a worker's pipe is full, its subscribers get an overflow notification
+ * instead.
+ */
+static
+void live_notify(uint64_t session_id, uint64_t stream_id,
+		enum lttng_viewer_notification_type type)
+{
+	unsigned int i;
+	struct live_notification notification;
+
+	memset(&notification, 0, sizeof(notification));
+	notification.session_id = session_id;
+	notification.stream_id = stream_id;
+	notification.type = type;
+
+	pthread_mutex_lock(&live_workers_lock);
+	for (i = 0; i < live_worker_count; i++) {
+		struct live_worker *worker = &live_workers[i];
+		ssize_t ret;
+
+		if (!uatomic_read(&worker->subscription_count)) {
+			continue;
+		}
+		ret = lttng_write(worker->notification_pipe[1], &notification,
+				sizeof(notification));
+		if (ret < (ssize_t) sizeof(notification)) {
+			uatomic_set(&worker->notification_overflow, 1);
+		}
+	}
+	pthread_mutex_unlock(&live_workers_lock);
+}
+
+/*
+ * Notify the subscribed viewers that the next index of a stream is
+ * available. Called with the stream lock held.
+ */
+void live_notify_index_ready(struct relay_stream *stream)
+{
+	struct relay_session *session = stream->trace->session;
+
+	if (!uatomic_read(&session->viewer_subscribers)) {
+		return;
+	}
+	live_notify(session->id, stream->stream_handle,
+			LTTNG_VIEWER_NOTIFICATION_INDEX_READY);
+}
+
+/*
+ * Notify the subscribed viewers that new streams were added to a session.
+ */
+void live_notify_new_streams(struct relay_session *session)
+{
+	if (!uatomic_read(&session->viewer_subscribers)) {
+		return;
+	}
+	live_notify(session->id, -1ULL, LTTNG_VIEWER_NOTIFICATION_NEW_STREAMS);
 }
 
 int relayd_live_join(void)
@@ -2122,10 +2725,8 @@ int relayd_live_join(void)
 		retval = -1;
 	}
 
-	ret = pthread_join(live_worker_thread, &status);
+	ret = join_live_workers(live_worker_count);
 	if (ret) {
-		errno = ret;
-		PERROR("pthread_join live worker");
 		retval = -1;
 	}
 
@@ -2144,11 +2745,12 @@ int relayd_live_join(void)
 /*
  * main
  */
-int relayd_live_create(struct lttng_uri *uri)
+int relayd_live_create(struct lttng_uri *uri, unsigned int worker_count)
 {
 	int ret = 0, retval = 0;
 	void *status;
 	int is_root;
+	unsigned int i, nr_started_workers = 0;
 
 	if (!uri) {
 		retval = -1;
@@ -2167,8 +2769,15 @@ int relayd_live_create(struct lttng_uri *uri)
 		}
 	}
 
-	/* Setup the thread apps communication pipe. */
-	if (create_conn_pipe()) {
+	if (worker_count == 0) {
+		long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		worker_count = nr_cpus > 0 ? (unsigned int) nr_cpus : 1;
+	}
+	DBG("Using %u live viewer worker thread(s)", worker_count);
+
+	/* Setup the worker threads communication pipes. */
+	if (create_live_workers(worker_count)) {
 		retval = -1;
 		goto exit_init_data;
 	}
@@ -2179,7 +2788,7 @@ int relayd_live_create(struct lttng_uri *uri)
 	/* Set up max poll set size */
 	if (lttng_poll_set_max_size()) {
 		retval = -1;
-		goto exit_init_data;
+		goto exit_dispatcher_thread;
 	}
 
 	/* Setup the dispatcher thread */
@@ -2192,14 +2801,18 @@ int relayd_live_create(struct lttng_uri *uri)
 		goto exit_dispatcher_thread;
 	}
 
-	/* Setup the worker thread */
-	ret = pthread_create(&live_worker_thread, default_pthread_attr(),
-			thread_worker, NULL);
-	if (ret) {
-		errno = ret;
-		PERROR("pthread_create viewer worker");
-		retval = -1;
-		goto exit_worker_thread;
+	/* Setup the worker threads */
+	for (i = 0; i < live_worker_count; i++) {
+		ret = pthread_create(&live_workers[i].thread,
+				default_pthread_attr(), thread_worker,
+				&live_workers[i]);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_create viewer worker");
+			retval = -1;
+			goto exit_worker_thread;
+		}
+		nr_started_workers++;
 	}
 
 	/* Setup the listener thread */
@@ -2223,14 +2836,12 @@ int relayd_live_create(struct lttng_uri *uri)
 	 */
 
 exit_listener_thread:
+exit_worker_thread:
 
-	ret = pthread_join(live_worker_thread, &status);
+	ret = join_live_workers(nr_started_workers);
 	if (ret) {
-		errno = ret;
-		PERROR("pthread_join live worker");
 		retval = -1;
 	}
-exit_worker_thread:
 
 	ret = pthread_join(live_dispatcher_thread, &status);
 	if (ret) {
@@ -2239,6 +2850,10 @@ exit_worker_thread:
 		retval = -1;
 	}
 exit_dispatcher_thread:
+	/* Workers that were never started did not get to close their pipe. */
+	for (i = nr_started_workers; i < live_worker_count; i++) {
+		utils_close_pipe(live_workers[i].conn_pipe);
+	}
 
 exit_init_data:
 	cleanup_relayd_live();
@@ -23,11 +23,16 @@
 #include <common/uri.h>
 
 #include "lttng-relayd.h"
+#include "session.h"
+#include "stream.h"
 
-int relayd_live_create(struct lttng_uri *live_uri);
+int relayd_live_create(struct lttng_uri *live_uri, unsigned int worker_count);
 int relayd_live_stop(void);
 int relayd_live_join(void);
 
 struct relay_viewer_stream *live_find_viewer_stream_by_id(uint64_t stream_id);
 
+void live_notify_index_ready(struct relay_stream *stream);
+void live_notify_new_streams(struct relay_session *session);
+
 #endif /* LTTNG_RELAYD_LIVE_H */
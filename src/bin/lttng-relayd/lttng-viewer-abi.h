@@ -50,6 +50,7 @@ enum lttng_viewer_command {
 	LTTNG_VIEWER_GET_NEW_STREAMS	= 7,
 	LTTNG_VIEWER_CREATE_SESSION	= 8,
 	LTTNG_VIEWER_DETACH_SESSION	= 9,
+	LTTNG_VIEWER_SUBSCRIBE		= 10,
 };
 
 enum lttng_viewer_attach_return_code {
@@ -93,6 +94,11 @@ enum lttng_viewer_seek {
 	LTTNG_VIEWER_SEEK_BEGINNING	= 1,
 	/* Receive the trace packets from now. */
 	LTTNG_VIEWER_SEEK_LAST		= 2,
+	/*
+	 * Receive the trace packets ending at or after a given timestamp
+	 * (in clock cycles of the stream clock).
+	 */
+	LTTNG_VIEWER_SEEK_TIMESTAMP	= 3,
 };
 
 enum lttng_viewer_new_streams_return_code {
@@ -113,6 +119,33 @@ enum lttng_viewer_detach_session_return_code {
 	LTTNG_VIEWER_DETACH_SESSION_ERR         = 3,
 };
 
+enum lttng_viewer_subscribe_return_code {
+	LTTNG_VIEWER_SUBSCRIBE_OK		= 1,
+	LTTNG_VIEWER_SUBSCRIBE_UNK		= 2, /* The session ID is unknown. */
+	LTTNG_VIEWER_SUBSCRIBE_NOT_LIVE		= 3, /* The session is not live. */
+	LTTNG_VIEWER_SUBSCRIBE_ERR		= 4,
+};
+
+/*
+ * Notifications pushed by the relayd on a notification connection
+ * (LTTNG_VIEWER_CLIENT_NOTIFICATION) once it is subscribed to a session.
+ */
+enum lttng_viewer_notification_type {
+	/*
+	 * A stream has a new index or became inactive: its next
+	 * LTTNG_VIEWER_GET_NEXT_INDEX will not return
+	 * LTTNG_VIEWER_INDEX_RETRY.
+	 */
+	LTTNG_VIEWER_NOTIFICATION_INDEX_READY	= 1,
+	/* New streams can be fetched with LTTNG_VIEWER_GET_NEW_STREAMS. */
+	LTTNG_VIEWER_NOTIFICATION_NEW_STREAMS	= 2,
+	/*
+	 * Notifications were dropped, every stream of every subscribed
+	 * session must be checked.
+	 */
+	LTTNG_VIEWER_NOTIFICATION_OVERFLOW	= 3,
+};
+
 struct lttng_viewer_session {
 	uint64_t id;
 	uint32_t live_timer;
@@ -160,7 +193,8 @@ struct lttng_viewer_list_sessions {
  */
 struct lttng_viewer_attach_session_request {
 	uint64_t session_id;
-	uint64_t offset;	/* unused for now */
+	/* Timestamp for LTTNG_VIEWER_SEEK_TIMESTAMP, unused otherwise. */
+	uint64_t offset;
 	uint32_t seek;		/* enum lttng_viewer_seek */
 } LTTNG_PACKED;
 
@@ -252,4 +286,29 @@ struct lttng_viewer_detach_session_response {
 	uint32_t status;
 } LTTNG_PACKED;
 
+/*
+ * LTTNG_VIEWER_SUBSCRIBE payload.
+ *
+ * Only valid on a notification connection. The connection can subscribe to
+ * many sessions by sending this command more than once.
+ */
+struct lttng_viewer_subscribe_request {
+	uint64_t session_id;
+} LTTNG_PACKED;
+
+struct lttng_viewer_subscribe_response {
+	/* enum lttng_viewer_subscribe_return_code */
+	uint32_t status;
+} LTTNG_PACKED;
+
+/*
+ * Message sent by the relayd on a subscribed notification connection.
+ */
+struct lttng_viewer_notification {
+	uint64_t session_id;
+	/* -1ULL for session-wide notifications. */
+	uint64_t stream_id;
+	uint32_t type;		/* enum lttng_viewer_notification_type */
+} LTTNG_PACKED;
+
 #endif /* LTTNG_VIEWER_ABI_H */
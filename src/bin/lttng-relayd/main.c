@@ -19,6 +19,7 @@
  */
 
 #define _LGPL_SOURCE
+#include <ctype.h>
 #include <getopt.h>
 #include <grp.h>
 #include <limits.h>
@@ -74,6 +75,7 @@
 #include "connection.h"
 #include "tracefile-array.h"
 #include "tcp_keep_alive.h"
+#include "stream-fd.h"
 
 static const char *help_msg =
 #ifdef LTTNG_EMBED_HELP
@@ -94,6 +96,10 @@ enum relay_connection_status {
 /* command line options */
 char *opt_output_path;
 static int opt_daemon, opt_background;
+/* 0 means one live worker thread per online CPU. */
+static unsigned int opt_live_worker_threads;
+/* 0 means half of the open file descriptor limit. */
+static unsigned int opt_fd_pool_size;
 
 /*
  * We need to wait for listener and live listener threads, as well as
@@ -171,6 +177,8 @@ static struct option long_options[] = {
 	{ "control-port", 1, 0, 'C', },
 	{ "data-port", 1, 0, 'D', },
 	{ "live-port", 1, 0, 'L', },
+	{ "live-worker-threads", 1, 0, 0, },
+	{ "fd-pool-size", 1, 0, 0, },
 	{ "daemonize", 0, 0, 'd', },
 	{ "background", 0, 0, 'b', },
 	{ "group", 1, 0, 'g', },
@@ -196,6 +204,35 @@ static int set_option(int opt, const char *arg, const char *optname)
 
 	switch (opt) {
 	case 0:
+		if (!strcmp(optname, "live-worker-threads")) {
+			unsigned long v;
+
+			errno = 0;
+			v = strtoul(arg, NULL, 0);
+			if (errno != 0 || !isdigit(arg[0]) || v > UINT_MAX) {
+				ERR("Wrong value in --live-worker-threads parameter: %s",
+						arg);
+				ret = -1;
+				goto end;
+			}
+			opt_live_worker_threads = (unsigned int) v;
+			break;
+		}
+		if (!strcmp(optname, "fd-pool-size")) {
+			unsigned long v;
+
+			errno = 0;
+			v = strtoul(arg, NULL, 0);
+			if (errno != 0 || !isdigit(arg[0]) || v == 0 ||
+					v > UINT_MAX) {
+				ERR("Wrong value in --fd-pool-size parameter: %s",
+						arg);
+				ret = -1;
+				goto end;
+			}
+			opt_fd_pool_size = (unsigned int) v;
+			break;
+		}
 		fprintf(stderr, "option %s", optname);
 		if (arg) {
 			fprintf(stderr, " with arg %s\n", arg);
@@ -509,6 +546,7 @@ static void print_global_objects(void)
 static void relayd_cleanup(void)
 {
 	print_global_objects();
+	stream_fd_cache_log_stats();
 
 	DBG("Cleaning up");
 
@@ -1179,6 +1217,7 @@ static void publish_connection_local_streams(struct relay_connection *conn)
 		uatomic_set(&session->new_streams, 1);
 	}
 	pthread_mutex_unlock(&session->lock);
+	live_notify_new_streams(session);
 }
 
 /*
@@ -1418,9 +1457,14 @@ int relay_reset_metadata(const struct lttcomm_relayd_hdr *recv_hdr,
 		goto end_unlock;
 	}
 
+	if (stream_fd_get_fd(stream->stream_fd) < 0) {
+		ret = -1;
+		goto end_unlock;
+	}
 	ret = utils_rotate_stream_file(stream->path_name, stream->channel_name,
 			0, 0, -1, -1, stream->stream_fd->fd, NULL,
 			&stream->stream_fd->fd);
+	stream_fd_put_fd(stream->stream_fd);
 	if (ret < 0) {
 		ERR("Failed to rotate metadata file %s of channel %s",
 				stream->path_name, stream->channel_name);
@@ -1546,7 +1590,7 @@ int create_rotate_index_file(struct relay_stream *stream,
 	}
 	major = stream->trace->session->major;
 	minor = stream->trace->session->minor;
-	stream->index_file = lttng_index_file_create(stream_path,
+	stream->index_file = relay_index_file_create(stream_path,
 			stream->channel_name,
 			-1, -1, stream->tracefile_size,
 			tracefile_array_get_file_index_head(stream->tfa),
@@ -1571,11 +1615,16 @@ int do_rotate_stream_data(struct relay_stream *stream)
 	DBG("Rotating stream %" PRIu64 " data file",
 			stream->stream_handle);
 	/* Perform the stream rotation. */
+	if (stream_fd_get_fd(stream->stream_fd) < 0) {
+		ret = -1;
+		goto end;
+	}
 	ret = utils_rotate_stream_file(stream->path_name,
 			stream->channel_name, stream->tracefile_size,
 			stream->tracefile_count, -1,
 			-1, stream->stream_fd->fd,
 			NULL, &stream->stream_fd->fd);
+	stream_fd_put_fd(stream->stream_fd);
 	if (ret < 0) {
 		ERR("Rotating stream output file");
 		goto end;
@@ -1620,6 +1669,11 @@ int rotate_truncate_stream(struct relay_stream *stream)
 	diff = stream->tracefile_size_current -
 			stream->pos_after_last_complete_data_index;
 
+	if (stream_fd_get_fd(stream->stream_fd) < 0) {
+		ret = -1;
+		goto end;
+	}
+
 	/* Create the new tracefile. */
 	new_fd = utils_create_stream_file(stream->path_name,
 			stream->channel_name,
@@ -1629,7 +1683,7 @@ int rotate_truncate_stream(struct relay_stream *stream)
 		ERR("Failed to create new stream file at path %s for channel %s",
 				stream->path_name, stream->channel_name);
 		ret = -1;
-		goto end;
+		goto end_put_fd;
 	}
 
 	/*
@@ -1641,7 +1695,7 @@ int rotate_truncate_stream(struct relay_stream *stream)
 	if (lseek_ret < 0) {
 		PERROR("seek truncate stream");
 		ret = -1;
-		goto end;
+		goto end_put_fd;
 	}
 
 	/* Move data from the old file to the new file. */
@@ -1666,7 +1720,7 @@ int rotate_truncate_stream(struct relay_stream *stream)
 				ERR("%s", error_string);
 			}
 			ret = -1;
-			goto end;
+			goto end_put_fd;
 		}
 
 		io_ret = lttng_write(new_fd, buf, count);
@@ -1682,7 +1736,7 @@ int rotate_truncate_stream(struct relay_stream *stream)
 				ERR("%s", error_string);
 			}
 			ret = -1;
-			goto end;
+			goto end_put_fd;
 		}
 
 		pos += count;
@@ -1693,13 +1747,13 @@ int rotate_truncate_stream(struct relay_stream *stream)
 			stream->pos_after_last_complete_data_index);
 	if (ret) {
 		PERROR("ftruncate");
-		goto end;
+		goto end_put_fd;
 	}
 
 	ret = close(stream->stream_fd->fd);
 	if (ret < 0) {
 		PERROR("Closing tracefile");
-		goto end;
+		goto end_put_fd;
 	}
 
 	/*
@@ -1709,7 +1763,7 @@ int rotate_truncate_stream(struct relay_stream *stream)
 	ret = relay_index_switch_all_files(stream);
 	if (ret < 0) {
 		ERR("Failed to rotate index file");
-		goto end;
+		goto end_put_fd;
 	}
 
 	stream->stream_fd->fd = new_fd;
@@ -1719,6 +1773,8 @@ int rotate_truncate_stream(struct relay_stream *stream)
 
 	ret = 0;
 
+end_put_fd:
+	stream_fd_put_fd(stream->stream_fd);
 end:
 	return ret;
 }
@@ -1889,17 +1945,24 @@ static int relay_recv_metadata(const struct lttcomm_relayd_hdr *recv_hdr,
 
 	pthread_mutex_lock(&metadata_stream->lock);
 
+	if (stream_fd_get_fd(metadata_stream->stream_fd) < 0) {
+		ret = -1;
+		goto end_put;
+	}
+
 	size_ret = lttng_write(metadata_stream->stream_fd->fd,
 			payload->data + sizeof(metadata_payload_header),
 			metadata_payload_size);
 	if (size_ret < metadata_payload_size) {
 		ERR("Relay error writing metadata on file");
+		stream_fd_put_fd(metadata_stream->stream_fd);
 		ret = -1;
 		goto end_put;
 	}
 
 	size_ret = write_padding_to_file(metadata_stream->stream_fd->fd,
 			metadata_payload_header.padding_size);
+	stream_fd_put_fd(metadata_stream->stream_fd);
 	if (size_ret < (int64_t) metadata_payload_header.padding_size) {
 		ret = -1;
 		goto end_put;
@@ -2316,6 +2379,26 @@ end_no_session:
  *
  * Return 0 on success else a negative value.
  */
+/*
+ * Handle a live beacon for a stream, i.e. the stream had no data to send up
+ * to timestamp_end. Called with the stream lock held.
+ */
+static void set_stream_beacon(struct relay_stream *stream,
+		uint64_t timestamp_end)
+{
+	DBG("Received live beacon for stream %" PRIu64, stream->stream_handle);
+
+	/*
+	 * Only flag a stream inactive when it has already
+	 * received data and no indexes are in flight.
+	 */
+	if (stream->index_received_seqcount > 0
+			&& stream->indexes_in_flight == 0) {
+		stream->beacon_ts_end = timestamp_end;
+		live_notify_index_ready(stream);
+	}
+}
+
 static int relay_recv_index(const struct lttcomm_relayd_hdr *recv_hdr,
 		struct relay_connection *conn,
 		const struct lttng_buffer_view *payload)
@@ -2374,17 +2457,7 @@ static int relay_recv_index(const struct lttcomm_relayd_hdr *recv_hdr,
 
 	/* Live beacon handling */
 	if (index_info.packet_size == 0) {
-		DBG("Received live beacon for stream %" PRIu64,
-				stream->stream_handle);
-
-		/*
-		 * Only flag a stream inactive when it has already
-		 * received data and no indexes are in flight.
-		 */
-		if (stream->index_received_seqcount > 0
-				&& stream->indexes_in_flight == 0) {
-			stream->beacon_ts_end = index_info.timestamp_end;
-		}
+		set_stream_beacon(stream, index_info.timestamp_end);
 		ret = 0;
 		goto end_stream_put;
 	} else {
@@ -2409,7 +2482,10 @@ static int relay_recv_index(const struct lttcomm_relayd_hdr *recv_hdr,
 	ret = relay_index_try_flush(index);
 	if (ret == 0) {
 		tracefile_array_commit_seq(stream->tfa);
+		stream_index_cache_add(stream, stream->index_received_seqcount,
+				&index->index_data);
 		stream->index_received_seqcount++;
+		live_notify_index_ready(stream);
 		stream->pos_after_last_complete_data_index += index->total_size;
 		stream->prev_index_seq = index_info.net_seq_num;
 
@@ -2453,6 +2529,96 @@ end_no_session:
 	return ret;
 }
 
+/*
+ * Receive a batch of live beacons, i.e. the empty indexes of all the
+ * quiescent streams of a channel for one live timer tick.
+ *
+ * Return 0 on success else a negative value.
+ */
+static int relay_recv_beacons(const struct lttcomm_relayd_hdr *recv_hdr,
+		struct relay_connection *conn,
+		const struct lttng_buffer_view *payload)
+{
+	int ret = 0;
+	ssize_t send_ret;
+	struct lttcomm_relayd_generic_reply reply;
+	struct lttcomm_relayd_beacons msg;
+	uint32_t i, count;
+
+	assert(conn);
+
+	DBG("Relay receiving beacons");
+
+	if (!conn->session || !conn->version_check_done) {
+		ERR("Trying to send beacons before version check");
+		ret = -1;
+		goto end_no_session;
+	}
+
+	if (conn->major == 2 && conn->minor < 12) {
+		ERR("Unsupported feature before 2.12");
+		ret = -1;
+		goto end_no_session;
+	}
+
+	if (payload->size < sizeof(msg)) {
+		ERR("Unexpected payload size in \"relay_recv_beacons\": expected >= %zu bytes, got %zu bytes",
+				sizeof(msg), payload->size);
+		ret = -1;
+		goto end_no_session;
+	}
+	memcpy(&msg, payload->data, sizeof(msg));
+	count = be32toh(msg.count);
+	if ((payload->size - sizeof(msg)) / sizeof(struct lttcomm_relayd_beacon)
+			< count) {
+		ERR("Unexpected payload size in \"relay_recv_beacons\": %" PRIu32 " beacons do not fit in %zu bytes",
+				count, payload->size);
+		ret = -1;
+		goto end_no_session;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct lttcomm_relayd_beacon beacon;
+		struct relay_stream *stream;
+		uint64_t net_seq_num;
+
+		memcpy(&beacon, payload->data + sizeof(msg) + i * sizeof(beacon),
+				sizeof(beacon));
+		stream = stream_get_by_id(be64toh(beacon.relay_stream_id));
+		if (!stream) {
+			/* The stream may have been closed since. */
+			DBG("Beacon for unknown stream %" PRIu64,
+					(uint64_t) be64toh(beacon.relay_stream_id));
+			continue;
+		}
+		pthread_mutex_lock(&stream->lock);
+		net_seq_num = be64toh(beacon.net_seq_num);
+		/*
+		 * The beacons of a tick are sent after the streams were
+		 * sampled; ignore the ones of streams that got a newer index
+		 * in the meantime.
+		 */
+		if (stream->prev_index_seq == -1ULL ||
+				(int64_t) (net_seq_num - stream->prev_index_seq) >= 0) {
+			set_stream_beacon(stream, be64toh(beacon.timestamp_end));
+		}
+		pthread_mutex_unlock(&stream->lock);
+		stream_put(stream);
+	}
+
+	memset(&reply, 0, sizeof(reply));
+	reply.ret_code = htobe32(LTTNG_OK);
+	send_ret = conn->sock->ops->sendmsg(conn->sock, &reply, sizeof(reply), 0);
+	if (send_ret < (ssize_t) sizeof(reply)) {
+		ERR("Failed to send \"recv beacons\" command reply (ret = %zd)",
+				send_ret);
+		ret = -1;
+	}
+
+end_no_session:
+	return ret;
+}
+
 /*
  * Receive the streams_sent message.
  *
@@ -2498,6 +2664,58 @@ end_no_session:
 	return ret;
 }
 
+/*
+ * Switch a stream to a new output path and chunk; takes ownership of
+ * path_name. The metadata stream is rotated right away while the files
+ * of a data stream are rotated once the data up to rotate_at_seq_num
+ * has been received.
+ *
+ * Called with the stream lock held.
+ */
+static int rotate_stream_output(struct relay_stream *stream, char *path_name,
+		uint64_t new_chunk_id, uint64_t rotate_at_seq_num)
+{
+	int ret;
+
+	/*
+	 * Update the trace path (just the folder, the stream name does not
+	 * change).
+	 */
+	free(stream->prev_path_name);
+	stream->prev_path_name = stream->path_name;
+	stream->path_name = path_name;
+
+	assert(stream->current_chunk_id.is_set);
+	stream->current_chunk_id.value = new_chunk_id;
+
+	if (stream->is_metadata) {
+		/*
+		 * Metadata streams have no index; consider its rotation
+		 * complete.
+		 */
+		stream->index_rotated = true;
+		/*
+		 * The metadata stream is sent only over the control connection
+		 * so we know we have all the data to perform the stream
+		 * rotation.
+		 */
+		ret = do_rotate_stream_data(stream);
+	} else {
+		stream->rotate_at_seq_num = rotate_at_seq_num;
+		ret = try_rotate_stream_data(stream);
+		if (ret < 0) {
+			goto end;
+		}
+
+		ret = try_rotate_stream_index(stream);
+		if (ret < 0) {
+			goto end;
+		}
+	}
+end:
+	return ret;
+}
+
 /*
  * relay_rotate_session_stream: rotate a stream to a new tracefile for the session
  * rotation feature (not the tracefile rotation feature).
@@ -2515,6 +2733,7 @@ static int relay_rotate_session_stream(const struct lttcomm_relayd_hdr *recv_hdr
 	size_t header_len;
 	size_t path_len;
 	struct lttng_buffer_view new_path_view;
+	char *path_name;
 
 	DBG("Rotate stream received");
 
@@ -2574,58 +2793,160 @@ static int relay_rotate_session_stream(const struct lttcomm_relayd_hdr *recv_hdr
 
 	pthread_mutex_lock(&stream->lock);
 
-	/*
-	 * Update the trace path (just the folder, the stream name does not
-	 * change).
-	 */
-	free(stream->prev_path_name);
-	stream->prev_path_name = stream->path_name;
-	stream->path_name = create_output_path(new_path_view.data);
-	if (!stream->path_name) {
+	path_name = create_output_path(new_path_view.data);
+	if (!path_name) {
 		ERR("Failed to create a new output path");
 		ret = -1;
 		goto end_stream_unlock;
 	}
-	ret = utils_mkdir_recursive(stream->path_name, S_IRWXU | S_IRWXG,
+	ret = utils_mkdir_recursive(path_name, S_IRWXU | S_IRWXG,
 			-1, -1);
 	if (ret < 0) {
 		ERR("relay creating output directory");
+		free(path_name);
 		ret = -1;
 		goto end_stream_unlock;
 	}
 
-	assert(stream->current_chunk_id.is_set);
-	stream->current_chunk_id.value = stream_info.new_chunk_id;
+	ret = rotate_stream_output(stream, path_name,
+			stream_info.new_chunk_id, stream_info.rotate_at_seq_num);
 
-	if (stream->is_metadata) {
-		/*
-		 * Metadata streams have no index; consider its rotation
-		 * complete.
-		 */
-		stream->index_rotated = true;
-		/*
-		 * The metadata stream is sent only over the control connection
-		 * so we know we have all the data to perform the stream
-		 * rotation.
-		 */
-		ret = do_rotate_stream_data(stream);
+end_stream_unlock:
+	pthread_mutex_unlock(&stream->lock);
+	stream_put(stream);
+end:
+	memset(&reply, 0, sizeof(reply));
+	if (ret < 0) {
+		reply.ret_code = htobe32(LTTNG_ERR_UNK);
 	} else {
-		stream->rotate_at_seq_num = stream_info.rotate_at_seq_num;
-		ret = try_rotate_stream_data(stream);
-		if (ret < 0) {
-			goto end_stream_unlock;
+		reply.ret_code = htobe32(LTTNG_OK);
+	}
+	send_ret = conn->sock->ops->sendmsg(conn->sock, &reply,
+			sizeof(struct lttcomm_relayd_generic_reply), 0);
+	if (send_ret < (ssize_t) sizeof(reply)) {
+		ERR("Failed to send \"rotate session stream\" command reply (ret = %zd)",
+				send_ret);
+		ret = -1;
+	}
+
+end_no_reply:
+	return ret;
+}
+
+/*
+ * relay_rotate_session_streams: rotate a batch of data streams sharing the
+ * same new path, for the session rotation feature.
+ */
+static int relay_rotate_session_streams(const struct lttcomm_relayd_hdr *recv_hdr,
+		struct relay_connection *conn,
+		const struct lttng_buffer_view *payload)
+{
+	int ret;
+	ssize_t send_ret;
+	struct relay_session *session = conn->session;
+	struct lttcomm_relayd_rotate_streams msg;
+	struct lttcomm_relayd_generic_reply reply;
+	size_t header_len, path_len;
+	uint32_t i, stream_count;
+	uint64_t new_chunk_id;
+	const char *positions;
+	char *path_name = NULL;
+
+	DBG("Rotate streams received");
+
+	if (!session || !conn->version_check_done) {
+		ERR("Trying to rotate streams before version check");
+		ret = -1;
+		goto end_no_reply;
+	}
+
+	if (session->major == 2 && session->minor < 12) {
+		ERR("Unsupported feature before 2.12");
+		ret = -1;
+		goto end_no_reply;
+	}
+
+	header_len = sizeof(msg);
+	if (payload->size < header_len) {
+		ERR("Unexpected payload size in \"relay_rotate_session_streams\": expected >= %zu bytes, got %zu bytes",
+				header_len, payload->size);
+		ret = -1;
+		goto end_no_reply;
+	}
+
+	memcpy(&msg, payload->data, header_len);
+	stream_count = be32toh(msg.stream_count);
+	new_chunk_id = be64toh(msg.new_chunk_id);
+	path_len = be32toh(msg.pathname_length);
+
+	if (path_len == 0 || path_len > LTTNG_PATH_MAX ||
+			payload->size - header_len < path_len ||
+			(payload->size - header_len - path_len) /
+				sizeof(struct lttcomm_relayd_stream_rotation_position) <
+				stream_count) {
+		ERR("Unexpected payload size in \"relay_rotate_session_streams\": path of %zu bytes and %" PRIu32 " streams do not fit in %zu bytes",
+				path_len, stream_count, payload->size);
+		ret = -1;
+		goto end_no_reply;
+	}
+	if (payload->data[header_len + path_len - 1] != '\0') {
+		ERR("Path name of \"relay_rotate_session_streams\" command is not NULL-terminated");
+		ret = -1;
+		goto end_no_reply;
+	}
+	positions = payload->data + header_len + path_len;
+
+	/* All the streams share the same output directory. */
+	path_name = create_output_path(payload->data + header_len);
+	if (!path_name) {
+		ERR("Failed to create a new output path");
+		ret = -1;
+		goto end;
+	}
+	ret = utils_mkdir_recursive(path_name, S_IRWXU | S_IRWXG, -1, -1);
+	if (ret < 0) {
+		ERR("relay creating output directory");
+		ret = -1;
+		goto end;
+	}
+
+	for (i = 0; i < stream_count; i++) {
+		struct lttcomm_relayd_stream_rotation_position position;
+		struct relay_stream *stream;
+		char *stream_path_name;
+
+		memcpy(&position, positions + i * sizeof(position),
+				sizeof(position));
+		stream = stream_get_by_id(be64toh(position.stream_id));
+		if (!stream) {
+			ERR("Rotate streams: unknown stream %" PRIu64,
+					(uint64_t) be64toh(position.stream_id));
+			ret = -1;
+			goto end;
 		}
 
-		ret = try_rotate_stream_index(stream);
+		stream_path_name = strdup(path_name);
+		if (!stream_path_name) {
+			PERROR("strdup stream output path");
+			stream_put(stream);
+			ret = -1;
+			goto end;
+		}
+
+		pthread_mutex_lock(&stream->lock);
+		ret = rotate_stream_output(stream, stream_path_name,
+				new_chunk_id,
+				be64toh(position.rotate_at_seq_num));
+		pthread_mutex_unlock(&stream->lock);
+		stream_put(stream);
 		if (ret < 0) {
-			goto end_stream_unlock;
+			goto end;
 		}
 	}
+	ret = 0;
 
-end_stream_unlock:
-	pthread_mutex_unlock(&stream->lock);
-	stream_put(stream);
 end:
+	free(path_name);
 	memset(&reply, 0, sizeof(reply));
 	if (ret < 0) {
 		reply.ret_code = htobe32(LTTNG_ERR_UNK);
@@ -2635,7 +2956,7 @@ end:
 	send_ret = conn->sock->ops->sendmsg(conn->sock, &reply,
 			sizeof(struct lttcomm_relayd_generic_reply), 0);
 	if (send_ret < (ssize_t) sizeof(reply)) {
-		ERR("Failed to send \"rotate session stream\" command reply (ret = %zd)",
+		ERR("Failed to send \"rotate session streams\" command reply (ret = %zd)",
 				send_ret);
 		ret = -1;
 	}
@@ -3081,6 +3402,14 @@ static int relay_process_control_command(struct relay_connection *conn,
 		DBG_CMD("RELAYD_MKDIR", conn);
 		ret = relay_mkdir(header, conn, payload);
 		break;
+	case RELAYD_SEND_BEACONS:
+		DBG_CMD("RELAYD_SEND_BEACONS", conn);
+		ret = relay_recv_beacons(header, conn, payload);
+		break;
+	case RELAYD_ROTATE_STREAMS:
+		DBG_CMD("RELAYD_ROTATE_STREAMS", conn);
+		ret = relay_rotate_session_streams(header, conn, payload);
+		break;
 	case RELAYD_UPDATE_SYNC_INFO:
 	default:
 		ERR("Received unknown command (%u)", header->cmd);
@@ -3361,7 +3690,10 @@ static int handle_index_data(struct relay_stream *stream, uint64_t net_seq_num,
 	ret = relay_index_try_flush(index);
 	if (ret == 0) {
 		tracefile_array_commit_seq(stream->tfa);
+		stream_index_cache_add(stream, stream->index_received_seqcount,
+				&index->index_data);
 		stream->index_received_seqcount++;
+		live_notify_index_ready(stream);
 		*flushed = true;
 	} else if (ret > 0) {
 		index->total_size = total_size;
@@ -3470,11 +3802,16 @@ static enum relay_connection_status relay_process_data_receive_header(
 		/* new_id is updated by utils_rotate_stream_file. */
 		new_id = old_id;
 
+		if (stream_fd_get_fd(stream->stream_fd) < 0) {
+			status = RELAY_CONNECTION_STATUS_ERROR;
+			goto end_stream_unlock;
+		}
 		ret = utils_rotate_stream_file(stream->path_name,
 				stream->channel_name, stream->tracefile_size,
 				stream->tracefile_count, -1,
 			        -1, stream->stream_fd->fd,
 				&new_id, &stream->stream_fd->fd);
+		stream_fd_put_fd(stream->stream_fd);
 		if (ret < 0) {
 			ERR("Failed to rotate stream output file");
 			status = RELAY_CONNECTION_STATUS_ERROR;
@@ -3502,6 +3839,7 @@ static enum relay_connection_status relay_process_data_receive_payload(
 	int ret;
 	enum relay_connection_status status = RELAY_CONNECTION_STATUS_OK;
 	struct relay_stream *stream;
+	struct stream_fd *stream_fd = NULL;
 	struct data_connection_state_receive_payload *state =
 			&conn->protocol.data.state.receive_payload;
 	const size_t chunk_size = RECV_DATA_BUFFER_SIZE;
@@ -3534,6 +3872,13 @@ static enum relay_connection_status relay_process_data_receive_payload(
 		}
 	}
 
+	/* The file stays open until the payload has been written. */
+	if (stream_fd_get_fd(stream->stream_fd) < 0) {
+		status = RELAY_CONNECTION_STATUS_ERROR;
+		goto end_stream_unlock;
+	}
+	stream_fd = stream->stream_fd;
+
 	/*
 	 * The size of the "chunk" received on any iteration is bounded by:
 	 *   - the data left to receive,
@@ -3652,6 +3997,9 @@ static enum relay_connection_status relay_process_data_receive_payload(
 	}
 
 end_stream_unlock:
+	if (stream_fd) {
+		stream_fd_put_fd(stream_fd);
+	}
 	close_requested = stream->close_requested;
 	pthread_mutex_unlock(&stream->lock);
 	if (close_requested && left_to_receive == 0) {
@@ -3662,6 +4010,7 @@ end_stream_unlock:
 		pthread_mutex_lock(&session->lock);
 		uatomic_set(&session->new_streams, 1);
 		pthread_mutex_unlock(&session->lock);
+		live_notify_new_streams(session);
 	}
 
 	stream_put(stream);
@@ -4045,6 +4394,32 @@ error_testpoint:
 	return NULL;
 }
 
+/*
+ * Bound the number of trace and index files kept open. Unless a pool size is
+ * specified, half of the open file descriptor limit is left to these files;
+ * the other half is used by the sockets, pipes and the files which can't be
+ * reopened by path.
+ */
+static int init_stream_fd_budget(void)
+{
+	struct rlimit rlim;
+	unsigned int budget = opt_fd_pool_size;
+
+	if (!budget) {
+		if (getrlimit(RLIMIT_NOFILE, &rlim)) {
+			PERROR("getrlimit RLIMIT_NOFILE");
+			return -1;
+		}
+		budget = rlim.rlim_cur == RLIM_INFINITY ||
+				rlim.rlim_cur / 2 > UINT_MAX ?
+				0 : (unsigned int) (rlim.rlim_cur / 2);
+	}
+
+	DBG("Stream file descriptor pool size: %u", budget);
+	stream_fd_cache_set_budget(budget);
+	return 0;
+}
+
 /*
  * Create the relay command pipe to wake thread_manage_apps.
  * Closed in cleanup().
@@ -4139,6 +4514,11 @@ int main(int argc, char **argv)
 	/* Init relay command queue. */
 	cds_wfcq_init(&relay_conn_queue.head, &relay_conn_queue.tail);
 
+	if (init_stream_fd_budget()) {
+		retval = -1;
+		goto exit_init_data;
+	}
+
 	/* Initialize communication library */
 	lttcomm_init();
 	lttcomm_inet_init();
@@ -4210,7 +4590,7 @@ int main(int argc, char **argv)
 		goto exit_listener_thread;
 	}
 
-	ret = relayd_live_create(live_uri);
+	ret = relayd_live_create(live_uri, opt_live_worker_threads);
 	if (ret) {
 		ERR("Starting live viewer threads");
 		retval = -1;
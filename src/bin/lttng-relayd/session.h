@@ -95,6 +95,13 @@ struct relay_session {
 	 */
 	unsigned long new_streams;
 
+	/*
+	 * Number of live notification connections subscribed to this
+	 * session. Read without lock by the main worker thread to skip
+	 * notifying sessions nobody is listening to.
+	 */
+	unsigned long viewer_subscribers;
+
 	/*
 	 * Node in the global session hash table.
 	 */
@@ -16,10 +16,155 @@
  */
 
 #define _LGPL_SOURCE
+#include <assert.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <common/common.h>
 
 #include "stream-fd.h"
 
+static struct stream_fd_cache {
+	pthread_mutex_t lock;
+	/* Open and unused stream files, least recently used first. */
+	struct cds_list_head lru;
+	unsigned int open_count;
+	unsigned int budget;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+} cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.lru = CDS_LIST_HEAD_INIT(cache.lru),
+};
+
+/*
+ * Close the file of an unused stream fd, saving what is needed to reopen
+ * it. Files which can't be found again by path (e.g. unlinked) are left
+ * open.
+ *
+ * Called with the cache lock held. Return 0 if the file was closed.
+ */
+static int stream_fd_evict(struct stream_fd *sf)
+{
+	int ret, flags;
+	off_t pos;
+	ssize_t len;
+	struct stat st, path_st;
+	char proc_path[sizeof("/proc/self/fd/") + 11];
+	char path[PATH_MAX];
+
+	assert(sf->fd >= 0 && !sf->users);
+
+	ret = snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d",
+			sf->fd);
+	if (ret < 0 || ret >= sizeof(proc_path)) {
+		goto error;
+	}
+	len = readlink(proc_path, path, sizeof(path) - 1);
+	if (len < 0 || len == sizeof(path) - 1) {
+		goto error;
+	}
+	path[len] = '\0';
+
+	if (fstat(sf->fd, &st) || stat(path, &path_st) ||
+			st.st_dev != path_st.st_dev ||
+			st.st_ino != path_st.st_ino) {
+		DBG("Stream file fd %d can't be reopened by path, keeping it open",
+				sf->fd);
+		goto error;
+	}
+
+	pos = lseek(sf->fd, 0, SEEK_CUR);
+	flags = fcntl(sf->fd, F_GETFL);
+	if (pos < 0 || flags < 0) {
+		goto error;
+	}
+
+	sf->path = strdup(path);
+	if (!sf->path) {
+		goto error;
+	}
+	sf->pos = pos;
+	sf->flags = flags;
+	sf->dev = st.st_dev;
+	sf->ino = st.st_ino;
+
+	ret = close(sf->fd);
+	if (ret) {
+		PERROR("Error closing stream FD %d", sf->fd);
+	}
+	sf->fd = -1;
+	cache.open_count--;
+	cache.evictions++;
+	return 0;
+
+error:
+	return -1;
+}
+
+/*
+ * Close unused files until `needed` more files can be opened within the
+ * budget, or no unused file is left.
+ *
+ * Called with the cache lock held.
+ */
+static void stream_fd_cache_make_room(unsigned int needed)
+{
+	while (cache.budget && cache.open_count + needed > cache.budget &&
+			!cds_list_empty(&cache.lru)) {
+		struct stream_fd *sf = cds_list_first_entry(&cache.lru,
+				struct stream_fd, lru_node);
+
+		/* A file which can't be closed is only tried again once used. */
+		cds_list_del_init(&sf->lru_node);
+		(void) stream_fd_evict(sf);
+	}
+}
+
+/*
+ * Reopen the file of a stream fd closed by the cache, at the position it
+ * was closed at.
+ *
+ * Called with the cache lock held.
+ */
+static int stream_fd_reopen(struct stream_fd *sf)
+{
+	int fd;
+	struct stat st;
+
+	fd = open(sf->path, sf->flags & ~(O_CREAT | O_EXCL | O_TRUNC));
+	if (fd < 0) {
+		PERROR("Error reopening stream file %s", sf->path);
+		goto error;
+	}
+	if (fstat(fd, &st) || st.st_dev != sf->dev || st.st_ino != sf->ino) {
+		ERR("Stream file %s was replaced while closed", sf->path);
+		goto error_close;
+	}
+	if (lseek(fd, sf->pos, SEEK_SET) < 0) {
+		PERROR("Error seeking in reopened stream file %s", sf->path);
+		goto error_close;
+	}
+
+	free(sf->path);
+	sf->path = NULL;
+	sf->fd = fd;
+	cache.open_count++;
+	return 0;
+
+error_close:
+	if (close(fd)) {
+		PERROR("Error closing stream FD %d", fd);
+	}
+error:
+	return -1;
+}
+
 struct stream_fd *stream_fd_create(int fd)
 {
 	struct stream_fd *sf;
@@ -30,6 +175,12 @@ struct stream_fd *stream_fd_create(int fd)
 	}
 	urcu_ref_init(&sf->ref);
 	sf->fd = fd;
+
+	pthread_mutex_lock(&cache.lock);
+	stream_fd_cache_make_room(1);
+	cache.open_count++;
+	cds_list_add_tail(&sf->lru_node, &cache.lru);
+	pthread_mutex_unlock(&cache.lock);
 end:
 	return sf;
 }
@@ -44,10 +195,18 @@ static void stream_fd_release(struct urcu_ref *ref)
 	struct stream_fd *sf = caa_container_of(ref, struct stream_fd, ref);
 	int ret;
 
-	ret = close(sf->fd);
-	if (ret) {
-		PERROR("Error closing stream FD %d", sf->fd);
+	assert(!sf->users);
+	pthread_mutex_lock(&cache.lock);
+	cds_list_del(&sf->lru_node);
+	if (sf->fd >= 0) {
+		ret = close(sf->fd);
+		if (ret) {
+			PERROR("Error closing stream FD %d", sf->fd);
+		}
+		cache.open_count--;
 	}
+	pthread_mutex_unlock(&cache.lock);
+	free(sf->path);
 	free(sf);
 }
 
@@ -55,3 +214,96 @@ void stream_fd_put(struct stream_fd *sf)
 {
 	urcu_ref_put(&sf->ref, stream_fd_release);
 }
+
+/*
+ * Mark the file of a stream fd as used, reopening it if the cache closed
+ * it. The caller may use and replace `sf->fd` until it calls
+ * stream_fd_put_fd().
+ *
+ * Return the file descriptor, or -1 if the file could not be reopened.
+ */
+int stream_fd_get_fd(struct stream_fd *sf)
+{
+	int ret;
+
+	pthread_mutex_lock(&cache.lock);
+	if (sf->fd < 0) {
+		cache.misses++;
+		stream_fd_cache_make_room(1);
+		ret = stream_fd_reopen(sf);
+		if (ret) {
+			goto end;
+		}
+	} else {
+		cache.hits++;
+		cds_list_del_init(&sf->lru_node);
+	}
+	sf->users++;
+	ret = sf->fd;
+end:
+	pthread_mutex_unlock(&cache.lock);
+	return ret;
+}
+
+void stream_fd_put_fd(struct stream_fd *sf)
+{
+	pthread_mutex_lock(&cache.lock);
+	assert(sf->users);
+	if (!--sf->users && sf->fd >= 0) {
+		cds_list_add_tail(&sf->lru_node, &cache.lru);
+		stream_fd_cache_make_room(0);
+	}
+	pthread_mutex_unlock(&cache.lock);
+}
+
+static int index_file_get_fd(void *data)
+{
+	return stream_fd_get_fd(data);
+}
+
+static void index_file_put_fd(void *data)
+{
+	stream_fd_put_fd(data);
+}
+
+static void index_file_release(void *data)
+{
+	stream_fd_put(data);
+}
+
+static const struct lttng_index_file_fd_ops index_file_fd_ops = {
+	.get_fd = index_file_get_fd,
+	.put_fd = index_file_put_fd,
+	.release = index_file_release,
+};
+
+void stream_fd_cache_add_index_file(struct lttng_index_file *index_file)
+{
+	struct stream_fd *sf;
+
+	sf = stream_fd_create(index_file->fd);
+	if (!sf) {
+		/* The file stays usable, only outside of the budget. */
+		ERR("Failed to add index file fd %d to the stream fd cache",
+				index_file->fd);
+		return;
+	}
+	lttng_index_file_set_fd_ops(index_file, &index_file_fd_ops, sf);
+}
+
+void stream_fd_cache_set_budget(unsigned int budget)
+{
+	pthread_mutex_lock(&cache.lock);
+	cache.budget = budget;
+	stream_fd_cache_make_room(0);
+	pthread_mutex_unlock(&cache.lock);
+}
+
+void stream_fd_cache_log_stats(void)
+{
+	pthread_mutex_lock(&cache.lock);
+	DBG("Stream fd cache: %u open, budget %u, %" PRIu64 " hits, %" PRIu64 " misses, %" PRIu64 " evictions",
+			cache.open_count, cache.budget, cache.hits,
+			cache.misses, cache.evictions);
+	pthread_mutex_unlock(&cache.lock);
+}
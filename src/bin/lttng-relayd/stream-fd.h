@@ -18,15 +18,53 @@
  * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <stdint.h>
+#include <sys/types.h>
+#include <urcu/list.h>
 #include <urcu/ref.h>
+#include <common/index/index.h>
 
+/*
+ * The file descriptors of the stream files, and of the index files, are kept
+ * in a cache bounded by a configurable budget. Once the budget is reached, the least recently
+ * used file that is not in use is closed and transparently reopened, at
+ * the same position, the next time it is needed.
+ *
+ * `fd` may only be used, and replaced, between stream_fd_get_fd() and
+ * stream_fd_put_fd().
+ */
 struct stream_fd {
+	/* -1 while the file is closed by the cache. */
 	int fd;
 	struct urcu_ref ref;
+	/* Number of users between stream_fd_get_fd() and stream_fd_put_fd(). */
+	unsigned int users;
+	/* Node in the cache's LRU list while the file is open and unused. */
+	struct cds_list_head lru_node;
+	/* State needed to reopen the file, set when it is closed. */
+	char *path;
+	int flags;
+	off_t pos;
+	dev_t dev;
+	ino_t ino;
 };
 
 struct stream_fd *stream_fd_create(int fd);
 void stream_fd_get(struct stream_fd *sf);
 void stream_fd_put(struct stream_fd *sf);
 
+int stream_fd_get_fd(struct stream_fd *sf);
+void stream_fd_put_fd(struct stream_fd *sf);
+
+/*
+ * Put the file descriptor of an index file in the cache, under the same
+ * budget as the stream files. Its users must bracket their direct uses of
+ * the descriptor with lttng_index_file_get_fd() and lttng_index_file_put_fd().
+ */
+void stream_fd_cache_add_index_file(struct lttng_index_file *index_file);
+
+/* A budget of 0 means no limit. */
+void stream_fd_cache_set_budget(unsigned int budget);
+void stream_fd_cache_log_stats(void);
+
 #endif /* _STREAM_FD_H */
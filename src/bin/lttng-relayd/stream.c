@@ -28,6 +28,7 @@
 #include "index.h"
 #include "stream.h"
 #include "viewer-stream.h"
+#include "live.h"
 
 /* Should be called with RCU read-side lock held. */
 bool stream_get(struct relay_stream *stream)
@@ -220,6 +221,59 @@ unlock:
 	pthread_mutex_unlock(&stream->lock);
 }
 
+/*
+ * Keep a copy of a flushed index in the stream's index cache. "seq" is the
+ * tag of the index, i.e. the value of index_received_seqcount before it is
+ * incremented for this index. Only live streams have an index cache.
+ *
+ * Called with the stream lock held.
+ */
+void stream_index_cache_add(struct relay_stream *stream, uint64_t seq,
+		const struct ctf_packet_index *index)
+{
+	if (!stream->trace->session->live_timer || stream->is_metadata) {
+		return;
+	}
+
+	if (!stream->index_cache) {
+		stream->index_cache = zmalloc(DEFAULT_LIVE_INDEX_CACHE_SIZE *
+				sizeof(*stream->index_cache));
+		if (!stream->index_cache) {
+			/* Not fatal, viewers read the index file instead. */
+			PERROR("zmalloc stream index cache");
+			return;
+		}
+		stream->index_cache_first_seq = seq;
+	}
+	memcpy(&stream->index_cache[seq % DEFAULT_LIVE_INDEX_CACHE_SIZE],
+			index, sizeof(*index));
+}
+
+/*
+ * Get the index tagged "seq" from the stream's index cache.
+ *
+ * Return 0 on success, -ENOENT if the index is not (or no longer) cached.
+ *
+ * Called with the stream lock held.
+ */
+int stream_index_cache_get(struct relay_stream *stream, uint64_t seq,
+		struct ctf_packet_index *index)
+{
+	uint64_t received = stream->index_received_seqcount;
+
+	if (!stream->index_cache || seq < stream->index_cache_first_seq ||
+			seq >= received) {
+		return -ENOENT;
+	}
+	if (received - seq > DEFAULT_LIVE_INDEX_CACHE_SIZE) {
+		/* Overwritten by a more recent index. */
+		return -ENOENT;
+	}
+	memcpy(index, &stream->index_cache[seq % DEFAULT_LIVE_INDEX_CACHE_SIZE],
+			sizeof(*index));
+	return 0;
+}
+
 /*
  * Stream must be protected by holding the stream lock or by virtue of being
  * called from stream_destroy.
@@ -256,6 +310,7 @@ static void stream_destroy(struct relay_stream *stream)
 	if (stream->tfa) {
 		tracefile_array_destroy(stream->tfa);
 	}
+	free(stream->index_cache);
 	free(stream->path_name);
 	free(stream->prev_path_name);
 	free(stream->channel_name);
@@ -409,6 +464,8 @@ void try_stream_close(struct relay_stream *stream)
 	stream->closed = true;
 	/* Relay indexes are only used by the "consumer/sessiond" end. */
 	relay_index_close_all(stream);
+	/* Subscribed viewers will get a hang up on their next index request. */
+	live_notify_index_ready(stream);
 	pthread_mutex_unlock(&stream->lock);
 	DBG("Succeeded in closing stream %" PRIu64, stream->stream_handle);
 	stream_put(stream);
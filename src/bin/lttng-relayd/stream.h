@@ -26,6 +26,7 @@
 #include <urcu/list.h>
 
 #include <common/hashtable/hashtable.h>
+#include <common/index/ctf-index.h>
 
 #include "session.h"
 #include "stream-fd.h"
@@ -107,6 +108,17 @@ struct relay_stream {
 	 */
 	struct tracefile_array *tfa;
 
+	/*
+	 * Ring of the most recently flushed indexes of a live stream, kept
+	 * in their on-disk (big endian) format so live viewers can get them
+	 * without reading the index file back. The index tagged "seq" is
+	 * stored at seq % DEFAULT_LIVE_INDEX_CACHE_SIZE. NULL until the first
+	 * index of a live session is flushed. Protected by the stream lock.
+	 */
+	struct ctf_packet_index *index_cache;
+	/* Tag of the first index added to index_cache. */
+	uint64_t index_cache_first_seq;
+
 	bool closed;		/* Stream is closed. */
 	bool close_requested;	/* Close command has been received. */
 
@@ -198,6 +210,10 @@ bool stream_get(struct relay_stream *stream);
 void stream_put(struct relay_stream *stream);
 void try_stream_close(struct relay_stream *stream);
 void stream_publish(struct relay_stream *stream);
+void stream_index_cache_add(struct relay_stream *stream, uint64_t seq,
+		const struct ctf_packet_index *index);
+int stream_index_cache_get(struct relay_stream *stream, uint64_t seq,
+		struct ctf_packet_index *index);
 void print_relay_streams(void);
 
 #endif /* _STREAM_H */
@@ -137,6 +137,26 @@ uint64_t tracefile_array_get_seq_tail(struct tracefile_array *tfa)
 	return tfa->seq_tail;
 }
 
+uint64_t tracefile_array_get_file_seq_head(struct tracefile_array *tfa,
+		uint64_t file_index)
+{
+	if (!tfa->count) {
+		return tfa->seq_head;
+	}
+	assert(file_index < tfa->count);
+	return tfa->tf[file_index].seq_head;
+}
+
+uint64_t tracefile_array_get_file_seq_tail(struct tracefile_array *tfa,
+		uint64_t file_index)
+{
+	if (!tfa->count) {
+		return tfa->seq_tail;
+	}
+	assert(file_index < tfa->count);
+	return tfa->tf[file_index].seq_tail;
+}
+
 bool tracefile_array_seq_in_file(struct tracefile_array *tfa,
 		uint64_t file_index, uint64_t seq)
 {
@@ -59,6 +59,15 @@ uint64_t tracefile_array_get_file_index_tail(struct tracefile_array *tfa);
 /* May return -1ULL in the case where we have not received any indexes yet. */
 uint64_t tracefile_array_get_seq_tail(struct tracefile_array *tfa);
 
+/*
+ * Newest/oldest seqcount held by a given trace file. May return -1ULL if the
+ * file does not hold any index yet.
+ */
+uint64_t tracefile_array_get_file_seq_head(struct tracefile_array *tfa,
+		uint64_t file_index);
+uint64_t tracefile_array_get_file_seq_tail(struct tracefile_array *tfa,
+		uint64_t file_index);
+
 bool tracefile_array_seq_in_file(struct tracefile_array *tfa,
 		uint64_t file_index, uint64_t seq);
 
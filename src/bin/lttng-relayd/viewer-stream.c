@@ -21,9 +21,11 @@
 #include <common/common.h>
 #include <common/index/index.h>
 #include <common/compat/string.h>
+#include <common/compat/endian.h>
 
 #include "lttng-relayd.h"
 #include "viewer-stream.h"
+#include "index.h"
 
 static void viewer_stream_destroy(struct relay_viewer_stream *vstream)
 {
@@ -118,7 +120,7 @@ struct relay_viewer_stream *viewer_stream_create(struct relay_stream *stream,
 	if (stream->index_received_seqcount == 0) {
 		vstream->index_file = NULL;
 	} else {
-		vstream->index_file = lttng_index_file_open(vstream->path_name,
+		vstream->index_file = relay_index_file_open(vstream->path_name,
 				vstream->channel_name,
 				stream->tracefile_count,
 				vstream->current_tracefile_id);
@@ -128,9 +130,15 @@ struct relay_viewer_stream *viewer_stream_create(struct relay_stream *stream,
 	}
 
 	if (seek_t == LTTNG_VIEWER_SEEK_LAST && vstream->index_file) {
+		int fd;
 		off_t lseek_ret;
 
-		lseek_ret = lseek(vstream->index_file->fd, 0, SEEK_END);
+		fd = lttng_index_file_get_fd(vstream->index_file);
+		if (fd < 0) {
+			goto error_unlock;
+		}
+		lseek_ret = lseek(fd, 0, SEEK_END);
+		lttng_index_file_put_fd(vstream->index_file);
 		if (lseek_ret < 0) {
 			goto error_unlock;
 		}
@@ -294,7 +302,7 @@ int viewer_stream_rotate(struct relay_viewer_stream *vstream)
 		vstream->stream_fd = NULL;
 	}
 
-	vstream->index_file = lttng_index_file_open(vstream->path_name,
+	vstream->index_file = relay_index_file_open(vstream->path_name,
 			vstream->channel_name,
 			stream->tracefile_count,
 			vstream->current_tracefile_id);
@@ -308,6 +316,131 @@ end:
 	return ret;
 }
 
+/*
+ * Seek a viewer stream to the first packet whose end timestamp is at or after
+ * "timestamp". If every packet available on disk ends before "timestamp",
+ * the viewer stream is positioned after the last index, awaiting future
+ * packets.
+ *
+ * The trace files are scanned from the oldest to the newest, and only the
+ * index file containing the target is binary searched.
+ *
+ * Must be called with the rstream lock held.
+ * Returns 0 on success, a negative value on error.
+ */
+int viewer_stream_seek_timestamp(struct relay_viewer_stream *vstream,
+		uint64_t timestamp)
+{
+	int ret = 0;
+	struct relay_stream *stream = vstream->stream;
+	uint64_t nr_files, file_index, i;
+
+	if (stream->is_metadata || stream->index_received_seqcount == 0) {
+		/* Nothing to skip. */
+		goto end;
+	}
+
+	nr_files = stream->tracefile_count ? stream->tracefile_count : 1;
+	file_index = tracefile_array_get_file_index_tail(stream->tfa);
+	for (i = 0; i < nr_files; i++,
+			file_index = (file_index + 1) % nr_files) {
+		struct lttng_index_file *index_file;
+		uint64_t seq_head, seq_tail, pos;
+
+		seq_head = tracefile_array_get_file_seq_head(stream->tfa,
+				file_index);
+		seq_tail = tracefile_array_get_file_seq_tail(stream->tfa,
+				file_index);
+		if (seq_head == -1ULL || seq_tail == -1ULL) {
+			continue;
+		}
+
+		index_file = relay_index_file_open(vstream->path_name,
+				vstream->channel_name, stream->tracefile_count,
+				file_index);
+		if (!index_file) {
+			ret = -1;
+			goto end;
+		}
+		ret = lttng_index_file_find_timestamp(index_file,
+				seq_head - seq_tail + 1, timestamp, &pos);
+		if (ret) {
+			lttng_index_file_put(index_file);
+			goto end;
+		}
+		if (pos > seq_head - seq_tail) {
+			/* Every packet of this file ends before the target. */
+			lttng_index_file_put(index_file);
+			continue;
+		}
+		ret = lttng_index_file_seek(index_file, pos);
+		if (ret) {
+			lttng_index_file_put(index_file);
+			goto end;
+		}
+
+		DBG("Viewer stream %" PRIu64 " seeked to timestamp %" PRIu64
+				" (tracefile %" PRIu64 ", index %" PRIu64 ")",
+				stream->stream_handle, timestamp, file_index,
+				seq_tail + pos);
+		if (vstream->index_file) {
+			lttng_index_file_put(vstream->index_file);
+		}
+		vstream->index_file = index_file;
+		if (vstream->stream_fd) {
+			stream_fd_put(vstream->stream_fd);
+			vstream->stream_fd = NULL;
+		}
+		vstream->current_tracefile_id = file_index;
+		vstream->index_sent_seqcount = seq_tail + pos;
+		goto end;
+	}
+
+	/*
+	 * All the packets on disk end before the target: wait for the next
+	 * one, as with LTTNG_VIEWER_SEEK_LAST.
+	 */
+	if (vstream->current_tracefile_id !=
+			tracefile_array_get_file_index_head(stream->tfa)) {
+		if (vstream->index_file) {
+			lttng_index_file_put(vstream->index_file);
+		}
+		vstream->current_tracefile_id =
+				tracefile_array_get_file_index_head(stream->tfa);
+		vstream->index_file = relay_index_file_open(vstream->path_name,
+				vstream->channel_name, stream->tracefile_count,
+				vstream->current_tracefile_id);
+		if (!vstream->index_file) {
+			ret = -1;
+			goto end;
+		}
+		if (vstream->stream_fd) {
+			stream_fd_put(vstream->stream_fd);
+			vstream->stream_fd = NULL;
+		}
+	}
+	vstream->index_sent_seqcount =
+			tracefile_array_get_seq_head(stream->tfa) + 1;
+	if (vstream->index_file) {
+		int fd;
+		off_t lseek_ret;
+
+		fd = lttng_index_file_get_fd(vstream->index_file);
+		if (fd < 0) {
+			ret = -1;
+			goto end;
+		}
+		lseek_ret = lseek(fd, 0, SEEK_END);
+		lttng_index_file_put_fd(vstream->index_file);
+		if (lseek_ret < 0) {
+			ret = -1;
+			goto end;
+		}
+	}
+end:
+	return ret;
+}
+
 void print_viewer_streams(void)
 {
 	struct lttng_ht_iter iter;
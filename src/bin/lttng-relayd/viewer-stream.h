@@ -84,6 +84,8 @@ struct relay_viewer_stream *viewer_stream_get_by_id(uint64_t id);
 bool viewer_stream_get(struct relay_viewer_stream *vstream);
 void viewer_stream_put(struct relay_viewer_stream *vstream);
 int viewer_stream_rotate(struct relay_viewer_stream *vstream);
+int viewer_stream_seek_timestamp(struct relay_viewer_stream *vstream,
+		uint64_t timestamp);
 bool viewer_stream_is_tracefile_seq_readable(struct relay_viewer_stream *vstream,
 		uint64_t seq);
 void print_viewer_streams(void);
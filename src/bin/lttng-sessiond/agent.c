@@ -208,6 +208,7 @@ static void destroy_app_agent_rcu(struct rcu_head *head)
 	struct agent_app *app =
 		caa_container_of(node, struct agent_app, node);
 
+	pthread_mutex_destroy(&app->lock);
 	free(app);
 }
 
@@ -685,7 +686,9 @@ int agent_enable_event(struct agent_event *event,
 		}
 
 		/* Enable event on agent application through TCP socket. */
+		pthread_mutex_lock(&app->lock);
 		ret = enable_event(app, event);
+		pthread_mutex_unlock(&app->lock);
 		if (ret != LTTNG_OK) {
 			goto error;
 		}
@@ -768,7 +771,9 @@ int agent_enable_context(struct lttng_event_context *ctx,
 		}
 
 		/* Enable event on agent application through TCP socket. */
+		pthread_mutex_lock(&app->lock);
 		ret = app_context_op(app, agent_ctx, AGENT_CMD_APP_CTX_ENABLE);
+		pthread_mutex_unlock(&app->lock);
 		destroy_app_ctx(agent_ctx);
 		if (ret != LTTNG_OK) {
 			goto error_unlock;
@@ -810,7 +815,9 @@ int agent_disable_event(struct agent_event *event,
 		}
 
 		/* Enable event on agent application through TCP socket. */
+		pthread_mutex_lock(&app->lock);
 		ret = disable_event(app, event);
+		pthread_mutex_unlock(&app->lock);
 		if (ret != LTTNG_OK) {
 			goto error;
 		}
@@ -847,7 +854,9 @@ int disable_context(struct agent_app_ctx *ctx, enum lttng_domain_type domain)
 			continue;
 		}
 
+		pthread_mutex_lock(&app->lock);
 		ret = app_context_op(app, ctx, AGENT_CMD_APP_CTX_DISABLE);
+		pthread_mutex_unlock(&app->lock);
 		if (ret != LTTNG_OK) {
 			goto end;
 		}
@@ -895,7 +904,9 @@ int agent_list_events(struct lttng_event **events,
 			continue;
 		}
 
+		pthread_mutex_lock(&app->lock);
 		nb_ev = list_events(app, &agent_events);
+		pthread_mutex_unlock(&app->lock);
 		if (nb_ev < 0) {
 			ret = nb_ev;
 			goto error_unlock;
@@ -962,6 +973,7 @@ struct agent_app *agent_create_app(pid_t pid, enum lttng_domain_type domain,
 	app->pid = pid;
 	app->domain = domain;
 	app->sock = sock;
+	pthread_mutex_init(&app->lock, NULL);
 	lttng_ht_node_init_ulong(&app->node, (unsigned long) app->sock->fd);
 
 error:
@@ -1437,7 +1449,9 @@ void agent_update(struct agent *agt, int sock)
 			continue;
 		}
 
+		pthread_mutex_lock(&app->lock);
 		ret = enable_event(app, event);
+		pthread_mutex_unlock(&app->lock);
 		if (ret != LTTNG_OK) {
 			DBG2("Agent update unable to enable event %s on app pid: %d sock %d",
 					event->name, app->pid, app->sock->fd);
@@ -1447,7 +1461,9 @@ void agent_update(struct agent *agt, int sock)
 	}
 
 	cds_list_for_each_entry_rcu(ctx, &agt->app_ctx_list, list_node) {
+		pthread_mutex_lock(&app->lock);
 		ret = app_context_op(app, ctx, AGENT_CMD_APP_CTX_ENABLE);
+		pthread_mutex_unlock(&app->lock);
 		if (ret != LTTNG_OK) {
 			DBG2("Agent update unable to add application context %s:%s on app pid: %d sock %d",
 					ctx->provider_name, ctx->ctx_name,
@@ -20,6 +20,7 @@
 #define LTTNG_SESSIOND_AGENT_H
 
 #include <inttypes.h>
+#include <pthread.h>
 
 #include <common/hashtable/hashtable.h>
 #include <lttng/lttng.h>
@@ -72,6 +73,12 @@ struct agent_app {
 	 */
 	struct lttcomm_sock *sock;
 
+	/*
+	 * Serializes the command/reply exchanges on sock. Commands on
+	 * different sessions can talk to the same application concurrently.
+	 */
+	pthread_mutex_t lock;
+
 	/* Initialized with the AGENT sock value. */
 	struct lttng_ht_node_ulong node;
 };
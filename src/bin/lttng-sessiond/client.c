@@ -21,6 +21,7 @@
 #include <pthread.h>
 #include <signal.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <common/compat/getenv.h>
 #include <common/unix.h>
 #include <common/utils.h>
@@ -41,6 +42,29 @@
 
 static bool is_root;
 
+/*
+ * Client commands are processed by a pool of worker threads. The client
+ * thread accepts the connections and hands them over to the workers through
+ * sock_pipe; the first idle worker picks the connection.
+ *
+ * Connections that asked to be kept open are handed back to the client
+ * thread through idle_pipe once their command is replied to. The client
+ * thread monitors them and hands them over to a worker again when the next
+ * command arrives, so that an idle connection never holds a worker.
+ */
+static struct client_workers {
+	int sock_pipe[2];
+	int idle_pipe[2];
+	/* Read side of the client thread's quit pipe, shared with the workers. */
+	int thread_quit_pipe_fd;
+	pthread_t *threads;
+	unsigned int count;
+} client_workers = {
+	.sock_pipe = { -1, -1 },
+	.idle_pipe = { -1, -1 },
+	.thread_quit_pipe_fd = -1,
+};
+
 static struct thread_state {
 	sem_t ready;
 	bool running;
@@ -97,6 +121,7 @@ static int setup_lttng_msg(struct command_ctx *cmd_ctx,
 	cmd_ctx->llm->pid = cmd_ctx->lsm->domain.attr.pid;
 	cmd_ctx->llm->cmd_header_size = cmd_header_len;
 	cmd_ctx->llm->data_size = payload_len;
+	cmd_ctx->llm->correlation_id = cmd_ctx->lsm->correlation_id;
 	cmd_ctx->lttng_msg_size = total_msg_size;
 
 	/* Copy command header */
@@ -509,6 +534,8 @@ error_create:
 
 /*
  * Count number of session permitted by uid/gid.
+ *
+ * The session list lock must be held.
  */
 static unsigned int lttng_sessions_count(uid_t uid, gid_t gid)
 {
@@ -522,13 +549,15 @@ static unsigned int lttng_sessions_count(uid_t uid, gid_t gid)
 		if (!session_get(session)) {
 			continue;
 		}
-		session_lock(session);
-		/* Only count the sessions the user can control. */
+		/*
+		 * Only count the sessions the user can control. The session
+		 * lock is not taken: the credentials of a session never change
+		 * and it is only destroyed with the session list lock held.
+		 */
 		if (session_access_ok(session, uid, gid) &&
 				!session->destroyed) {
 			i++;
 		}
-		session_unlock(session);
 		session_put(session);
 	}
 	return i;
@@ -640,6 +669,120 @@ error:
 	return ret;
 }
 
+/*
+ * Receive an event of a LTTNG_ENABLE_EVENT_BATCH command along with its
+ * exclusions, filter expression and filter bytecode.
+ *
+ * Return LTTNG_OK on success else a lttng_error_code.
+ */
+static int receive_event_batch_entry(int sock,
+		struct cmd_event_batch_entry *entry, int *sock_error)
+{
+	int ret;
+	struct lttcomm_event_batch_entry header;
+	struct lttng_event_exclusion *exclusion = NULL;
+	struct lttng_filter_bytecode *bytecode = NULL;
+	char *filter_expression = NULL;
+
+	ret = lttcomm_recv_unix_sock(sock, &header, sizeof(header));
+	if (ret <= 0) {
+		DBG("Nothing recv() from client event batch... continuing");
+		*sock_error = 1;
+		ret = LTTNG_ERR_INVALID;
+		goto error;
+	}
+
+	if (header.exclusion_count > 0) {
+		size_t count = header.exclusion_count;
+
+		exclusion = zmalloc(sizeof(struct lttng_event_exclusion) +
+				(count * LTTNG_SYMBOL_NAME_LEN));
+		if (!exclusion) {
+			ret = LTTNG_ERR_EXCLUSION_NOMEM;
+			goto error;
+		}
+
+		exclusion->count = count;
+		ret = lttcomm_recv_unix_sock(sock, exclusion->names,
+				count * LTTNG_SYMBOL_NAME_LEN);
+		if (ret <= 0) {
+			*sock_error = 1;
+			ret = LTTNG_ERR_EXCLUSION_INVAL;
+			goto error;
+		}
+	}
+
+	if (header.expression_len > 0) {
+		if (header.expression_len > LTTNG_FILTER_MAX_LEN) {
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+
+		filter_expression = zmalloc(header.expression_len);
+		if (!filter_expression) {
+			ret = LTTNG_ERR_FILTER_NOMEM;
+			goto error;
+		}
+
+		ret = lttcomm_recv_unix_sock(sock, filter_expression,
+				header.expression_len);
+		if (ret <= 0) {
+			*sock_error = 1;
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+	}
+
+	if (header.bytecode_len > 0) {
+		if (header.bytecode_len > LTTNG_FILTER_MAX_LEN) {
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+
+		bytecode = zmalloc(header.bytecode_len);
+		if (!bytecode) {
+			ret = LTTNG_ERR_FILTER_NOMEM;
+			goto error;
+		}
+
+		ret = lttcomm_recv_unix_sock(sock, bytecode,
+				header.bytecode_len);
+		if (ret <= 0) {
+			*sock_error = 1;
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+
+		if ((bytecode->len + sizeof(*bytecode)) !=
+				header.bytecode_len) {
+			ret = LTTNG_ERR_FILTER_INVAL;
+			goto error;
+		}
+	}
+
+	/* A filter always comes with its expression. */
+	if (!!filter_expression ^ !!bytecode) {
+		ret = LTTNG_ERR_FILTER_INVAL;
+		goto error;
+	}
+
+	entry->event = lttng_event_copy(&header.event);
+	if (!entry->event) {
+		ret = LTTNG_ERR_NOMEM;
+		goto error;
+	}
+	entry->filter_expression = filter_expression;
+	entry->filter = bytecode;
+	entry->exclusion = exclusion;
+	return LTTNG_OK;
+
+error:
+	free(filter_expression);
+	free(bytecode);
+	free(exclusion);
+	return ret;
+}
+
 /*
  * Version of setup_lttng_msg() without command header.
  */
@@ -698,6 +841,51 @@ static int send_unix_sock(int sock, void *buf, size_t len)
 	return lttcomm_send_unix_sock(sock, buf, len);
 }
 
+/*
+ * Return true if the command must run with the session list lock held for
+ * its whole execution. Other commands only hold it while looking up their
+ * session and setting up its domain, and then rely on the session lock and
+ * their reference to the session, so that commands on unrelated sessions and
+ * session listings can proceed concurrently.
+ *
+ * Destroying a session changes what session lookups and listings see, which
+ * they expect to be stable while they hold the session list lock.
+ */
+static bool command_needs_session_list_lock(enum lttcomm_sessiond_command cmd)
+{
+	switch (cmd) {
+	case LTTNG_DESTROY_SESSION:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Return true if the command can change the state of its session that is
+ * saved in a session configuration.
+ */
+static bool command_changes_session_config(enum lttcomm_sessiond_command cmd)
+{
+	switch (cmd) {
+	case LTTNG_LIST_DOMAINS:
+	case LTTNG_LIST_CHANNELS:
+	case LTTNG_LIST_EVENTS:
+	case LTTNG_LIST_TRACKER_PIDS:
+	case LTTNG_DATA_PENDING:
+	case LTTNG_SNAPSHOT_LIST_OUTPUT:
+	case LTTNG_SNAPSHOT_RECORD:
+	case LTTNG_REGENERATE_METADATA:
+	case LTTNG_REGENERATE_STATEDUMP:
+	case LTTNG_ROTATE_SESSION:
+	case LTTNG_ROTATION_GET_INFO:
+	case LTTNG_SESSION_LIST_ROTATION_SCHEDULES:
+		return false;
+	default:
+		return true;
+	}
+}
+
 /*
  * Process the command requested by the lttng client within the command
  * context structure. This function make sure that the return structure (llm)
@@ -715,6 +903,7 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int sock,
 	int ret = LTTNG_OK;
 	int need_tracing_session = 1;
 	int need_domain;
+	bool session_list_locked = false;
 
 	DBG("Processing client command %d", cmd_ctx->lsm->cmd_type);
 
@@ -789,6 +978,7 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int sock,
 	case LTTNG_ROTATE_SESSION:
 	case LTTNG_ROTATION_GET_INFO:
 	case LTTNG_SESSION_LIST_ROTATION_SCHEDULES:
+	case LTTNG_ENABLE_EVENT_BATCH:
 		break;
 	default:
 		/* Setup lttng message with no payload */
@@ -814,11 +1004,12 @@ static int process_client_msg(struct command_ctx *cmd_ctx, int sock,
 	default:
 		DBG("Getting session %s by name", cmd_ctx->lsm->session.name);
 		/*
-		 * We keep the session list lock across _all_ commands
-		 * for now, because the per-session lock does not
-		 * handle teardown properly.
+		 * The session list lock is kept across the lookup and the
+		 * domain setup below, and then for the whole command unless
+		 * command_needs_session_list_lock() says otherwise.
 		 */
 		session_lock_list();
+		session_list_locked = true;
 		cmd_ctx->session = session_find_by_name(cmd_ctx->lsm->session.name);
 		if (cmd_ctx->session == NULL) {
 			ret = LTTNG_ERR_SESS_NOT_FOUND;
@@ -1067,6 +1258,26 @@ skip_domain:
 		}
 	}
 
+	/*
+	 * The session is locked and referenced: commands that don't need the
+	 * session list lock release it so that commands on other sessions and
+	 * session listings can proceed.
+	 */
+	if (session_list_locked &&
+			!command_needs_session_list_lock(cmd_ctx->lsm->cmd_type)) {
+		session_unlock_list();
+		session_list_locked = false;
+	}
+
+	/*
+	 * Commands can fail after partially applying a change: the generation
+	 * is bumped whatever their outcome.
+	 */
+	if (cmd_ctx->session &&
+			command_changes_session_config(cmd_ctx->lsm->cmd_type)) {
+		cmd_ctx->session->config_generation++;
+	}
+
 	/* Process by command type */
 	switch (cmd_ctx->lsm->cmd_type) {
 	case LTTNG_ADD_CONTEXT:
@@ -1341,6 +1552,71 @@ error_add_context:
 		lttng_event_destroy(ev);
 		break;
 	}
+	case LTTNG_ENABLE_EVENT_BATCH:
+	{
+		const size_t count = cmd_ctx->lsm->u.enable_batch.count;
+		struct cmd_event_batch_entry *entries = NULL;
+		uint32_t *ret_codes = NULL;
+		size_t i, received;
+
+		if (count == 0 || count > LTTCOMM_ENABLE_EVENT_BATCH_MAX_COUNT) {
+			ret = LTTNG_ERR_INVALID;
+			goto error;
+		}
+
+		entries = zmalloc(count * sizeof(*entries));
+		ret_codes = zmalloc(count * sizeof(*ret_codes));
+		if (!entries || !ret_codes) {
+			free(entries);
+			free(ret_codes);
+			ret = LTTNG_ERR_NOMEM;
+			goto error;
+		}
+
+		/*
+		 * Receive the whole batch first; the events are then enabled
+		 * under the session lock taken once for the command.
+		 */
+		DBG("Receiving batch of %zu event(s) from client ...", count);
+		ret = LTTNG_OK;
+		for (received = 0; received < count; received++) {
+			ret = receive_event_batch_entry(sock,
+					&entries[received], sock_error);
+			if (ret != LTTNG_OK) {
+				break;
+			}
+		}
+
+		if (ret == LTTNG_OK) {
+			ret = cmd_enable_events(cmd_ctx->session,
+					&cmd_ctx->lsm->domain,
+					cmd_ctx->lsm->u.enable_batch.channel_name,
+					entries, count, ret_codes,
+					kernel_poll_pipe[1]);
+		}
+
+		for (i = 0; i < received; i++) {
+			free(entries[i].filter_expression);
+			free(entries[i].filter);
+			free(entries[i].exclusion);
+			lttng_event_destroy(entries[i].event);
+		}
+		free(entries);
+		if (ret != LTTNG_OK) {
+			free(ret_codes);
+			goto error;
+		}
+
+		ret = setup_lttng_msg_no_cmd_header(cmd_ctx, ret_codes,
+				count * sizeof(*ret_codes));
+		free(ret_codes);
+		if (ret < 0) {
+			goto setup_error;
+		}
+
+		ret = LTTNG_OK;
+		break;
+	}
 	case LTTNG_LIST_TRACEPOINTS:
 	{
 		struct lttng_event *events;
@@ -1933,9 +2209,18 @@ error:
 setup_error:
 	if (cmd_ctx->session) {
 		session_unlock(cmd_ctx->session);
+		/*
+		 * session_put() requires the session list lock. Respect the
+		 * list -> session lock ordering by releasing the session lock
+		 * first.
+		 */
+		if (!session_list_locked) {
+			session_lock_list();
+			session_list_locked = true;
+		}
 		session_put(cmd_ctx->session);
 	}
-	if (need_tracing_session) {
+	if (session_list_locked) {
 		session_unlock_list();
 	}
 init_setup_error:
@@ -1978,6 +2263,402 @@ end:
 	return ret;
 }
 
+/*
+ * Receive, process and reply to the command of a client connection.
+ *
+ * The connection is closed unless the client asked for it to be kept open
+ * and the reply was sent successfully, in which case keep_connection is set
+ * and the caller owns the socket.
+ *
+ * Return 0 on success or a negative value on a fatal error (e.g. memory
+ * exhaustion).
+ */
+static int handle_client(int sock, bool *keep_connection)
+{
+	int ret, sock_error;
+	struct command_ctx *cmd_ctx = NULL;
+	const struct cmd_completion_handler *cmd_completion_handler;
+
+	/* Allocate context command to process the client request */
+	cmd_ctx = zmalloc(sizeof(struct command_ctx));
+	if (cmd_ctx == NULL) {
+		PERROR("zmalloc cmd_ctx");
+		ret = -1;
+		goto end;
+	}
+
+	/* Allocate data buffer for reception */
+	cmd_ctx->lsm = zmalloc(sizeof(struct lttcomm_session_msg));
+	if (cmd_ctx->lsm == NULL) {
+		PERROR("zmalloc cmd_ctx->lsm");
+		ret = -1;
+		goto end;
+	}
+
+	cmd_ctx->llm = NULL;
+	cmd_ctx->session = NULL;
+	*keep_connection = false;
+
+	health_code_update();
+
+	/*
+	 * Data is received from the lttng client. The struct
+	 * lttcomm_session_msg (lsm) contains the command and data request of
+	 * the client.
+	 */
+	DBG("Receiving data from client ...");
+	ret = lttcomm_recv_creds_unix_sock(sock, cmd_ctx->lsm,
+			sizeof(struct lttcomm_session_msg), &cmd_ctx->creds);
+	if (ret <= 0) {
+		DBG("Nothing recv() from client... continuing");
+		ret = 0;
+		goto end;
+	}
+
+	health_code_update();
+
+	// TODO: Validate cmd_ctx including sanity check for
+	// security purpose.
+
+	rcu_thread_online();
+	/*
+	 * This function dispatch the work to the kernel or userspace tracer
+	 * libs and fill the lttcomm_lttng_msg data structure of all the needed
+	 * informations for the client. The command context struct contains
+	 * everything this function may needs.
+	 */
+	ret = process_client_msg(cmd_ctx, sock, &sock_error);
+	rcu_thread_offline();
+	if (ret < 0) {
+		/*
+		 * TODO: Inform client somehow of the fatal error. At
+		 * this point, ret < 0 means that a zmalloc failed
+		 * (ENOMEM). Error detected but still accept
+		 * command, unless a socket error has been
+		 * detected.
+		 */
+		ret = 0;
+		goto end;
+	}
+
+	cmd_completion_handler = cmd_pop_completion_handler();
+	if (cmd_completion_handler) {
+		enum lttng_error_code completion_code;
+
+		completion_code = cmd_completion_handler->run(
+				cmd_completion_handler->data);
+		if (completion_code != LTTNG_OK) {
+			ret = 0;
+			goto end;
+		}
+	}
+
+	health_code_update();
+
+	DBG("Sending response (size: %d, retcode: %s (%d))",
+			cmd_ctx->lttng_msg_size,
+			lttng_strerror(-cmd_ctx->llm->ret_code),
+			cmd_ctx->llm->ret_code);
+	ret = send_unix_sock(sock, cmd_ctx->llm, cmd_ctx->lttng_msg_size);
+	if (ret < 0) {
+		ERR("Failed to send data back to client");
+	} else if ((cmd_ctx->lsm->flags &
+				LTTCOMM_SESSION_MSG_FLAG_KEEP_CONNECTION) &&
+			cmd_ctx->llm->ret_code == LTTNG_OK) {
+		/*
+		 * A failed command may have left part of its variable-length
+		 * data unread on the socket; only reuse the connection of a
+		 * successful command.
+		 */
+		*keep_connection = true;
+	}
+	ret = 0;
+
+end:
+	/* End of transmission */
+	if (!*keep_connection && close(sock)) {
+		PERROR("close");
+	}
+	clean_command_ctx(&cmd_ctx);
+	return ret;
+}
+
+/*
+ * Client command worker thread.
+ *
+ * Picks the client connections accepted by the client thread and processes
+ * their command. Many workers run concurrently; the session list and session
+ * locks serialize the commands that touch the same state.
+ */
+static void *thread_client_worker(void *data)
+{
+	int ret, i, pollfd, err = -1;
+	uint32_t revents, nb_fd;
+	struct lttng_poll_event events;
+	const int thread_quit_pipe_fd = client_workers.thread_quit_pipe_fd;
+
+	DBG("[thread] Client command worker started");
+
+	rcu_register_thread();
+
+	health_register(health_sessiond, HEALTH_SESSIOND_TYPE_CMD);
+
+	health_code_update();
+
+	ret = lttng_poll_create(&events, 2, LTTNG_CLOEXEC);
+	if (ret < 0) {
+		goto error_create_poll;
+	}
+
+	ret = lttng_poll_add(&events, client_workers.sock_pipe[0],
+			LPOLLIN | LPOLLERR);
+	if (ret < 0) {
+		goto error;
+	}
+
+	ret = lttng_poll_add(&events, thread_quit_pipe_fd, LPOLLIN | LPOLLERR);
+	if (ret < 0) {
+		goto error;
+	}
+
+	while (1) {
+		DBG3("Client command worker polling");
+
+		/* Inifinite blocking call, waiting for transmission */
+	restart:
+		health_poll_entry();
+		ret = lttng_poll_wait(&events, -1);
+		health_poll_exit();
+		if (ret < 0) {
+			/*
+			 * Restart interrupted system call.
+			 */
+			if (errno == EINTR) {
+				goto restart;
+			}
+			goto error;
+		}
+
+		nb_fd = ret;
+
+		for (i = 0; i < nb_fd; i++) {
+			int sock;
+			bool keep_connection;
+
+			revents = LTTNG_POLL_GETEV(&events, i);
+			pollfd = LTTNG_POLL_GETFD(&events, i);
+
+			health_code_update();
+
+			if (pollfd == thread_quit_pipe_fd) {
+				err = 0;
+				goto exit;
+			}
+
+			if (revents & LPOLLIN) {
+				/*
+				 * Every idle worker is woken up, the ones
+				 * that lose the race get EAGAIN.
+				 */
+				ret = read(client_workers.sock_pipe[0], &sock,
+						sizeof(sock));
+				if (ret < 0) {
+					if (errno == EAGAIN || errno == EINTR) {
+						continue;
+					}
+					PERROR("read client sock pipe");
+					goto error;
+				} else if (ret == 0) {
+					/* The client thread is gone. */
+					err = 0;
+					goto exit;
+				}
+				assert(ret == sizeof(sock));
+
+				ret = handle_client(sock, &keep_connection);
+				if (ret < 0) {
+					goto error;
+				}
+				if (!keep_connection) {
+					continue;
+				}
+
+				/* Wait for the next command of this client. */
+				ret = lttng_write(client_workers.idle_pipe[1],
+						&sock, sizeof(sock));
+				if (ret < (int) sizeof(sock)) {
+					PERROR("write client idle pipe");
+					if (close(sock)) {
+						PERROR("close");
+					}
+				}
+			} else if (revents & (LPOLLERR | LPOLLHUP | LPOLLRDHUP)) {
+				/* The client thread is gone. */
+				err = 0;
+				goto exit;
+			} else {
+				ERR("Unexpected poll events %u for sock %d", revents, pollfd);
+				goto error;
+			}
+
+			health_code_update();
+		}
+	}
+
+exit:
+error:
+	lttng_poll_clean(&events);
+error_create_poll:
+	if (err) {
+		health_error();
+		ERR("Health error occurred in %s", __func__);
+	}
+
+	health_unregister(health_sessiond);
+
+	DBG("Client command worker dying");
+
+	rcu_unregister_thread();
+	return NULL;
+}
+
+/*
+ * Close the read side of a connection hand over pipe along with the
+ * connections it still holds.
+ */
+static void drain_client_pipe(int pipe_fd)
+{
+	int ret, sock;
+
+	while (read(pipe_fd, &sock, sizeof(sock)) == sizeof(sock)) {
+		(void) close(sock);
+	}
+	ret = close(pipe_fd);
+	if (ret) {
+		PERROR("close");
+	}
+}
+
+/*
+ * Stop the client command workers and release their resources. Connections
+ * that were not picked by a worker yet are closed.
+ */
+static void stop_client_workers(void)
+{
+	int ret;
+	unsigned int i;
+
+	if (client_workers.sock_pipe[1] >= 0) {
+		ret = close(client_workers.sock_pipe[1]);
+		if (ret) {
+			PERROR("close");
+		}
+		client_workers.sock_pipe[1] = -1;
+	}
+
+	for (i = 0; i < client_workers.count; i++) {
+		ret = pthread_join(client_workers.threads[i], NULL);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_join client worker");
+		}
+	}
+	free(client_workers.threads);
+	client_workers.threads = NULL;
+	client_workers.count = 0;
+
+	if (client_workers.sock_pipe[0] >= 0) {
+		drain_client_pipe(client_workers.sock_pipe[0]);
+		client_workers.sock_pipe[0] = -1;
+	}
+
+	/* No worker is left to write to the idle pipe. */
+	if (client_workers.idle_pipe[1] >= 0) {
+		ret = close(client_workers.idle_pipe[1]);
+		if (ret) {
+			PERROR("close");
+		}
+		client_workers.idle_pipe[1] = -1;
+	}
+	if (client_workers.idle_pipe[0] >= 0) {
+		drain_client_pipe(client_workers.idle_pipe[0]);
+		client_workers.idle_pipe[0] = -1;
+	}
+}
+
+/*
+ * Create the pipes used to hand over client connections and start the client
+ * command workers.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static int start_client_workers(unsigned int count, int thread_quit_pipe_fd)
+{
+	int ret;
+	unsigned int i;
+
+	client_workers.thread_quit_pipe_fd = thread_quit_pipe_fd;
+	ret = utils_create_pipe_cloexec(client_workers.sock_pipe);
+	if (ret) {
+		goto error_pipe;
+	}
+
+	ret = utils_create_pipe_cloexec(client_workers.idle_pipe);
+	if (ret) {
+		goto error_idle_pipe;
+	}
+
+	/*
+	 * Workers race to read from the pipe, never block on it. The idle
+	 * pipe is drained in the same way on teardown.
+	 */
+	ret = fcntl(client_workers.sock_pipe[0], F_SETFL, O_NONBLOCK);
+	if (ret < 0) {
+		PERROR("fcntl client sock pipe");
+		goto error_threads;
+	}
+	ret = fcntl(client_workers.idle_pipe[0], F_SETFL, O_NONBLOCK);
+	if (ret < 0) {
+		PERROR("fcntl client idle pipe");
+		goto error_threads;
+	}
+
+	client_workers.threads = zmalloc(count * sizeof(*client_workers.threads));
+	if (!client_workers.threads) {
+		PERROR("zmalloc client workers");
+		ret = -1;
+		goto error_threads;
+	}
+
+	for (i = 0; i < count; i++) {
+		ret = pthread_create(&client_workers.threads[i],
+				default_pthread_attr(), thread_client_worker,
+				NULL);
+		if (ret) {
+			errno = ret;
+			PERROR("pthread_create client worker");
+			ret = -1;
+			goto error_create;
+		}
+		client_workers.count++;
+	}
+	DBG("Started %u client command worker(s)", count);
+	return 0;
+
+error_create:
+	/* Closing the write end makes the started workers exit. */
+	stop_client_workers();
+	return ret;
+error_threads:
+	utils_close_pipe(client_workers.idle_pipe);
+	client_workers.idle_pipe[0] = client_workers.idle_pipe[1] = -1;
+error_idle_pipe:
+	utils_close_pipe(client_workers.sock_pipe);
+	client_workers.sock_pipe[0] = client_workers.sock_pipe[1] = -1;
+error_pipe:
+	return ret;
+}
+
 static void cleanup_client_thread(void *data)
 {
 	struct lttng_pipe *quit_pipe = data;
@@ -1991,15 +2672,70 @@ static void thread_init_cleanup(void *data)
 }
 
 /*
- * This thread manage all clients request using the unix client socket for
- * communication.
+ * Hand over a client connection to the client command workers. The
+ * connection is closed on error.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static int hand_over_client(int sock)
+{
+	int ret;
+
+	ret = lttng_write(client_workers.sock_pipe[1], &sock, sizeof(sock));
+	if (ret < (int) sizeof(sock)) {
+		PERROR("write client sock pipe");
+		if (close(sock)) {
+			PERROR("close");
+		}
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Accept a new client connection and hand it over to the client command
+ * workers.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static int accept_client(int client_sock)
+{
+	int ret, sock;
+
+	DBG("Wait for client response");
+
+	sock = lttcomm_accept_unix_sock(client_sock);
+	if (sock < 0) {
+		return -1;
+	}
+
+	/*
+	 * Set the CLOEXEC flag. Return code is useless because either way, the
+	 * show must go on.
+	 */
+	(void) utils_set_fd_cloexec(sock);
+
+	/* Set socket option for credentials retrieval */
+	ret = lttcomm_setsockopt_creds_unix_sock(sock);
+	if (ret < 0) {
+		if (close(sock)) {
+			PERROR("close");
+		}
+		return -1;
+	}
+
+	return hand_over_client(sock);
+}
+
+/*
+ * This thread accepts the client connections on the unix client socket and
+ * hands them over to the client command workers, along with the next
+ * commands of the connections that are kept open.
  */
 static void *thread_manage_clients(void *data)
 {
 	int sock = -1, ret, i, pollfd, err = -1;
-	int sock_error;
 	uint32_t revents, nb_fd;
-	struct command_ctx *cmd_ctx = NULL;
 	struct lttng_poll_event events;
 	int client_sock = -1;
 	struct lttng_pipe *quit_pipe = data;
@@ -2027,10 +2763,10 @@ static void *thread_manage_clients(void *data)
 	}
 
 	/*
-	 * Pass 2 as size here for the thread quit pipe and client_sock. Nothing
-	 * more will be added to this poll set.
+	 * Pass 3 as size here for the thread quit pipe, client_sock and the
+	 * idle pipe. The kept connections are added as they go idle.
 	 */
-	ret = lttng_poll_create(&events, 2, LTTNG_CLOEXEC);
+	ret = lttng_poll_create(&events, 3, LTTNG_CLOEXEC);
 	if (ret < 0) {
 		goto error_create_poll;
 	}
@@ -2047,6 +2783,18 @@ static void *thread_manage_clients(void *data)
 		goto error;
 	}
 
+	ret = start_client_workers(config.client_worker_threads,
+			thread_quit_pipe_fd);
+	if (ret < 0) {
+		goto error;
+	}
+
+	ret = lttng_poll_add(&events, client_workers.idle_pipe[0],
+			LPOLLIN | LPOLLERR);
+	if (ret < 0) {
+		goto error;
+	}
+
 	/* Set state as running. */
         set_thread_status(true);
 	pthread_cleanup_pop(0);
@@ -2063,8 +2811,6 @@ static void *thread_manage_clients(void *data)
 	health_code_update();
 
 	while (1) {
-		const struct cmd_completion_handler *cmd_completion_handler;
-
 		DBG("Accepting client command ...");
 
 		/* Inifinite blocking call, waiting for transmission */
@@ -2093,10 +2839,13 @@ static void *thread_manage_clients(void *data)
 			if (pollfd == thread_quit_pipe_fd) {
 				err = 0;
 				goto exit;
-			} else {
+			} else if (pollfd == client_sock) {
 				/* Event on the registration socket */
 				if (revents & LPOLLIN) {
-					continue;
+					ret = accept_client(client_sock);
+					if (ret < 0) {
+						goto error;
+					}
 				} else if (revents & (LPOLLERR | LPOLLHUP | LPOLLRDHUP)) {
 					ERR("Client socket poll error");
 					goto error;
@@ -2104,131 +2853,46 @@ static void *thread_manage_clients(void *data)
 					ERR("Unexpected poll events %u for sock %d", revents, pollfd);
 					goto error;
 				}
+			} else if (pollfd == client_workers.idle_pipe[0]) {
+				/* A worker is done with a kept connection. */
+				if (!(revents & LPOLLIN)) {
+					ERR("Client idle pipe poll error");
+					goto error;
+				}
+				ret = lttng_read(client_workers.idle_pipe[0],
+						&sock, sizeof(sock));
+				if (ret < (int) sizeof(sock)) {
+					PERROR("read client idle pipe");
+					goto error;
+				}
+				ret = lttng_poll_add(&events, sock,
+						LPOLLIN | LPOLLRDHUP);
+				if (ret < 0) {
+					goto error;
+				}
+				sock = -1;
+			} else {
+				/* Next command, or hang up, of a kept connection. */
+				ret = lttng_poll_del(&events, pollfd);
+				if (ret < 0) {
+					goto error;
+				}
+				if (revents & LPOLLIN) {
+					/* The worker closes it on hang up. */
+					ret = hand_over_client(pollfd);
+					if (ret < 0) {
+						goto error;
+					}
+				} else {
+					DBG("Client connection %d hung up", pollfd);
+					if (close(pollfd)) {
+						PERROR("close");
+					}
+				}
 			}
-		}
-
-		DBG("Wait for client response");
-
-		health_code_update();
-
-		sock = lttcomm_accept_unix_sock(client_sock);
-		if (sock < 0) {
-			goto error;
-		}
-
-		/*
-		 * Set the CLOEXEC flag. Return code is useless because either way, the
-		 * show must go on.
-		 */
-		(void) utils_set_fd_cloexec(sock);
-
-		/* Set socket option for credentials retrieval */
-		ret = lttcomm_setsockopt_creds_unix_sock(sock);
-		if (ret < 0) {
-			goto error;
-		}
-
-		/* Allocate context command to process the client request */
-		cmd_ctx = zmalloc(sizeof(struct command_ctx));
-		if (cmd_ctx == NULL) {
-			PERROR("zmalloc cmd_ctx");
-			goto error;
-		}
-
-		/* Allocate data buffer for reception */
-		cmd_ctx->lsm = zmalloc(sizeof(struct lttcomm_session_msg));
-		if (cmd_ctx->lsm == NULL) {
-			PERROR("zmalloc cmd_ctx->lsm");
-			goto error;
-		}
-
-		cmd_ctx->llm = NULL;
-		cmd_ctx->session = NULL;
-
-		health_code_update();
-
-		/*
-		 * Data is received from the lttng client. The struct
-		 * lttcomm_session_msg (lsm) contains the command and data request of
-		 * the client.
-		 */
-		DBG("Receiving data from client ...");
-		ret = lttcomm_recv_creds_unix_sock(sock, cmd_ctx->lsm,
-				sizeof(struct lttcomm_session_msg), &cmd_ctx->creds);
-		if (ret <= 0) {
-			DBG("Nothing recv() from client... continuing");
-			ret = close(sock);
-			if (ret) {
-				PERROR("close");
-			}
-			sock = -1;
-			clean_command_ctx(&cmd_ctx);
-			continue;
-		}
-
-		health_code_update();
-
-		// TODO: Validate cmd_ctx including sanity check for
-		// security purpose.
-
-		rcu_thread_online();
-		/*
-		 * This function dispatch the work to the kernel or userspace tracer
-		 * libs and fill the lttcomm_lttng_msg data structure of all the needed
-		 * informations for the client. The command context struct contains
-		 * everything this function may needs.
-		 */
-		ret = process_client_msg(cmd_ctx, sock, &sock_error);
-		rcu_thread_offline();
-		if (ret < 0) {
-			ret = close(sock);
-			if (ret) {
-				PERROR("close");
-			}
-			sock = -1;
-			/*
-			 * TODO: Inform client somehow of the fatal error. At
-			 * this point, ret < 0 means that a zmalloc failed
-			 * (ENOMEM). Error detected but still accept
-			 * command, unless a socket error has been
-			 * detected.
-			 */
-			clean_command_ctx(&cmd_ctx);
-			continue;
-		}
-
-		cmd_completion_handler = cmd_pop_completion_handler();
-		if (cmd_completion_handler) {
-			enum lttng_error_code completion_code;
-
-			completion_code = cmd_completion_handler->run(
-					cmd_completion_handler->data);
-			if (completion_code != LTTNG_OK) {
-				clean_command_ctx(&cmd_ctx);
-				continue;
-			}
-		}
-
-		health_code_update();
-
-		DBG("Sending response (size: %d, retcode: %s (%d))",
-				cmd_ctx->lttng_msg_size,
-				lttng_strerror(-cmd_ctx->llm->ret_code),
-				cmd_ctx->llm->ret_code);
-		ret = send_unix_sock(sock, cmd_ctx->llm, cmd_ctx->lttng_msg_size);
-		if (ret < 0) {
-			ERR("Failed to send data back to client");
-		}
 
-		/* End of transmission */
-		ret = close(sock);
-		if (ret) {
-			PERROR("close");
+			health_code_update();
 		}
-		sock = -1;
-
-		clean_command_ctx(&cmd_ctx);
-
 		health_code_update();
 	}
 
@@ -2242,7 +2906,7 @@ error:
 	}
 
 	lttng_poll_clean(&events);
-	clean_command_ctx(&cmd_ctx);
+	stop_client_workers();
 
 error_listen:
 error_create_poll:
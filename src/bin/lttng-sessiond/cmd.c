@@ -21,6 +21,7 @@
 #include <inttypes.h>
 #include <urcu/list.h>
 #include <urcu/uatomic.h>
+#include <urcu/tls-compat.h>
 #include <sys/stat.h>
 
 #include <common/defaults.h>
@@ -74,19 +75,20 @@ static enum lttng_error_code wait_on_path(void *path);
  * when a session that has a non-default shm_path is being destroyed.
  *
  * See comment in cmd_destroy_session() for the rationale.
+ *
+ * Client commands are processed by many threads; the handler, like the
+ * current completion handler, is thus per-thread.
  */
-static struct destroy_completion_handler {
+struct destroy_completion_handler {
 	struct cmd_completion_handler handler;
 	char shm_path[member_sizeof(struct ltt_session, shm_path)];
-} destroy_completion_handler = {
-	.handler = {
-		.run = wait_on_path,
-		.data = destroy_completion_handler.shm_path
-	},
-	.shm_path = { 0 },
 };
 
-static struct cmd_completion_handler *current_completion_handler;
+static DEFINE_URCU_TLS(struct destroy_completion_handler,
+		destroy_completion_handler);
+
+static DEFINE_URCU_TLS(struct cmd_completion_handler *,
+		current_completion_handler);
 
 /*
  * Used to keep a unique index for each relayd socket created where this value
@@ -262,8 +264,10 @@ static int get_ust_runtime_stats(struct ltt_session *session,
 		if (ret < 0) {
 			goto end;
 		}
+		pthread_mutex_lock(&uchan->per_pid_closed_app_lock);
 		*discarded_events += uchan->per_pid_closed_app_discarded;
 		*lost_packets += uchan->per_pid_closed_app_lost;
+		pthread_mutex_unlock(&uchan->per_pid_closed_app_lock);
 	} else {
 		ERR("Unsupported buffer type");
 		assert(0);
@@ -1949,6 +1953,9 @@ end:
  * "internal_event" flag which is used to enable internal events which should
  * be hidden from clients. Such events are used in the agent implementation to
  * enable the events through which all "agent" events are funeled.
+ *
+ * Callers enabling many kernel events may unset "wait_quiescent" and wait for
+ * the kernel tracer once they are all enabled.
  */
 static int _cmd_enable_event(struct ltt_session *session,
 		struct lttng_domain *domain,
@@ -1956,7 +1963,7 @@ static int _cmd_enable_event(struct ltt_session *session,
 		char *filter_expression,
 		struct lttng_filter_bytecode *filter,
 		struct lttng_event_exclusion *exclusion,
-		int wpipe, bool internal_event)
+		int wpipe, bool internal_event, bool wait_quiescent)
 {
 	int ret = 0, channel_created = 0;
 	struct lttng_channel *attr = NULL;
@@ -2119,7 +2126,9 @@ static int _cmd_enable_event(struct ltt_session *session,
 			goto error;
 		}
 
-		kernel_wait_quiescent(kernel_tracer_fd);
+		if (wait_quiescent) {
+			kernel_wait_quiescent(kernel_tracer_fd);
+		}
 		break;
 	}
 	case LTTNG_DOMAIN_UST:
@@ -2356,7 +2365,39 @@ int cmd_enable_event(struct ltt_session *session, struct lttng_domain *domain,
 		int wpipe)
 {
 	return _cmd_enable_event(session, domain, channel_name, event,
-			filter_expression, filter, exclusion, wpipe, false);
+			filter_expression, filter, exclusion, wpipe, false, true);
+}
+
+/*
+ * Command LTTNG_ENABLE_EVENT_BATCH processed by the client thread.
+ *
+ * Enable the events of a batch in turn and store the lttng_error_code of each
+ * of them in ret_codes. We own the filter, exclusion and filter_expression of
+ * every entry. The kernel tracer is waited for once, after all the events
+ * are enabled.
+ */
+int cmd_enable_events(struct ltt_session *session, struct lttng_domain *domain,
+		char *channel_name, struct cmd_event_batch_entry *entries,
+		size_t count, uint32_t *ret_codes, int wpipe)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		ret_codes[i] = _cmd_enable_event(session, domain, channel_name,
+				entries[i].event, entries[i].filter_expression,
+				entries[i].filter, entries[i].exclusion, wpipe,
+				false, false);
+		/* Ownership was passed. */
+		entries[i].filter_expression = NULL;
+		entries[i].filter = NULL;
+		entries[i].exclusion = NULL;
+	}
+
+	if (domain->type == LTTNG_DOMAIN_KERNEL && count > 0) {
+		kernel_wait_quiescent(kernel_tracer_fd);
+	}
+
+	return LTTNG_OK;
 }
 
 /*
@@ -2373,7 +2414,7 @@ static int cmd_enable_event_internal(struct ltt_session *session,
 		int wpipe)
 {
 	return _cmd_enable_event(session, domain, channel_name, event,
-			filter_expression, filter, exclusion, wpipe, true);
+			filter_expression, filter, exclusion, wpipe, true, true);
 }
 
 /*
@@ -2706,6 +2747,20 @@ int cmd_start_trace(struct ltt_session *session)
 		}
 	}
 
+	if (session->rotate_size) {
+		uint64_t threshold;
+
+		/*
+		 * The consumers of domains created after the size-based
+		 * rotation was enabled don't know its threshold yet.
+		 */
+		if (lttng_condition_session_consumed_size_get_threshold(
+				session->rotate_condition, &threshold) ==
+				LTTNG_CONDITION_STATUS_OK) {
+			set_consumers_rotate_threshold(session, threshold);
+		}
+	}
+
 	ret = LTTNG_OK;
 
 error:
@@ -3200,11 +3255,15 @@ int cmd_destroy_session(struct ltt_session *session,
 		 * be destroyed properly, except that we can't offer the
 		 * guarantee that the same session can be re-created.
 		 */
-		current_completion_handler = &destroy_completion_handler.handler;
-		ret = lttng_strncpy(destroy_completion_handler.shm_path,
-				session->shm_path,
-				sizeof(destroy_completion_handler.shm_path));
+		struct destroy_completion_handler *handler =
+				&URCU_TLS(destroy_completion_handler);
+
+		handler->handler.run = wait_on_path;
+		handler->handler.data = handler->shm_path;
+		ret = lttng_strncpy(handler->shm_path, session->shm_path,
+				sizeof(handler->shm_path));
 		assert(!ret);
+		URCU_TLS(current_completion_handler) = &handler->handler;
 	}
 
 	/*
@@ -3501,7 +3560,9 @@ error:
  * client for session listing.
  *
  * The session list lock MUST be acquired before calling this function. Use
- * session_lock_list() and session_unlock_list().
+ * session_lock_list() and session_unlock_list(). Each session is locked while
+ * its entry is filled since most commands only hold the session lock while
+ * they change the consumer output or the session state.
  */
 void cmd_list_lttng_sessions(struct lttng_session *sessions,
 		size_t session_count, uid_t uid, gid_t gid)
@@ -3520,21 +3581,23 @@ void cmd_list_lttng_sessions(struct lttng_session *sessions,
 	 * the buffer.
 	 */
 	cds_list_for_each_entry(session, &list->head, list) {
+		struct ltt_kernel_session *ksess;
+		struct ltt_ust_session *usess;
+
 		if (!session_get(session)) {
 			continue;
 		}
+		session_lock(session);
 		/*
 		 * Only list the sessions the user can control.
 		 */
 		if (!session_access_ok(session, uid, gid) ||
 				session->destroyed) {
-			session_put(session);
-			continue;
+			goto next;
 		}
 
-		struct ltt_kernel_session *ksess = session->kernel_session;
-		struct ltt_ust_session *usess = session->ust_session;
-
+		ksess = session->kernel_session;
+		usess = session->ust_session;
 		if (session->consumer->type == CONSUMER_DST_NET ||
 				(ksess && ksess->consumer->type == CONSUMER_DST_NET) ||
 				(usess && usess->consumer->type == CONSUMER_DST_NET)) {
@@ -3546,8 +3609,7 @@ void cmd_list_lttng_sessions(struct lttng_session *sessions,
 		}
 		if (ret < 0) {
 			PERROR("snprintf session path");
-			session_put(session);
-			continue;
+			goto next;
 		}
 
 		strncpy(sessions[i].name, session->name, NAME_MAX);
@@ -3558,6 +3620,8 @@ void cmd_list_lttng_sessions(struct lttng_session *sessions,
 		extended[i].creation_time.value = (uint64_t) session->creation_time;
 		extended[i].creation_time.is_set = 1;
 		i++;
+next:
+		session_unlock(session);
 		session_put(session);
 	}
 }
@@ -5113,9 +5177,10 @@ static enum lttng_error_code wait_on_path(void *path_data)
  */
 const struct cmd_completion_handler *cmd_pop_completion_handler(void)
 {
-	struct cmd_completion_handler *handler = current_completion_handler;
+	struct cmd_completion_handler *handler =
+			URCU_TLS(current_completion_handler);
 
-	current_completion_handler = NULL;
+	URCU_TLS(current_completion_handler) = NULL;
 	return handler;
 }
 
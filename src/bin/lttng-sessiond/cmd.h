@@ -37,6 +37,14 @@ struct cmd_completion_handler {
 	void *data;
 };
 
+/* Event enabled by cmd_enable_events(). */
+struct cmd_event_batch_entry {
+	struct lttng_event *event;
+	char *filter_expression;
+	struct lttng_filter_bytecode *filter;
+	struct lttng_event_exclusion *exclusion;
+};
+
 /*
  * Init the command subsystem. Must be called before using any of the functions
  * above. This is called in the main() of the session daemon.
@@ -76,6 +84,9 @@ int cmd_enable_event(struct ltt_session *session, struct lttng_domain *domain,
 		struct lttng_filter_bytecode *filter,
 		struct lttng_event_exclusion *exclusion,
 		int wpipe);
+int cmd_enable_events(struct ltt_session *session, struct lttng_domain *domain,
+		char *channel_name, struct cmd_event_batch_entry *entries,
+		size_t count, uint32_t *ret_codes, int wpipe);
 
 /* Trace session action commands */
 int cmd_start_trace(struct ltt_session *session);
@@ -1894,3 +1894,32 @@ error:
 	health_code_update();
 	return ret;
 }
+
+/*
+ * Ask the consumer to sample the channels of a session as soon as their
+ * consumed size reaches the threshold of its size-based rotation. A threshold
+ * of 0 disables the check.
+ *
+ * Called with the consumer socket lock held.
+ */
+int consumer_set_session_rotate_threshold(struct consumer_socket *socket,
+		uint64_t session_id, uint64_t threshold)
+{
+	int ret;
+	struct lttcomm_consumer_msg msg;
+
+	assert(socket);
+
+	DBG("Consumer set rotation threshold of session %" PRIu64 " to %" PRIu64,
+			session_id, threshold);
+
+	memset(&msg, 0, sizeof(msg));
+	msg.cmd_type = LTTNG_CONSUMER_SET_SESSION_ROTATE_THRESHOLD;
+	msg.u.set_session_rotate_threshold.session_id = session_id;
+	msg.u.set_session_rotate_threshold.threshold = threshold;
+
+	health_code_update();
+	ret = consumer_send_msg(socket, &msg);
+	health_code_update();
+	return ret;
+}
@@ -314,5 +314,7 @@ int consumer_check_rotation_pending_relay(struct consumer_socket *socket,
 int consumer_mkdir(struct consumer_socket *socket, uint64_t session_id,
 		const struct consumer_output *output, const char *path,
 		uid_t uid, gid_t gid);
+int consumer_set_session_rotate_threshold(struct consumer_socket *socket,
+		uint64_t session_id, uint64_t threshold);
 
 #endif /* _CONSUMER_H */
@@ -176,7 +176,6 @@ int kernel_consumer_add_channel(struct consumer_socket *sock,
 	session = session_find_by_id(ksession->id);
 	assert(session);
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 
 	status = notification_thread_command_add_channel(
 			notification_thread_handle, session->name,
@@ -242,7 +241,6 @@ int kernel_consumer_add_metadata(struct consumer_socket *sock,
 	session = session_find_by_id(ksession->id);
 	assert(session);
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 
 	/* Prep channel message structure */
 	consumer_init_add_channel_comm_msg(&lkm,
@@ -400,7 +398,6 @@ int kernel_consumer_send_channel_streams(struct consumer_socket *sock,
 	session = session_find_by_id(ksession->id);
 	assert(session);
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 
 	/* Bail out if consumer is disabled */
 	if (!ksession->consumer->enabled) {
@@ -36,13 +36,28 @@
 #include "rotate.h"
 
 /*
- * Key used to reference a channel between the sessiond and the consumer. This
- * is only read and updated with the session_list lock held.
+ * Key used to reference a channel between the sessiond and the consumer.
+ * Access under next_kernel_channel_key_lock.
  */
 static uint64_t next_kernel_channel_key;
+static pthread_mutex_t next_kernel_channel_key_lock = PTHREAD_MUTEX_INITIALIZER;
 
 #include <lttng/userspace-probe.h>
 #include <lttng/userspace-probe-internal.h>
+
+/*
+ * Return the incremented value of next_kernel_channel_key.
+ */
+static uint64_t get_next_kernel_channel_key(void)
+{
+	uint64_t ret;
+
+	pthread_mutex_lock(&next_kernel_channel_key_lock);
+	ret = ++next_kernel_channel_key;
+	pthread_mutex_unlock(&next_kernel_channel_key_lock);
+	return ret;
+}
+
 /*
  * Add context on a kernel channel.
  *
@@ -178,7 +193,7 @@ int kernel_create_channel(struct ltt_kernel_session *session,
 	cds_list_add(&lkc->list, &session->channel_list.head);
 	session->channel_count++;
 	lkc->session = session;
-	lkc->key = ++next_kernel_channel_key;
+	lkc->key = get_next_kernel_channel_key();
 
 	DBG("Kernel channel %s created (fd: %d, key: %" PRIu64 ")",
 			lkc->channel->name, lkc->fd, lkc->key);
@@ -514,6 +529,10 @@ int kernel_create_event(struct lttng_event *ev,
 
 	/* Add event to event list */
 	cds_list_add(&event->list, &channel->events_list.head);
+	lttng_ht_node_init_str(&event->node, event->event->name);
+	rcu_read_lock();
+	lttng_ht_add_str(channel->events_ht, &event->node);
+	rcu_read_unlock();
 	channel->event_count++;
 
 	DBG("Event %s created (fd: %d)", ev->name, event->fd);
@@ -789,7 +808,7 @@ int kernel_open_metadata(struct ltt_kernel_session *session)
 	}
 
 	lkm->fd = ret;
-	lkm->key = ++next_kernel_channel_key;
+	lkm->key = get_next_kernel_channel_key();
 	/* Prevent fd duplication after execlp() */
 	ret = fcntl(lkm->fd, F_SETFD, FD_CLOEXEC);
 	if (ret < 0) {
@@ -1256,7 +1275,6 @@ enum lttng_error_code kernel_snapshot_record(struct ltt_kernel_session *ksess,
 	session = session_find_by_id(ksess->id);
 	assert(session);
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 	trace_archive_id = session->current_archive_id;
 
 	/* Save current metadata since the following calls will change it. */
@@ -127,6 +127,7 @@ static const struct option long_options[] = {
 	{ "no-kernel", no_argument, 0, '\0' },
 	{ "pidfile", required_argument, 0, 'p' },
 	{ "agent-tcp-port", required_argument, 0, '\0' },
+	{ "client-worker-threads", required_argument, 0, '\0' },
 	{ "config", required_argument, 0, 'f' },
 	{ "load", required_argument, 0, 'l' },
 	{ "kmod-probes", required_argument, 0, '\0' },
@@ -331,6 +332,9 @@ static void sessiond_cleanup(void)
 	wait_consumer(&ustconsumer64_data);
 	wait_consumer(&ustconsumer32_data);
 
+	DBG("Cleaning up the sessions by ID HT");
+	ltt_sessions_ht_destroy();
+
 	DBG("Cleaning up all agent apps");
 	agent_app_ht_clean();
 
@@ -747,6 +751,26 @@ static int set_option(int opt, const char *arg, const char *optname)
 			config.agent_tcp_port.begin = config.agent_tcp_port.end = (int) v;
 			DBG3("Agent TCP port set to non default: %i", (int) v);
 		}
+	} else if (string_match(optname, "client-worker-threads")) {
+		unsigned long v;
+
+		if (!arg || *arg == '\0') {
+			ret = -EINVAL;
+			goto end;
+		}
+		errno = 0;
+		v = strtoul(arg, NULL, 0);
+		if (errno != 0 || !isdigit(arg[0])) {
+			ERR("Wrong value in --client-worker-threads parameter: %s", arg);
+			return -1;
+		}
+		if (v == 0 || v > UINT_MAX) {
+			ERR("Value out of range in --client-worker-threads parameter: %s", arg);
+			return -1;
+		}
+		config.client_worker_threads = (unsigned int) v;
+		DBG3("Client worker threads set to %u",
+				config.client_worker_threads);
 	} else if (string_match(optname, "load") || opt == 'l') {
 		if (!arg || *arg == '\0') {
 			ret = -EINVAL;
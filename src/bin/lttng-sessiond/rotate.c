@@ -37,6 +37,7 @@
 #include <lttng/rotate-internal.h>
 
 #include "session.h"
+#include "consumer.h"
 #include "rotate.h"
 #include "rotation-thread.h"
 #include "lttng-sessiond.h"
@@ -178,7 +179,7 @@ error:
 
 /*
  * Rename a chunk folder after a rotation is complete.
- * session_lock_list and session lock must be held.
+ * The session lock must be held.
  *
  * Returns 0 on success, a negative value on error.
  */
@@ -348,6 +349,50 @@ end:
 	return ret;
 }
 
+static
+void set_output_rotate_threshold(const struct ltt_session *session,
+		const struct consumer_output *output, uint64_t threshold)
+{
+	int ret;
+	struct lttng_ht_iter iter;
+	struct consumer_socket *socket;
+
+	if (!output || !output->socks) {
+		return;
+	}
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(output->socks->ht, &iter.iter, socket,
+			node.node) {
+		pthread_mutex_lock(socket->lock);
+		ret = consumer_set_session_rotate_threshold(socket, session->id,
+				threshold);
+		pthread_mutex_unlock(socket->lock);
+		if (ret) {
+			/*
+			 * Not fatal; the consumed size of the session is
+			 * still sampled periodically by the monitor timers.
+			 */
+			ERR("Failed to set the rotation threshold of session \"%s\" on consumer",
+					session->name);
+		}
+	}
+	rcu_read_unlock();
+}
+
+void set_consumers_rotate_threshold(struct ltt_session *session,
+		uint64_t threshold)
+{
+	if (session->kernel_session) {
+		set_output_rotate_threshold(session,
+				session->kernel_session->consumer, threshold);
+	}
+	if (session->ust_session) {
+		set_output_rotate_threshold(session,
+				session->ust_session->consumer, threshold);
+	}
+}
+
 int subscribe_session_consumed_size_rotation(struct ltt_session *session, uint64_t size,
 		struct notification_thread_handle *notification_thread_handle)
 {
@@ -413,6 +458,7 @@ int subscribe_session_consumed_size_rotation(struct ltt_session *session, uint64
 		goto end;
 	}
 
+	set_consumers_rotate_threshold(session, size);
 	ret = 0;
 
 end:
@@ -441,6 +487,7 @@ int unsubscribe_session_consumed_size_rotation(struct ltt_session *session,
 		goto end;
 	}
 
+	set_consumers_rotate_threshold(session, 0);
 	ret = 0;
 end:
 	return ret;
@@ -35,4 +35,11 @@ int subscribe_session_consumed_size_rotation(struct ltt_session *session,
 int unsubscribe_session_consumed_size_rotation(struct ltt_session *session,
 		struct notification_thread_handle *notification_thread_handle);
 
+/*
+ * Propagate the consumed size threshold of the session's size-based rotation
+ * to its consumers. A threshold of 0 disables it.
+ */
+void set_consumers_rotate_threshold(struct ltt_session *session,
+		uint64_t threshold);
+
 #endif /* ROTATE_H */
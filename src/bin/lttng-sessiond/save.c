@@ -19,6 +19,7 @@
 #include <assert.h>
 #include <inttypes.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <urcu/uatomic.h>
 #include <unistd.h>
 
@@ -36,6 +37,8 @@
 #include "trace-ust.h"
 #include "agent.h"
 
+#define SESSION_CONFIG_TMP_FILE_SUFFIX	".tmp"
+
 static
 int save_kernel_channel_attributes(struct config_writer *writer,
 	struct lttng_channel_attr *attr)
@@ -760,6 +763,50 @@ end:
 	return ret;
 }
 
+/*
+ * Save the compiled bytecode of an event's filter so that loading the
+ * session doesn't need to compile the filter expression again.
+ */
+static
+int save_filter_bytecode(struct config_writer *writer,
+		const char *filter_expression,
+		const struct lttng_filter_bytecode *bytecode)
+{
+	int ret;
+
+	ret = config_writer_open_element(writer,
+			config_element_filter_bytecode);
+	if (ret) {
+		ret = LTTNG_ERR_SAVE_IO_FAIL;
+		goto end;
+	}
+
+	ret = config_writer_write_element_unsigned_int(writer,
+			config_element_filter_bytecode_key,
+			config_get_filter_bytecode_key(filter_expression));
+	if (ret) {
+		ret = LTTNG_ERR_SAVE_IO_FAIL;
+		goto end;
+	}
+
+	ret = config_writer_write_element_bin_hex(writer,
+			config_element_filter_bytecode_data, bytecode,
+			sizeof(*bytecode) + bytecode->len);
+	if (ret) {
+		ret = LTTNG_ERR_SAVE_IO_FAIL;
+		goto end;
+	}
+
+	/* /filter_bytecode */
+	ret = config_writer_close_element(writer);
+	if (ret) {
+		ret = LTTNG_ERR_SAVE_IO_FAIL;
+		goto end;
+	}
+end:
+	return ret;
+}
+
 static
 int save_kernel_event(struct config_writer *writer,
 		struct ltt_kernel_event *event)
@@ -811,6 +858,15 @@ int save_kernel_event(struct config_writer *writer,
 			ret = LTTNG_ERR_SAVE_IO_FAIL;
 			goto end;
 		}
+
+		if (event->filter) {
+			ret = save_filter_bytecode(writer,
+					event->filter_expression,
+					event->filter);
+			if (ret) {
+				goto end;
+			}
+		}
 	}
 
 	if (event->event->instrumentation == LTTNG_KERNEL_FUNCTION ||
@@ -973,6 +1029,16 @@ int save_ust_event(struct config_writer *writer,
 			ret = LTTNG_ERR_SAVE_IO_FAIL;
 			goto end;
 		}
+
+		/* Agent events are saved without their bytecode. */
+		if (event->filter) {
+			ret = save_filter_bytecode(writer,
+					event->filter_expression,
+					event->filter);
+			if (ret) {
+				goto end;
+			}
+		}
 	}
 
 	if (event->exclusion && event->exclusion->count) {
@@ -2286,10 +2352,13 @@ int save_session(struct ltt_session *session,
 {
 	int ret, fd = -1;
 	char config_file_path[PATH_MAX];
+	char tmp_config_file_path[PATH_MAX];
 	size_t len;
 	struct config_writer *writer = NULL;
 	size_t session_name_len;
 	const char *provided_path;
+	bool file_exists;
+	struct stat config_file_stat;
 
 	assert(session);
 	assert(attr);
@@ -2363,13 +2432,44 @@ int save_session(struct ltt_session *session,
 	len += sizeof(DEFAULT_SESSION_CONFIG_FILE_EXTENSION);
 	config_file_path[len] = '\0';
 
-	if (!access(config_file_path, F_OK) && !attr->overwrite) {
+	file_exists = !access(config_file_path, F_OK);
+	if (file_exists && !attr->overwrite) {
 		/* File exists, notify the user since the overwrite flag is off. */
 		ret = LTTNG_ERR_SAVE_FILE_EXIST;
 		goto end;
 	}
 
-	fd = run_as_open(config_file_path, O_CREAT | O_WRONLY | O_TRUNC,
+	/*
+	 * Only skip the save if the file is still the one written by the last
+	 * save; a file edited or replaced since is overwritten as requested.
+	 */
+	if (file_exists && session->saved_config_path &&
+			session->saved_config_generation ==
+				session->config_generation &&
+			!strcmp(session->saved_config_path, config_file_path) &&
+			!stat(config_file_path, &config_file_stat) &&
+			config_file_stat.st_dev == session->saved_config_dev &&
+			config_file_stat.st_ino == session->saved_config_ino &&
+			config_file_stat.st_mtime == session->saved_config_mtime) {
+		DBG("Session %s is unchanged since it was saved to %s, skipping",
+				session->name, config_file_path);
+		ret = 0;
+		goto end;
+	}
+
+	/*
+	 * The configuration is written to a temporary file which replaces the
+	 * previous one once complete so that an existing configuration is
+	 * never left truncated.
+	 */
+	ret = snprintf(tmp_config_file_path, sizeof(tmp_config_file_path),
+			"%s" SESSION_CONFIG_TMP_FILE_SUFFIX, config_file_path);
+	if (ret < 0 || (size_t) ret >= sizeof(tmp_config_file_path)) {
+		ret = LTTNG_ERR_SET_URL;
+		goto end;
+	}
+
+	fd = run_as_open(tmp_config_file_path, O_CREAT | O_WRONLY | O_TRUNC,
 		S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP,
 		LTTNG_SOCK_GET_UID_CRED(creds), LTTNG_SOCK_GET_GID_CRED(creds));
 	if (fd < 0) {
@@ -2488,20 +2588,46 @@ end:
 		/* Preserve the original error code */
 		ret = ret ? ret : LTTNG_ERR_SAVE_IO_FAIL;
 	}
+	if (fd < 0) {
+		goto end_no_file;
+	}
+
+	if (!ret && fsync(fd)) {
+		PERROR("Syncing XML session configuration");
+		ret = LTTNG_ERR_SAVE_IO_FAIL;
+	}
+	/* The temporary file becomes the configuration file once renamed. */
+	if (!ret && fstat(fd, &config_file_stat)) {
+		PERROR("Getting XML session configuration status");
+		ret = LTTNG_ERR_SAVE_IO_FAIL;
+	}
+	if (close(fd)) {
+		PERROR("Closing XML session configuration");
+		ret = ret ? ret : LTTNG_ERR_SAVE_IO_FAIL;
+	}
+	if (!ret && run_as_rename(tmp_config_file_path, config_file_path,
+			LTTNG_SOCK_GET_UID_CRED(creds),
+			LTTNG_SOCK_GET_GID_CRED(creds))) {
+		PERROR("Renaming XML session configuration");
+		ret = LTTNG_ERR_SAVE_IO_FAIL;
+	}
 	if (ret) {
 		/* Delete file in case of error */
-		if ((fd >= 0) && unlink(config_file_path)) {
+		if (run_as_unlink(tmp_config_file_path,
+				LTTNG_SOCK_GET_UID_CRED(creds),
+				LTTNG_SOCK_GET_GID_CRED(creds))) {
 			PERROR("Unlinking XML session configuration.");
 		}
+		goto end_no_file;
 	}
 
-	if (fd >= 0) {
-		ret = close(fd);
-		if (ret) {
-			PERROR("Closing XML session configuration");
-		}
-	}
-
+	free(session->saved_config_path);
+	session->saved_config_path = strdup(config_file_path);
+	session->saved_config_generation = session->config_generation;
+	session->saved_config_dev = config_file_stat.st_dev;
+	session->saved_config_ino = config_file_stat.st_ino;
+	session->saved_config_mtime = config_file_stat.st_mtime;
+end_no_file:
 	return ret;
 }
 
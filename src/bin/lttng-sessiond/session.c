@@ -23,6 +23,7 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <urcu.h>
+#include <urcu/uatomic.h>
 #include <dirent.h>
 #include <sys/types.h>
 #include <pthread.h>
@@ -288,13 +289,17 @@ int ltt_sessions_ht_alloc(void)
 {
 	int ret = 0;
 
+	struct lttng_ht *ht;
+
 	DBG("Allocating ltt_sessions_ht_by_id");
-	ltt_sessions_ht_by_id = lttng_ht_new(0, LTTNG_HT_TYPE_U64);
-	if (!ltt_sessions_ht_by_id) {
+	ht = lttng_ht_new(0, LTTNG_HT_TYPE_U64);
+	if (!ht) {
 		ret = -1;
 		ERR("Failed to allocate ltt_sessions_ht_by_id");
 		goto end;
 	}
+	/* Published for session_find_by_id(). */
+	rcu_assign_pointer(ltt_sessions_ht_by_id, ht);
 end:
 	return ret;
 }
@@ -302,9 +307,10 @@ end:
 /*
  * Destroy the ltt_sessions_ht_by_id HT.
  *
- * The session list lock must be held.
+ * session_find_by_id() looks it up without the session list lock, so it is
+ * only destroyed on teardown, once no other thread can use it.
  */
-static void ltt_sessions_ht_destroy(void)
+void ltt_sessions_ht_destroy(void)
 {
 	if (!ltt_sessions_ht_by_id) {
 		return;
@@ -338,28 +344,8 @@ end:
 	return;
 }
 
-/*
- * Test if ltt_sessions_ht_by_id is empty.
- * Return 1 if empty, 0 if not empty.
- * The session list lock must be held.
- */
-static int ltt_sessions_ht_empty(void)
-{
-	int ret;
-
-	if (!ltt_sessions_ht_by_id) {
-		ret = 1;
-		goto end;
-	}
-
-	ret = lttng_ht_get_count(ltt_sessions_ht_by_id) ? 0 : 1;
-end:
-	return ret;
-}
-
 /*
  * Remove a ltt_session from the ltt_sessions_ht_by_id.
- * If empty, the ltt_sessions_ht_by_id HT is freed.
  * The session list lock must be held.
  */
 static void del_session_ht(struct ltt_session *ls)
@@ -373,11 +359,6 @@ static void del_session_ht(struct ltt_session *ls)
 	iter.iter.node = &ls->node.node;
 	ret = lttng_ht_del(ltt_sessions_ht_by_id, &iter);
 	assert(!ret);
-
-	if (ltt_sessions_ht_empty()) {
-		DBG("Empty ltt_sessions_ht_by_id, destroying it");
-		ltt_sessions_ht_destroy();
-	}
 }
 
 /*
@@ -400,6 +381,17 @@ void session_unlock(struct ltt_session *session)
 	pthread_mutex_unlock(&session->lock);
 }
 
+static
+void session_free_rcu(struct rcu_head *head)
+{
+	struct lttng_ht_node_u64 *node =
+			caa_container_of(head, struct lttng_ht_node_u64, head);
+	struct ltt_session *session =
+			caa_container_of(node, struct ltt_session, node);
+
+	free(session);
+}
+
 static
 void session_release(struct urcu_ref *ref)
 {
@@ -443,14 +435,21 @@ void session_release(struct urcu_ref *ref)
 
 	consumer_output_put(session->consumer);
 	snapshot_destroy(&session->snapshot);
+	free(session->saved_config_path);
 
 	if (session->published) {
 		ASSERT_LOCKED(ltt_session_list.lock);
 		del_session_list(session);
 		del_session_ht(session);
 		pthread_cond_broadcast(&ltt_session_list.removal_cond);
+		/*
+		 * session_find_by_id() walks the ID hash table without the
+		 * session list lock.
+		 */
+		call_rcu(&session->node.head, session_free_rcu);
+	} else {
+		free(session);
 	}
-	free(session);
 }
 
 /*
@@ -464,15 +463,33 @@ bool session_get(struct ltt_session *session)
 
 /*
  * Release a reference to a session.
+ *
+ * The session list lock must be held when the reference being released may
+ * be the last one, e.g. it is not needed by a helper dropping the reference
+ * it took on a session that its caller holds a reference to.
  */
 void session_put(struct ltt_session *session)
 {
+	long refcount;
+
 	if (!session) {
 		return;
 	}
+
+	refcount = uatomic_read(&session->ref.refcount);
+	while (refcount > 1) {
+		const long old = uatomic_cmpxchg(&session->ref.refcount,
+				refcount, refcount - 1);
+
+		if (old == refcount) {
+			return;
+		}
+		refcount = old;
+	}
+
 	/*
-	 * The session list lock must be held as any session_put()
-	 * may cause the removal of the session from the session_list.
+	 * The session list lock must be held as releasing the last reference
+	 * removes the session from the session_list.
 	 */
 	ASSERT_LOCKED(ltt_session_list.lock);
 	assert(session->ref.refcount);
@@ -526,34 +543,39 @@ found:
 
 /*
  * Return an ltt_session that matches the id. If no session is found,
- * NULL is returned. This must be called with rcu_read_lock and
- * session list lock held (to guarantee the lifetime of the session).
+ * NULL is returned.
+ *
+ * The session list lock is not required: sessions are reclaimed after an RCU
+ * grace period and only a session that still has a reference can be
+ * returned. A reference to the session is acquired by this function.
  */
 struct ltt_session *session_find_by_id(uint64_t id)
 {
+	struct lttng_ht *ht;
 	struct lttng_ht_node_u64 *node;
 	struct lttng_ht_iter iter;
-	struct ltt_session *ls;
-
-	ASSERT_LOCKED(ltt_session_list.lock);
+	struct ltt_session *ls = NULL;
 
-	if (!ltt_sessions_ht_by_id) {
+	rcu_read_lock();
+	ht = rcu_dereference(ltt_sessions_ht_by_id);
+	if (!ht) {
 		goto end;
 	}
 
-	lttng_ht_lookup(ltt_sessions_ht_by_id, &id, &iter);
+	lttng_ht_lookup(ht, &id, &iter);
 	node = lttng_ht_iter_get_node_u64(&iter);
 	if (node == NULL) {
 		goto end;
 	}
 	ls = caa_container_of(node, struct ltt_session, node);
-
-	DBG3("Session %" PRIu64 " found by id.", id);
-	return session_get(ls) ? ls : NULL;
+	if (!session_get(ls)) {
+		ls = NULL;
+	}
 
 end:
-	DBG3("Session %" PRIu64 " NOT found by id", id);
-	return NULL;
+	rcu_read_unlock();
+	DBG3("Session %" PRIu64 " %sfound by id", id, ls ? "" : "NOT ");
+	return ls;
 }
 
 /*
@@ -752,14 +774,13 @@ int session_access_ok(struct ltt_session *session, uid_t uid, gid_t gid)
  * rotation was "ONGOING", result should be set to "ERROR", which will
  * allow a client to report it.
  *
- * Must be called with the session and session_list locks held.
+ * Must be called with the session lock held and a reference to the session.
  */
 int session_reset_rotation_state(struct ltt_session *session,
 		enum lttng_rotation_state result)
 {
 	int ret = 0;
 
-	ASSERT_LOCKED(ltt_session_list.lock);
 	ASSERT_LOCKED(session->lock);
 
 	session->rotation_pending_local = false;
@@ -20,6 +20,7 @@
 
 #include <limits.h>
 #include <stdbool.h>
+#include <sys/types.h>
 #include <urcu/list.h>
 
 #include <common/hashtable/hashtable.h>
@@ -225,6 +226,23 @@ struct ltt_session {
 	 */
 	struct lttng_condition *rotate_condition;
 	struct lttng_trigger *rotate_trigger;
+	/*
+	 * Generation of the session's configuration, incremented before any
+	 * command that can change the state saved by a save command is
+	 * processed.
+	 */
+	uint64_t config_generation;
+	/*
+	 * Configuration generation, path and file identity of the last
+	 * successful save. A session saved again to the same path while its
+	 * configuration is unchanged is not rewritten, unless the file was
+	 * modified or replaced since.
+	 */
+	uint64_t saved_config_generation;
+	char *saved_config_path;
+	dev_t saved_config_dev;
+	ino_t saved_config_ino;
+	time_t saved_config_mtime;
 };
 
 /* Prototypes */
@@ -256,6 +274,7 @@ struct ltt_session *session_find_by_id(uint64_t id);
 
 struct ltt_session_list *session_get_list(void);
 void session_list_wait_empty(void);
+void ltt_sessions_ht_destroy(void);
 
 int session_access_ok(struct ltt_session *session, uid_t uid, gid_t gid);
 
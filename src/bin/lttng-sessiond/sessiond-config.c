@@ -34,6 +34,7 @@ struct sessiond_config sessiond_config_build_defaults = {
 
 	.agent_tcp_port = 			{ .begin = DEFAULT_AGENT_TCP_PORT_RANGE_BEGIN, .end = DEFAULT_AGENT_TCP_PORT_RANGE_END },
 	.app_socket_timeout = 			DEFAULT_APP_SOCKET_RW_TIMEOUT,
+	.client_worker_threads =		DEFAULT_CLIENT_WORKER_THREADS,
 
 	.no_kernel = 				false,
 	.background = 				false,
@@ -508,6 +509,7 @@ void sessiond_config_log(struct sessiond_config *config)
 				config->agent_tcp_port.end);
 	}
 	DBG_NO_LOC("\tapplication socket timeout:    %i", config->app_socket_timeout);
+	DBG_NO_LOC("\tclient worker threads:         %u", config->client_worker_threads);
 	DBG_NO_LOC("\tno-kernel:                     %s", config->no_kernel ? "True" : "False");
 	DBG_NO_LOC("\tbackground:                    %s", config->background ? "True" : "False");
 	DBG_NO_LOC("\tdaemonize:                     %s", config->daemonize ? "True" : "False");
@@ -41,6 +41,8 @@ struct sessiond_config {
 	struct config_int_range agent_tcp_port;
 	/* Socket timeout for receiving and sending (in seconds). */
 	int app_socket_timeout;
+	/* Number of threads processing client commands. */
+	unsigned int client_worker_threads;
 
 	bool quiet;
 	bool no_kernel;
@@ -242,7 +242,7 @@ end:
 }
 
 /*
- * Call with session and session_list locks held.
+ * Call with the session lock held.
  */
 int timer_session_rotation_pending_check_stop(struct ltt_session *session)
 {
@@ -268,7 +268,7 @@ int timer_session_rotation_pending_check_stop(struct ltt_session *session)
 }
 
 /*
- * Call with session and session_list locks held.
+ * Call with the session lock held.
  */
 int timer_session_rotation_schedule_timer_start(struct ltt_session *session,
 		unsigned int interval_us)
@@ -293,7 +293,7 @@ end:
 }
 
 /*
- * Call with session and session_list locks held.
+ * Call with the session lock held.
  */
 int timer_session_rotation_schedule_timer_stop(struct ltt_session *session)
 {
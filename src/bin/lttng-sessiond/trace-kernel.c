@@ -33,6 +33,14 @@
 #include "trace-kernel.h"
 #include "lttng-sessiond.h"
 #include "notification-thread-commands.h"
+#include "utils.h"
+
+/* Key used to match a kernel event in a channel's events_ht. */
+struct ltt_kernel_ht_key {
+	const char *name;
+	enum lttng_event_type type;
+	const struct lttng_filter_bytecode *filter;
+};
 
 /*
  * Find the channel name for the given kernel session.
@@ -64,47 +72,76 @@ struct ltt_kernel_channel *trace_kernel_get_channel_by_name(
 	return NULL;
 }
 
+/*
+ * Match function for the channel's events_ht lookup.
+ *
+ * It matches a kernel event on its name, type and filter bytecode.
+ */
+static int trace_kernel_ht_match_event(struct cds_lfht_node *node,
+		const void *_key)
+{
+	const struct ltt_kernel_event *ev;
+	const struct ltt_kernel_ht_key *key = _key;
+
+	ev = caa_container_of(node, struct ltt_kernel_event, node.node);
+
+	if (key->type != LTTNG_EVENT_ALL && ev->type != key->type) {
+		goto no_match;
+	}
+	if (strcmp(key->name, ev->event->name)) {
+		goto no_match;
+	}
+	if ((ev->filter && !key->filter) || (!ev->filter && key->filter)) {
+		goto no_match;
+	}
+	if (ev->filter && key->filter) {
+		if (ev->filter->len != key->filter->len ||
+				memcmp(ev->filter->data, key->filter->data,
+					key->filter->len) != 0) {
+			goto no_match;
+		}
+	}
+	return 1;
+
+no_match:
+	return 0;
+}
+
 /*
  * Find the event for the given channel.
+ *
+ * Events are only freed with their channel, so the returned event remains
+ * valid as long as the session lock is held.
  */
 struct ltt_kernel_event *trace_kernel_find_event(
 		char *name, struct ltt_kernel_channel *channel,
 		enum lttng_event_type type,
 		struct lttng_filter_bytecode *filter)
 {
-	struct ltt_kernel_event *ev;
-	int found = 0;
+	struct ltt_kernel_event *ev = NULL;
+	struct lttng_ht_node_str *node;
+	struct lttng_ht_iter iter;
+	struct ltt_kernel_ht_key key;
 
 	assert(name);
 	assert(channel);
 
-	cds_list_for_each_entry(ev, &channel->events_list.head, list) {
-		if (type != LTTNG_EVENT_ALL && ev->type != type) {
-			continue;
-		}
-		if (strcmp(name, ev->event->name)) {
-			continue;
-		}
-		if ((ev->filter && !filter) || (!ev->filter && filter)) {
-			continue;
-		}
-		if (ev->filter && filter) {
-			if (ev->filter->len != filter->len ||
-					memcmp(ev->filter->data, filter->data,
-						filter->len) != 0) {
-				continue;
-			}
-		}
-		found = 1;
-		break;
-	}
-	if (found) {
+	key.name = name;
+	key.type = type;
+	key.filter = filter;
+
+	rcu_read_lock();
+	cds_lfht_lookup(channel->events_ht->ht,
+			channel->events_ht->hash_fct((void *) name, lttng_ht_seed),
+			trace_kernel_ht_match_event, &key, &iter.iter);
+	node = lttng_ht_iter_get_node_str(&iter);
+	if (node) {
+		ev = caa_container_of(node, struct ltt_kernel_event, node);
 		DBG("Found event %s for channel %s", name,
 			channel->channel->name);
-		return ev;
-	} else {
-		return NULL;
 	}
+	rcu_read_unlock();
+	return ev;
 }
 
 /*
@@ -227,6 +264,10 @@ struct ltt_kernel_channel *trace_kernel_create_channel(
 	lkc->event_count = 0;
 	lkc->enabled = 1;
 	lkc->published_to_notification_thread = false;
+	lkc->events_ht = lttng_ht_new(0, LTTNG_HT_TYPE_STRING);
+	if (!lkc->events_ht) {
+		goto error;
+	}
 	/* Init linked list */
 	CDS_INIT_LIST_HEAD(&lkc->events_list.head);
 	CDS_INIT_LIST_HEAD(&lkc->stream_list.head);
@@ -236,6 +277,10 @@ struct ltt_kernel_channel *trace_kernel_create_channel(
 
 error:
 	if (lkc) {
+		if (lkc->channel) {
+			/* Owns the extended attributes once they are copied. */
+			free(lkc->channel->attr.extended.ptr);
+		}
 		free(lkc->channel);
 	}
 	free(extended);
@@ -627,9 +672,17 @@ void trace_kernel_destroy_channel(struct ltt_kernel_channel *channel)
 	}
 
 	/* For each event in the channel list */
+	rcu_read_lock();
 	cds_list_for_each_entry_safe(event, etmp, &channel->events_list.head, list) {
+		struct lttng_ht_iter iter;
+
+		iter.iter.node = &event->node.node;
+		ret = lttng_ht_del(channel->events_ht, &iter);
+		assert(!ret);
 		trace_kernel_destroy_event(event);
 	}
+	rcu_read_unlock();
+	ht_cleanup_push(channel->events_ht);
 
 	/* For each context in the channel list */
 	cds_list_for_each_entry_safe(ctx, ctmp, &channel->ctx_list, list) {
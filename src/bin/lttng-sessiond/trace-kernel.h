@@ -24,6 +24,7 @@
 #include <common/lttng-kernel.h>
 #include <common/lttng-kernel-old.h>
 #include <common/defaults.h>
+#include <common/hashtable/hashtable.h>
 
 #include "consumer.h"
 
@@ -59,6 +60,8 @@ struct ltt_kernel_event {
 	char *filter_expression;
 	struct lttng_filter_bytecode *filter;
 	struct lttng_userspace_probe_location *userspace_probe_location;
+	/* Node in the channel's events_ht, keyed on the event name. */
+	struct lttng_ht_node_str node;
 };
 
 /* Kernel channel */
@@ -72,6 +75,8 @@ struct ltt_kernel_channel {
 	struct cds_list_head ctx_list;
 	struct lttng_channel *channel;
 	struct ltt_kernel_event_list events_list;
+	/* Events of events_list, indexed by name for lookups. */
+	struct lttng_ht *events_ht;
 	struct ltt_kernel_stream_list stream_list;
 	struct cds_list_head list;
 	/* Session pointer which has a reference to this object. */
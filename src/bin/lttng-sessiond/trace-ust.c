@@ -383,6 +383,7 @@ struct ltt_ust_channel *trace_ust_create_channel(struct lttng_channel *chan,
 	/* Init node */
 	lttng_ht_node_init_str(&luc->node, luc->name);
 	CDS_INIT_LIST_HEAD(&luc->ctx_list);
+	pthread_mutex_init(&luc->per_pid_closed_app_lock, NULL);
 
 	/* Alloc hash tables */
 	luc->events = lttng_ht_new(0, LTTNG_HT_TYPE_STRING);
@@ -1083,6 +1084,7 @@ static void _trace_ust_destroy_channel(struct ltt_ust_channel *channel)
 
 	DBG2("Trace destroy UST channel %s", channel->name);
 
+	pthread_mutex_destroy(&channel->per_pid_closed_app_lock);
 	free(channel);
 }
 
@@ -20,6 +20,7 @@
 #define _LTT_TRACE_UST_H
 
 #include <limits.h>
+#include <pthread.h>
 #include <urcu/list.h>
 
 #include <lttng/lttng.h>
@@ -80,6 +81,12 @@ struct ltt_ust_channel {
 	struct lttng_ht_node_str node;
 	uint64_t tracefile_size;
 	uint64_t tracefile_count;
+	/*
+	 * Counters of the per-pid channels of applications that are gone.
+	 * Protected by per_pid_closed_app_lock: they are updated when an
+	 * application unregisters, without the session lock.
+	 */
+	pthread_mutex_t per_pid_closed_app_lock;
 	uint64_t per_pid_closed_app_discarded;
 	uint64_t per_pid_closed_app_lost;
 	uint64_t monitor_timer_interval;
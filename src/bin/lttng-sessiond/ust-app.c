@@ -411,6 +411,10 @@ void save_per_pid_lost_discarded_counters(struct ust_app_channel *ua_chan)
 		 * ensures that the accounting of lost packets and discarded
 		 * events is done exactly once. The session is then unpublished
 		 * from the session list, resulting in this condition.
+		 *
+		 * The session lock is not held on the second path; the
+		 * counters are protected by their own lock against the
+		 * commands reading them.
 		 */
 		goto end;
 	}
@@ -432,8 +436,10 @@ void save_per_pid_lost_discarded_counters(struct ust_app_channel *ua_chan)
 		goto end;
 	}
 
+	pthread_mutex_lock(&uchan->per_pid_closed_app_lock);
 	uchan->per_pid_closed_app_discarded += discarded;
 	uchan->per_pid_closed_app_lost += lost;
+	pthread_mutex_unlock(&uchan->per_pid_closed_app_lock);
 
 end:
 	rcu_read_unlock();
@@ -2790,7 +2796,7 @@ error:
  * Create and send to the application the created buffers with per UID buffers.
  *
  * This MUST be called with a RCU read side lock acquired.
- * The session list lock and the session's lock must be acquired.
+ * The session's lock must be acquired.
  *
  * Return 0 on success else a negative value.
  */
@@ -2837,7 +2843,6 @@ static int create_channel_per_uid(struct ust_app *app,
 	session = session_find_by_id(ua_sess->tracing_id);
 	assert(session);
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 
 	/*
 	 * Create the buffers on the consumer side. This call populates the
@@ -2914,7 +2919,7 @@ error:
  * Create and send to the application the created buffers with per PID buffers.
  *
  * Called with UST app session lock held.
- * The session list lock and the session's lock must be acquired.
+ * The session's lock must be acquired.
  *
  * Return 0 on success else a negative value.
  */
@@ -2954,7 +2959,6 @@ static int create_channel_per_pid(struct ust_app *app,
 	assert(session);
 
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 
 	/* Create and get channel on the consumer side. */
 	ret = do_consumer_create_channel(usess, ua_sess, ua_chan,
@@ -3227,7 +3231,6 @@ static int create_ust_app_metadata(struct ust_app_session *ua_sess,
 	assert(session);
 
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 
 	/*
 	 * Ask the metadata channel creation to the consumer. The metadata object
@@ -5924,7 +5927,6 @@ enum lttng_error_code ust_app_snapshot_record(struct ltt_ust_session *usess,
 	session = session_find_by_id(usess->id);
 	assert(session);
 	assert(pthread_mutex_trylock(&session->lock));
-	assert(session_trylock_list());
 	trace_archive_id = session->current_archive_id;
 
 	switch (usess->buffer_type) {
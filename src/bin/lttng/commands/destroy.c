@@ -77,6 +77,7 @@ static int destroy_session(struct lttng_session *session)
 	session_was_stopped = ret == -LTTNG_ERR_TRACE_ALREADY_STOPPED;
 	if (!opt_no_wait) {
 		bool printed_wait_msg = false;
+		unsigned int wait_delay_us = 0;
 
 		do {
 			ret = lttng_data_pending(session->name);
@@ -86,8 +87,8 @@ static int destroy_session(struct lttng_session *session)
 			}
 
 			/*
-			 * Data sleep time before retrying (in usec). Don't sleep if the call
-			 * returned value indicates availability.
+			 * Wait before retrying. Don't sleep if the call returned
+			 * value indicates availability.
 			 */
 			if (ret) {
 				if (!printed_wait_msg) {
@@ -96,7 +97,7 @@ static int destroy_session(struct lttng_session *session)
 				}
 
 				printed_wait_msg = true;
-				usleep(DEFAULT_DATA_AVAILABILITY_WAIT_TIME);
+				utils_wait_before_retry(&wait_delay_us);
 				_MSG(".");
 				fflush(stdout);
 			}
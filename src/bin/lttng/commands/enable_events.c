@@ -84,6 +84,15 @@ enum {
 static struct lttng_handle *handle;
 static struct mi_writer *writer;
 
+/* Event of the event list given on the command line. */
+struct listed_event {
+	char *name;
+	struct lttng_event *ev;
+	char **exclusion_list;
+	/* Index of the event in the batch, -1 if it is enabled on its own. */
+	int batch_index;
+};
+
 static struct poptOption long_options[] = {
 	/* longName, shortName, argInfo, argPtr, value, descrip, argDesc */
 	{"help",           'h', POPT_ARG_NONE, 0, OPT_HELP, 0, 0},
@@ -963,6 +972,202 @@ static void warn_on_truncated_exclusion_names(char * const *exclusion_list,
 	}
 }
 
+/*
+ * Fill the attributes of an event of the event list given on the command line
+ * from the command line options.
+ *
+ * Return CMD_SUCCESS on success else an error code.
+ */
+static int init_listed_event(struct lttng_event *ev, const char *event_name,
+		const char *channel_name, char ***exclusion_list, int *warn)
+{
+	int ret = CMD_SUCCESS;
+
+	/* Copy name and type of the event */
+	strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
+	ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
+	ev->type = opt_event_type;
+
+	/* Kernel tracer action */
+	if (opt_kernel) {
+		DBG("Enabling kernel event %s for channel %s",
+				event_name,
+				print_channel_name(channel_name));
+
+		switch (opt_event_type) {
+		case LTTNG_EVENT_ALL:	/* Enable tracepoints and syscalls */
+			/* If event name differs from *, select tracepoint. */
+			if (strcmp(ev->name, "*")) {
+				ev->type = LTTNG_EVENT_TRACEPOINT;
+			}
+			break;
+		case LTTNG_EVENT_TRACEPOINT:
+			break;
+		case LTTNG_EVENT_PROBE:
+			ret = parse_probe_opts(ev, opt_probe);
+			if (ret) {
+				ERR("Unable to parse probe options");
+				ret = CMD_ERROR;
+				goto end;
+			}
+			break;
+		case LTTNG_EVENT_USERSPACE_PROBE:
+			ret = parse_userspace_probe_opts(ev, opt_userspace_probe);
+			if (ret) {
+				switch (ret) {
+				case CMD_UNSUPPORTED:
+					/*
+					 * Error message describing
+					 * what is not supported was
+					 * printed in the function.
+					 */
+					break;
+				case CMD_ERROR:
+				default:
+					ERR("Unable to parse userspace probe options");
+					break;
+				}
+				goto end;
+			}
+			break;
+		case LTTNG_EVENT_FUNCTION:
+			ret = parse_probe_opts(ev, opt_function);
+			if (ret) {
+				ERR("Unable to parse function probe options");
+				ret = CMD_ERROR;
+				goto end;
+			}
+			break;
+		case LTTNG_EVENT_SYSCALL:
+			ev->type = LTTNG_EVENT_SYSCALL;
+			break;
+		default:
+			ret = CMD_UNDEFINED;
+			goto end;
+		}
+
+		/* kernel loglevels not implemented */
+		ev->loglevel_type = LTTNG_EVENT_LOGLEVEL_ALL;
+	} else if (opt_userspace) {		/* User-space tracer action */
+		DBG("Enabling UST event %s for channel %s, loglevel %s", event_name,
+				print_channel_name(channel_name), opt_loglevel ? : "<all>");
+
+		switch (opt_event_type) {
+		case LTTNG_EVENT_ALL:	/* Default behavior is tracepoint */
+			/* Fall-through */
+		case LTTNG_EVENT_TRACEPOINT:
+			/* Copy name and type of the event */
+			ev->type = LTTNG_EVENT_TRACEPOINT;
+			strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
+			ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
+			break;
+		case LTTNG_EVENT_PROBE:
+		case LTTNG_EVENT_FUNCTION:
+		case LTTNG_EVENT_SYSCALL:
+		case LTTNG_EVENT_USERSPACE_PROBE:
+		default:
+			ERR("Event type not available for user-space tracing");
+			ret = CMD_UNSUPPORTED;
+			goto end;
+		}
+
+		if (opt_exclude) {
+			ev->exclusion = 1;
+			if (opt_event_type != LTTNG_EVENT_ALL && opt_event_type != LTTNG_EVENT_TRACEPOINT) {
+				ERR("Exclusion option can only be used with tracepoint events");
+				ret = CMD_ERROR;
+				goto end;
+			}
+			ret = create_exclusion_list_and_validate(
+				event_name, opt_exclude,
+				exclusion_list);
+			if (ret) {
+				ret = CMD_ERROR;
+				goto end;
+			}
+
+			warn_on_truncated_exclusion_names(
+				*exclusion_list, warn);
+		}
+
+		ev->loglevel_type = opt_loglevel_type;
+		if (opt_loglevel) {
+			ev->loglevel = loglevel_str_to_value(opt_loglevel);
+			if (ev->loglevel == -1) {
+				ERR("Unknown loglevel %s", opt_loglevel);
+				ret = -LTTNG_ERR_INVALID;
+				goto end;
+			}
+		} else {
+			ev->loglevel = -1;
+		}
+	} else if (opt_jul || opt_log4j || opt_python) {
+		if (opt_event_type != LTTNG_EVENT_ALL &&
+				opt_event_type != LTTNG_EVENT_TRACEPOINT) {
+			ERR("Event type not supported for domain.");
+			ret = CMD_UNSUPPORTED;
+			goto end;
+		}
+
+		ev->loglevel_type = opt_loglevel_type;
+		if (opt_loglevel) {
+			if (opt_jul) {
+				ev->loglevel = loglevel_jul_str_to_value(opt_loglevel);
+			} else if (opt_log4j) {
+				ev->loglevel = loglevel_log4j_str_to_value(opt_loglevel);
+			} else if (opt_python) {
+				ev->loglevel = loglevel_python_str_to_value(opt_loglevel);
+			}
+			if (ev->loglevel == -1) {
+				ERR("Unknown loglevel %s", opt_loglevel);
+				ret = -LTTNG_ERR_INVALID;
+				goto end;
+			}
+		} else {
+			if (opt_jul) {
+				ev->loglevel = LTTNG_LOGLEVEL_JUL_ALL;
+			} else if (opt_log4j) {
+				ev->loglevel = LTTNG_LOGLEVEL_LOG4J_ALL;
+			} else if (opt_python) {
+				ev->loglevel = LTTNG_LOGLEVEL_PYTHON_DEBUG;
+			}
+		}
+		ev->type = LTTNG_EVENT_TRACEPOINT;
+		strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
+		ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
+	} else {
+		assert(0);
+	}
+
+end:
+	return ret;
+}
+
+/*
+ * Enable an event of the event list, or fetch its status when it was enabled
+ * as part of the batch.
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+static int enable_listed_event(const struct listed_event *listed,
+		const char *channel_name, struct lttng_event_batch *batch,
+		int batch_ret)
+{
+	if (listed->batch_index < 0) {
+		return lttng_enable_event_with_exclusions(handle, listed->ev,
+				channel_name, opt_filter,
+				listed->exclusion_list ?
+					strutils_array_of_strings_len(listed->exclusion_list) : 0,
+				listed->exclusion_list);
+	}
+
+	if (batch_ret < 0) {
+		return batch_ret;
+	}
+
+	return lttng_event_batch_get_status(batch, listed->batch_index);
+}
+
 /*
  * Enabling event using the lttng API.
  * Note: in case of error only the last error code will be return.
@@ -975,6 +1180,10 @@ static int enable_events(char *session_name)
 	struct lttng_event *ev;
 	struct lttng_domain dom;
 	char **exclusion_list = NULL;
+	struct listed_event *listed_events = NULL;
+	unsigned int i, nb_listed_events = 0, max_listed_events;
+	struct lttng_event_batch *batch = NULL;
+	int batch_ret = 0;
 
 	memset(&dom, 0, sizeof(dom));
 
@@ -1331,176 +1540,81 @@ static int enable_events(char *session_name)
 	}
 
 	/* Strip event list */
-	event_name = strtok(opt_event_list, ",");
-	while (event_name != NULL) {
-		/* Copy name and type of the event */
-		strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
-		ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
-		ev->type = opt_event_type;
+	lttng_event_destroy(ev);
+	ev = NULL;
+	max_listed_events = 1;
+	for (event_name = opt_event_list; *event_name; event_name++) {
+		if (*event_name == ',') {
+			max_listed_events++;
+		}
+	}
+	listed_events = zmalloc(max_listed_events * sizeof(*listed_events));
+	if (!listed_events) {
+		PERROR("zmalloc listed events");
+		ret = CMD_ERROR;
+		goto error;
+	}
 
-		/* Kernel tracer action */
-		if (opt_kernel) {
-			DBG("Enabling kernel event %s for channel %s",
-					event_name,
-					print_channel_name(channel_name));
+	batch = lttng_event_batch_create(handle, channel_name);
+	if (!batch) {
+		ERR("Failed to allocate event batch");
+		ret = CMD_ERROR;
+		goto error;
+	}
 
-			switch (opt_event_type) {
-			case LTTNG_EVENT_ALL:	/* Enable tracepoints and syscalls */
-				/* If event name differs from *, select tracepoint. */
-				if (strcmp(ev->name, "*")) {
-					ev->type = LTTNG_EVENT_TRACEPOINT;
-				}
-				break;
-			case LTTNG_EVENT_TRACEPOINT:
-				break;
-			case LTTNG_EVENT_PROBE:
-				ret = parse_probe_opts(ev, opt_probe);
-				if (ret) {
-					ERR("Unable to parse probe options");
-					ret = CMD_ERROR;
-					goto error;
-				}
-				break;
-			case LTTNG_EVENT_USERSPACE_PROBE:
-				ret = parse_userspace_probe_opts(ev, opt_userspace_probe);
-				if (ret) {
-					switch (ret) {
-					case CMD_UNSUPPORTED:
-						/*
-						 * Error message describing
-						 * what is not supported was
-						 * printed in the function.
-						 */
-						break;
-					case CMD_ERROR:
-					default:
-						ERR("Unable to parse userspace probe options");
-						break;
-					}
-					goto error;
-				}
-				break;
-			case LTTNG_EVENT_FUNCTION:
-				ret = parse_probe_opts(ev, opt_function);
-				if (ret) {
-					ERR("Unable to parse function probe options");
-					ret = CMD_ERROR;
-					goto error;
-				}
-				break;
-			case LTTNG_EVENT_SYSCALL:
-				ev->type = LTTNG_EVENT_SYSCALL;
-				break;
-			default:
-				ret = CMD_UNDEFINED;
-				goto error;
-			}
+	event_name = strtok(opt_event_list, ",");
+	while (event_name != NULL) {
+		struct listed_event *listed = &listed_events[nb_listed_events];
 
-			/* kernel loglevels not implemented */
-			ev->loglevel_type = LTTNG_EVENT_LOGLEVEL_ALL;
-		} else if (opt_userspace) {		/* User-space tracer action */
-			DBG("Enabling UST event %s for channel %s, loglevel %s", event_name,
-					print_channel_name(channel_name), opt_loglevel ? : "<all>");
+		listed->name = event_name;
+		listed->batch_index = -1;
+		listed->ev = lttng_event_create();
+		if (!listed->ev) {
+			ret = CMD_ERROR;
+			goto error;
+		}
+		nb_listed_events++;
 
-			switch (opt_event_type) {
-			case LTTNG_EVENT_ALL:	/* Default behavior is tracepoint */
-				/* Fall-through */
-			case LTTNG_EVENT_TRACEPOINT:
-				/* Copy name and type of the event */
-				ev->type = LTTNG_EVENT_TRACEPOINT;
-				strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
-				ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
-				break;
-			case LTTNG_EVENT_PROBE:
-			case LTTNG_EVENT_FUNCTION:
-			case LTTNG_EVENT_SYSCALL:
-			case LTTNG_EVENT_USERSPACE_PROBE:
-			default:
-				ERR("Event type not available for user-space tracing");
-				ret = CMD_UNSUPPORTED;
-				goto error;
-			}
+		ret = init_listed_event(listed->ev, event_name, channel_name,
+				&listed->exclusion_list, &warn);
+		if (ret) {
+			goto error;
+		}
+		if (opt_filter) {
+			listed->ev->filter = 1;
+		}
 
-			if (opt_exclude) {
-				ev->exclusion = 1;
-				if (opt_event_type != LTTNG_EVENT_ALL && opt_event_type != LTTNG_EVENT_TRACEPOINT) {
-					ERR("Exclusion option can only be used with tracepoint events");
-					ret = CMD_ERROR;
-					goto error;
-				}
-				/* Free previously allocated items */
-				strutils_free_null_terminated_array_of_strings(
-					exclusion_list);
-				exclusion_list = NULL;
-				ret = create_exclusion_list_and_validate(
-					event_name, opt_exclude,
-					&exclusion_list);
-				if (ret) {
-					ret = CMD_ERROR;
-					goto error;
-				}
+		/*
+		 * Events that can't be batched are enabled on their own, which
+		 * also reports why adding them failed.
+		 */
+		if (listed->ev->type != LTTNG_EVENT_USERSPACE_PROBE &&
+				!lttng_event_batch_add(batch, listed->ev,
+					opt_filter,
+					listed->exclusion_list ?
+						strutils_array_of_strings_len(listed->exclusion_list) : 0,
+					listed->exclusion_list)) {
+			listed->batch_index =
+					lttng_event_batch_get_count(batch) - 1;
+		}
 
-				warn_on_truncated_exclusion_names(
-					exclusion_list, &warn);
-			}
+		/* Next event */
+		event_name = strtok(NULL, ",");
+	}
 
-			ev->loglevel_type = opt_loglevel_type;
-			if (opt_loglevel) {
-				ev->loglevel = loglevel_str_to_value(opt_loglevel);
-				if (ev->loglevel == -1) {
-					ERR("Unknown loglevel %s", opt_loglevel);
-					ret = -LTTNG_ERR_INVALID;
-					goto error;
-				}
-			} else {
-				ev->loglevel = -1;
-			}
-		} else if (opt_jul || opt_log4j || opt_python) {
-			if (opt_event_type != LTTNG_EVENT_ALL &&
-					opt_event_type != LTTNG_EVENT_TRACEPOINT) {
-				ERR("Event type not supported for domain.");
-				ret = CMD_UNSUPPORTED;
-				goto error;
-			}
+	/* Enable all the batched events with a single command. */
+	batch_ret = lttng_enable_event_batch(batch);
 
-			ev->loglevel_type = opt_loglevel_type;
-			if (opt_loglevel) {
-				if (opt_jul) {
-					ev->loglevel = loglevel_jul_str_to_value(opt_loglevel);
-				} else if (opt_log4j) {
-					ev->loglevel = loglevel_log4j_str_to_value(opt_loglevel);
-				} else if (opt_python) {
-					ev->loglevel = loglevel_python_str_to_value(opt_loglevel);
-				}
-				if (ev->loglevel == -1) {
-					ERR("Unknown loglevel %s", opt_loglevel);
-					ret = -LTTNG_ERR_INVALID;
-					goto error;
-				}
-			} else {
-				if (opt_jul) {
-					ev->loglevel = LTTNG_LOGLEVEL_JUL_ALL;
-				} else if (opt_log4j) {
-					ev->loglevel = LTTNG_LOGLEVEL_LOG4J_ALL;
-				} else if (opt_python) {
-					ev->loglevel = LTTNG_LOGLEVEL_PYTHON_DEBUG;
-				}
-			}
-			ev->type = LTTNG_EVENT_TRACEPOINT;
-			strncpy(ev->name, event_name, LTTNG_SYMBOL_NAME_LEN);
-			ev->name[LTTNG_SYMBOL_NAME_LEN - 1] = '\0';
-		} else {
-			assert(0);
-		}
+	for (i = 0; i < nb_listed_events; i++) {
+		event_name = listed_events[i].name;
+		ev = listed_events[i].ev;
+		exclusion_list = listed_events[i].exclusion_list;
 
 		if (!opt_filter) {
 			char *exclusion_string;
 
-			command_ret = lttng_enable_event_with_exclusions(handle,
-					ev, channel_name,
-					NULL,
-					exclusion_list ? strutils_array_of_strings_len(exclusion_list) : 0,
-					exclusion_list);
+			command_ret = enable_listed_event(&listed_events[i],
+					channel_name, batch, batch_ret);
 			exclusion_string = print_exclusions(exclusion_list);
 			if (!exclusion_string) {
 				PERROR("Cannot allocate exclusion_string");
@@ -1581,10 +1695,8 @@ static int enable_events(char *session_name)
 			/* Filter present */
 			ev->filter = 1;
 
-			command_ret = lttng_enable_event_with_exclusions(handle, ev, channel_name,
-					opt_filter,
-					exclusion_list ? strutils_array_of_strings_len(exclusion_list) : 0,
-					exclusion_list);
+			command_ret = enable_listed_event(&listed_events[i],
+					channel_name, batch, batch_ret);
 			exclusion_string = print_exclusions(exclusion_list);
 			if (!exclusion_string) {
 				PERROR("Cannot allocate exclusion_string");
@@ -1670,8 +1782,6 @@ static int enable_events(char *session_name)
 			}
 		}
 
-		/* Next event */
-		event_name = strtok(NULL, ",");
 		/* Reset warn, error and success */
 		success = 1;
 	}
@@ -1694,14 +1804,25 @@ error:
 		ret = CMD_ERROR;
 	}
 	lttng_destroy_handle(handle);
-	strutils_free_null_terminated_array_of_strings(exclusion_list);
+	lttng_event_batch_destroy(batch);
+	if (listed_events) {
+		/* ev and exclusion_list belong to the listed events. */
+		for (i = 0; i < nb_listed_events; i++) {
+			lttng_event_destroy(listed_events[i].ev);
+			strutils_free_null_terminated_array_of_strings(
+					listed_events[i].exclusion_list);
+		}
+		free(listed_events);
+	} else {
+		strutils_free_null_terminated_array_of_strings(exclusion_list);
+		lttng_event_destroy(ev);
+	}
 
 	/* Overwrite ret with error_holder if there was an actual error with
 	 * enabling an event.
 	 */
 	ret = error_holder ? error_holder : ret;
 
-	lttng_event_destroy(ev);
 	return ret;
 }
 
@@ -29,6 +29,7 @@
 
 #include <common/sessiond-comm/sessiond-comm.h>
 #include <common/mi-lttng.h>
+#include <common/utils.h>
 
 #include "../command.h"
 #include <lttng/rotation.h>
@@ -161,6 +162,7 @@ static int rotate_tracing(char *session_name)
 	enum lttng_rotation_state rotation_state = LTTNG_ROTATION_STATE_ONGOING;
 	const struct lttng_trace_archive_location *location = NULL;
 	bool print_location = true;
+	unsigned int wait_delay_us = 0;
 
 	DBG("Rotating the output files of session %s", session_name);
 
@@ -198,7 +200,7 @@ static int rotate_tracing(char *session_name)
 		}
 
 		if (rotation_state == LTTNG_ROTATION_STATE_ONGOING) {
-			ret = usleep(DEFAULT_DATA_AVAILABILITY_WAIT_TIME);
+			ret = utils_wait_before_retry(&wait_delay_us);
 			if (ret) {
 				PERROR("usleep");
 				goto error;
@@ -27,6 +27,7 @@
 
 #include <common/sessiond-comm/sessiond-comm.h>
 #include <common/mi-lttng.h>
+#include <common/utils.h>
 
 #include "../command.h"
 
@@ -121,6 +122,8 @@ static int stop_tracing(void)
 	}
 
 	if (!opt_no_wait) {
+		unsigned int wait_delay_us = 0;
+
 		_MSG("Waiting for data availability");
 		fflush(stdout);
 		do {
@@ -131,11 +134,11 @@ static int stop_tracing(void)
 			}
 
 			/*
-			 * Data sleep time before retrying (in usec). Don't sleep if the call
-			 * returned value indicates availability.
+			 * Wait before retrying. Don't sleep if the call returned
+			 * value indicates availability.
 			 */
 			if (ret) {
-				usleep(DEFAULT_DATA_AVAILABILITY_WAIT_TIME);
+				utils_wait_before_retry(&wait_delay_us);
 				_MSG(".");
 				fflush(stdout);
 			}
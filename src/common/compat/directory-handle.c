@@ -41,6 +41,19 @@ int _run_as_mkdir(const struct lttng_directory_handle *handle, const char *path,
 static
 int _run_as_mkdir_recursive(const struct lttng_directory_handle *handle,
 		const char *path, mode_t mode, uid_t uid, gid_t gid);
+static
+int lttng_directory_handle_open(const struct lttng_directory_handle *handle,
+		const char *filename, int flags, mode_t mode);
+static
+int _run_as_open(const struct lttng_directory_handle *handle,
+		const char *filename, int flags, mode_t mode,
+		uid_t uid, gid_t gid);
+static
+int lttng_directory_handle_unlink(const struct lttng_directory_handle *handle,
+		const char *filename);
+static
+int _run_as_unlink(const struct lttng_directory_handle *handle,
+		const char *filename, uid_t uid, gid_t gid);
 
 #ifdef COMPAT_DIRFD
 
@@ -66,6 +79,29 @@ end:
 	return ret;
 }
 
+LTTNG_HIDDEN
+int lttng_directory_handle_init_as_user(struct lttng_directory_handle *handle,
+		const char *path, const struct lttng_credentials *creds)
+{
+	int ret;
+
+	if (!path || !creds) {
+		ret = lttng_directory_handle_init(handle, path);
+		goto end;
+	}
+
+	ret = run_as_open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC, 0,
+			creds->uid, creds->gid);
+	if (ret == -1) {
+		PERROR("Failed to initialize directory handle to \"%s\"", path);
+		goto end;
+	}
+	handle->dirfd = ret;
+	ret = 0;
+end:
+	return ret;
+}
+
 LTTNG_HIDDEN
 int lttng_directory_handle_init_from_dirfd(
 		struct lttng_directory_handle *handle, int dirfd)
@@ -117,11 +153,40 @@ int _run_as_mkdir_recursive(const struct lttng_directory_handle *handle,
 	return run_as_mkdirat_recursive(handle->dirfd, path, mode, uid, gid);
 }
 
+static
+int lttng_directory_handle_open(const struct lttng_directory_handle *handle,
+		const char *filename, int flags, mode_t mode)
+{
+	return openat(handle->dirfd, filename, flags, mode);
+}
+
+static
+int _run_as_open(const struct lttng_directory_handle *handle,
+		const char *filename, int flags, mode_t mode,
+		uid_t uid, gid_t gid)
+{
+	return run_as_openat(handle->dirfd, filename, flags, mode, uid, gid);
+}
+
+static
+int lttng_directory_handle_unlink(const struct lttng_directory_handle *handle,
+		const char *filename)
+{
+	return unlinkat(handle->dirfd, filename, 0);
+}
+
+static
+int _run_as_unlink(const struct lttng_directory_handle *handle,
+		const char *filename, uid_t uid, gid_t gid)
+{
+	return run_as_unlinkat(handle->dirfd, filename, uid, gid);
+}
+
 #else /* COMPAT_DIRFD */
 
-LTTNG_HIDDEN
-int lttng_directory_handle_init(struct lttng_directory_handle *handle,
-		const char *path)
+static
+int directory_handle_init(struct lttng_directory_handle *handle,
+		const char *path, bool check_directory)
 {
 	int ret;
 	size_t cwd_len, path_len, handle_path_len;
@@ -160,22 +225,29 @@ int lttng_directory_handle_init(struct lttng_directory_handle *handle,
 		 * (TOCTOU) since the directory could be removed/replaced/renamed,
 		 * but this is inevitable on platforms that don't provide dirfd support.
 		 */
-		ret = stat(path, &stat_buf);
+		ret = check_directory ? stat(path, &stat_buf) : 0;
 		if (ret == -1) {
 			PERROR("Failed to initialize directory handle to \"%s\", stat() failed",
 			       path);
 			goto end;
 		}
-		if (!S_ISDIR(stat_buf.st_mode)) {
+		if (check_directory && !S_ISDIR(stat_buf.st_mode)) {
 			ERR("Failed to initialize directory handle to \"%s\": not a directory",
 			    path);
 			ret = -1;
 			goto end;
 		}
 		if (*path == '/') {
-			handle->base_path = strdup(path);
+			/* The base path is used as a prefix; end it with a '/'. */
+			handle->base_path = zmalloc(path_len + 2);
 			if (!handle->base_path) {
+				PERROR("Failed to initialize directory handle");
 				ret = -1;
+				goto end;
+			}
+			strcpy(handle->base_path, path);
+			if (path[path_len - 1] != '/') {
+				handle->base_path[path_len] = '/';
 			}
 			/* Not an error. */
 			goto end;
@@ -211,6 +283,25 @@ end:
 	return ret;
 }
 
+LTTNG_HIDDEN
+int lttng_directory_handle_init(struct lttng_directory_handle *handle,
+		const char *path)
+{
+	return directory_handle_init(handle, path, true);
+}
+
+/*
+ * The path is not checked with the credentials of the process since they may
+ * not grant access to it; the operations performed on the handle as the user
+ * fail if it is not a directory.
+ */
+LTTNG_HIDDEN
+int lttng_directory_handle_init_as_user(struct lttng_directory_handle *handle,
+		const char *path, const struct lttng_credentials *creds)
+{
+	return directory_handle_init(handle, path, !creds);
+}
+
 LTTNG_HIDDEN
 int lttng_directory_handle_init_from_dirfd(
 		struct lttng_directory_handle *handle, int dirfd)
@@ -318,6 +409,79 @@ end:
 	return ret;
 }
 
+static
+int lttng_directory_handle_open(const struct lttng_directory_handle *handle,
+		const char *filename, int flags, mode_t mode)
+{
+	int ret;
+	char fullpath[LTTNG_PATH_MAX];
+
+	ret = get_full_path(handle, filename, fullpath, sizeof(fullpath));
+	if (ret) {
+		errno = ENOMEM;
+		goto end;
+	}
+
+	ret = open(fullpath, flags, mode);
+end:
+	return ret;
+}
+
+static
+int _run_as_open(const struct lttng_directory_handle *handle,
+		const char *filename, int flags, mode_t mode,
+		uid_t uid, gid_t gid)
+{
+	int ret;
+	char fullpath[LTTNG_PATH_MAX];
+
+	ret = get_full_path(handle, filename, fullpath, sizeof(fullpath));
+	if (ret) {
+		errno = ENOMEM;
+		goto end;
+	}
+
+	ret = run_as_open(fullpath, flags, mode, uid, gid);
+end:
+	return ret;
+}
+
+static
+int lttng_directory_handle_unlink(const struct lttng_directory_handle *handle,
+		const char *filename)
+{
+	int ret;
+	char fullpath[LTTNG_PATH_MAX];
+
+	ret = get_full_path(handle, filename, fullpath, sizeof(fullpath));
+	if (ret) {
+		errno = ENOMEM;
+		goto end;
+	}
+
+	ret = unlink(fullpath);
+end:
+	return ret;
+}
+
+static
+int _run_as_unlink(const struct lttng_directory_handle *handle,
+		const char *filename, uid_t uid, gid_t gid)
+{
+	int ret;
+	char fullpath[LTTNG_PATH_MAX];
+
+	ret = get_full_path(handle, filename, fullpath, sizeof(fullpath));
+	if (ret) {
+		errno = ENOMEM;
+		goto end;
+	}
+
+	ret = run_as_unlink(fullpath, uid, gid);
+end:
+	return ret;
+}
+
 #endif /* COMPAT_DIRFD */
 
 /*
@@ -354,6 +518,17 @@ int create_directory_check_exists(const struct lttng_directory_handle *handle,
 	 * semantics.
 	 */
 	ret = lttng_directory_handle_mkdir(handle, path, mode);
+	if (ret && errno == EEXIST) {
+		/*
+		 * The directory was created concurrently (e.g. by another
+		 * run-as worker) between the stat and the mkdir.
+		 */
+		ret = lttng_directory_handle_stat(handle, path, &st);
+		if (ret == 0 && !S_ISDIR(st.st_mode)) {
+			errno = ENOTDIR;
+			ret = -1;
+		}
+	}
 end:
 	return ret;
 }
@@ -473,3 +648,61 @@ int lttng_directory_handle_create_subdirectory_recursive(
 	return lttng_directory_handle_create_subdirectory_recursive_as_user(
 			handle, subdirectory_path, mode, NULL);
 }
+
+LTTNG_HIDDEN
+int lttng_directory_handle_open_file_as_user(
+		const struct lttng_directory_handle *handle,
+		const char *filename,
+		int flags, mode_t mode,
+		const struct lttng_credentials *creds)
+{
+	int ret;
+
+	if (!creds) {
+		/* Run as current user. */
+		ret = lttng_directory_handle_open(handle, filename, flags,
+				mode);
+	} else {
+		ret = _run_as_open(handle, filename, flags, mode,
+				creds->uid, creds->gid);
+	}
+
+	return ret;
+}
+
+LTTNG_HIDDEN
+int lttng_directory_handle_open_file(
+		const struct lttng_directory_handle *handle,
+		const char *filename,
+		int flags, mode_t mode)
+{
+	return lttng_directory_handle_open_file_as_user(handle, filename,
+			flags, mode, NULL);
+}
+
+LTTNG_HIDDEN
+int lttng_directory_handle_unlink_file_as_user(
+		const struct lttng_directory_handle *handle,
+		const char *filename,
+		const struct lttng_credentials *creds)
+{
+	int ret;
+
+	if (!creds) {
+		/* Run as current user. */
+		ret = lttng_directory_handle_unlink(handle, filename);
+	} else {
+		ret = _run_as_unlink(handle, filename, creds->uid, creds->gid);
+	}
+
+	return ret;
+}
+
+LTTNG_HIDDEN
+int lttng_directory_handle_unlink_file(
+		const struct lttng_directory_handle *handle,
+		const char *filename)
+{
+	return lttng_directory_handle_unlink_file_as_user(handle, filename,
+			NULL);
+}
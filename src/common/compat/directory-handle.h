@@ -51,6 +51,15 @@ LTTNG_HIDDEN
 int lttng_directory_handle_init(struct lttng_directory_handle *handle,
 		const char *path);
 
+/*
+ * Same as lttng_directory_handle_init(), the directory being opened with the
+ * provided credentials. Passing NULL credentials opens it as the current
+ * user.
+ */
+LTTNG_HIDDEN
+int lttng_directory_handle_init_as_user(struct lttng_directory_handle *handle,
+		const char *path, const struct lttng_credentials *creds);
+
 LTTNG_HIDDEN
 int lttng_directory_handle_init_from_dirfd(
 		struct lttng_directory_handle *handle, int dirfd);
@@ -99,4 +108,41 @@ int lttng_directory_handle_create_subdirectory_recursive_as_user(
 		const char *subdirectory_path,
 		mode_t mode, const struct lttng_credentials *creds);
 
+/*
+ * Open a file relative to a directory handle. The semantics are those of
+ * open(2); a file descriptor is returned on success, -1 on error.
+ */
+LTTNG_HIDDEN
+int lttng_directory_handle_open_file(
+		const struct lttng_directory_handle *handle,
+		const char *filename,
+		int flags, mode_t mode);
+
+/*
+ * Open a file relative to a directory handle as a given user.
+ */
+LTTNG_HIDDEN
+int lttng_directory_handle_open_file_as_user(
+		const struct lttng_directory_handle *handle,
+		const char *filename,
+		int flags, mode_t mode,
+		const struct lttng_credentials *creds);
+
+/*
+ * Unlink a file relative to a directory handle.
+ */
+LTTNG_HIDDEN
+int lttng_directory_handle_unlink_file(
+		const struct lttng_directory_handle *handle,
+		const char *filename);
+
+/*
+ * Unlink a file relative to a directory handle as a given user.
+ */
+LTTNG_HIDDEN
+int lttng_directory_handle_unlink_file_as_user(
+		const struct lttng_directory_handle *handle,
+		const char *filename,
+		const struct lttng_credentials *creds);
+
 #endif /* _COMPAT_PATH_HANDLE_H */
@@ -75,6 +75,9 @@ extern const char * const config_element_loglevel;
 extern const char * const config_element_loglevel_type;
 extern const char * const config_element_filter;
 extern const char * const config_element_filter_expression;
+extern const char * const config_element_filter_bytecode;
+extern const char * const config_element_filter_bytecode_key;
+extern const char * const config_element_filter_bytecode_data;
 extern const char * const config_element_snapshot_outputs;
 extern const char * const config_element_consumer_output;
 extern const char * const config_element_destination;
@@ -22,20 +22,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <dirent.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include <common/defaults.h>
 #include <common/error.h>
 #include <common/macros.h>
 #include <common/utils.h>
 #include <common/dynamic-buffer.h>
+#include <common/filter.h>
 #include <common/compat/getenv.h>
 #include <lttng/lttng-error.h>
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include <libxml/valid.h>
 #include <libxml/xmlschemas.h>
 #include <libxml/tree.h>
@@ -56,11 +60,24 @@ struct handler_filter_args {
 };
 
 struct session_config_validation_ctx {
-	xmlSchemaParserCtxtPtr parser_ctx;
+	/* Only set when the cached schema could not be used. */
 	xmlSchemaPtr schema;
 	xmlSchemaValidCtxtPtr schema_validation_ctx;
 };
 
+/*
+ * Compiled session configuration schema, parsed on the first load and kept
+ * until the library is unloaded. A parsed schema is never modified and can be
+ * shared by the validation contexts of concurrent loads.
+ */
+static struct {
+	pthread_mutex_t lock;
+	char *xsd_path;
+	xmlSchemaPtr schema;
+} session_config_schema_cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
 const char * const config_str_yes = "yes";
 const char * const config_str_true = "true";
 const char * const config_str_on = "on";
@@ -132,6 +149,9 @@ const char * const config_element_loglevel = "loglevel";
 const char * const config_element_loglevel_type = "loglevel_type";
 const char * const config_element_filter = "filter";
 LTTNG_HIDDEN const char * const config_element_filter_expression = "filter_expression";
+LTTNG_HIDDEN const char * const config_element_filter_bytecode = "filter_bytecode";
+LTTNG_HIDDEN const char * const config_element_filter_bytecode_key = "key";
+LTTNG_HIDDEN const char * const config_element_filter_bytecode_data = "data";
 const char * const config_element_snapshot_outputs = "snapshot_outputs";
 const char * const config_element_consumer_output = "consumer_output";
 const char * const config_element_destination = "destination";
@@ -640,6 +660,76 @@ end:
 	return ret >= 0 ? 0 : ret;
 }
 
+LTTNG_HIDDEN
+int config_writer_write_element_bin_hex(struct config_writer *writer,
+		const char *element_name, const void *data, size_t len)
+{
+	int ret;
+	xmlChar *encoded_element_name = NULL;
+
+	if (!writer || !writer->writer || !element_name || !element_name[0] ||
+			!data || len > INT_MAX) {
+		ret = -1;
+		goto end;
+	}
+
+	encoded_element_name = encode_string(element_name);
+	if (!encoded_element_name) {
+		ret = -1;
+		goto end;
+	}
+
+	ret = xmlTextWriterStartElement(writer->writer, encoded_element_name);
+	if (ret < 0) {
+		goto end;
+	}
+
+	ret = xmlTextWriterWriteBinHex(writer->writer, data, 0, (int) len);
+	if (ret < 0) {
+		goto end;
+	}
+
+	ret = xmlTextWriterEndElement(writer->writer);
+end:
+	xmlFree(encoded_element_name);
+	return ret >= 0 ? 0 : ret;
+}
+
+LTTNG_HIDDEN
+uint64_t config_get_filter_bytecode_key(const char *filter_expression)
+{
+	/* Laid out in the byte order of the bytecode's header. */
+	const uint32_t byte_order_marker = 0x01020304;
+	const uint32_t generator_version =
+			LTTNG_FILTER_BYTECODE_GENERATOR_VERSION;
+	const unsigned char *byte;
+	uint64_t key = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	/*
+	 * 64-bit FNV-1a hash of the byte order marker, the bytecode generator
+	 * and package versions, and the expression. The strings are hashed
+	 * with their terminating null byte so that they can't run together.
+	 */
+	byte = (const unsigned char *) &byte_order_marker;
+	for (i = 0; i < sizeof(byte_order_marker); i++) {
+		key = (key ^ byte[i]) * 0x100000001b3ULL;
+	}
+	byte = (const unsigned char *) &generator_version;
+	for (i = 0; i < sizeof(generator_version); i++) {
+		key = (key ^ byte[i]) * 0x100000001b3ULL;
+	}
+	byte = (const unsigned char *) VERSION;
+	do {
+		key = (key ^ *byte) * 0x100000001b3ULL;
+	} while (*byte++);
+	for (byte = (const unsigned char *) filter_expression; *byte; byte++) {
+		key = (key ^ *byte) * 0x100000001b3ULL;
+	}
+
+	return key;
+}
+
 static
 void xml_error_handler(void *ctx, const char *format, ...)
 {
@@ -663,18 +753,14 @@ static
 void fini_session_config_validation_ctx(
 	struct session_config_validation_ctx *ctx)
 {
-	if (ctx->parser_ctx) {
-		xmlSchemaFreeParserCtxt(ctx->parser_ctx);
+	if (ctx->schema_validation_ctx) {
+		xmlSchemaFreeValidCtxt(ctx->schema_validation_ctx);
 	}
 
 	if (ctx->schema) {
 		xmlSchemaFree(ctx->schema);
 	}
 
-	if (ctx->schema_validation_ctx) {
-		xmlSchemaFreeValidCtxt(ctx->schema_validation_ctx);
-	}
-
 	memset(ctx, 0, sizeof(struct session_config_validation_ctx));
 }
 
@@ -708,11 +794,36 @@ end:
 	return xsd_path;
 }
 
+static
+xmlSchemaPtr parse_session_config_schema(const char *xsd_path)
+{
+	xmlSchemaParserCtxtPtr parser_ctx;
+	xmlSchemaPtr schema = NULL;
+
+	parser_ctx = xmlSchemaNewParserCtxt(xsd_path);
+	if (!parser_ctx) {
+		ERR("XSD parser context creation failed");
+		goto end;
+	}
+	xmlSchemaSetParserErrors(parser_ctx, xml_error_handler,
+		xml_error_handler, NULL);
+
+	schema = xmlSchemaParse(parser_ctx);
+	if (!schema) {
+		ERR("XSD parsing failed");
+	}
+
+	xmlSchemaFreeParserCtxt(parser_ctx);
+end:
+	return schema;
+}
+
 static
 int init_session_config_validation_ctx(
 	struct session_config_validation_ctx *ctx)
 {
 	int ret;
+	xmlSchemaPtr schema;
 	char *xsd_path = get_session_config_xsd_path();
 
 	if (!xsd_path) {
@@ -720,23 +831,32 @@ int init_session_config_validation_ctx(
 		goto end;
 	}
 
-	ctx->parser_ctx = xmlSchemaNewParserCtxt(xsd_path);
-	if (!ctx->parser_ctx) {
-		ERR("XSD parser context creation failed");
-		ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
-		goto end;
+	pthread_mutex_lock(&session_config_schema_cache.lock);
+	if (!session_config_schema_cache.schema) {
+		session_config_schema_cache.schema =
+				parse_session_config_schema(xsd_path);
+		if (session_config_schema_cache.schema) {
+			session_config_schema_cache.xsd_path = xsd_path;
+			xsd_path = NULL;
+		}
+		schema = session_config_schema_cache.schema;
+	} else if (!strcmp(session_config_schema_cache.xsd_path, xsd_path)) {
+		schema = session_config_schema_cache.schema;
+	} else {
+		/*
+		 * The XSD path changed since the schema was cached. Keep the
+		 * cached schema, it may be in use by another load.
+		 */
+		ctx->schema = parse_session_config_schema(xsd_path);
+		schema = ctx->schema;
 	}
-	xmlSchemaSetParserErrors(ctx->parser_ctx, xml_error_handler,
-		xml_error_handler, NULL);
-
-	ctx->schema = xmlSchemaParse(ctx->parser_ctx);
-	if (!ctx->schema) {
-		ERR("XSD parsing failed");
+	pthread_mutex_unlock(&session_config_schema_cache.lock);
+	if (!schema) {
 		ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
 		goto end;
 	}
 
-	ctx->schema_validation_ctx = xmlSchemaNewValidCtxt(ctx->schema);
+	ctx->schema_validation_ctx = xmlSchemaNewValidCtxt(schema);
 	if (!ctx->schema_validation_ctx) {
 		ERR("XSD validation context creation failed");
 		ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
@@ -778,6 +898,59 @@ end:
 	return ret;
 }
 
+static
+int parse_hex_binary(xmlChar *str, void **data, size_t *len)
+{
+	int ret;
+	size_t i, str_len;
+	unsigned char *decoded = NULL;
+	const char *hex = (const char *) str;
+
+	if (!str || !data || !len) {
+		ret = -1;
+		goto end;
+	}
+
+	/* Leading and trailing white spaces are collapsed by the schema. */
+	while (isspace((unsigned char) *hex)) {
+		hex++;
+	}
+	str_len = strlen(hex);
+	while (str_len && isspace((unsigned char) hex[str_len - 1])) {
+		str_len--;
+	}
+
+	if (!str_len || str_len % 2) {
+		ret = -1;
+		goto end;
+	}
+
+	decoded = zmalloc(str_len / 2);
+	if (!decoded) {
+		ret = -1;
+		goto end;
+	}
+
+	for (i = 0; i < str_len; i += 2) {
+		char byte_str[3] = { hex[i], hex[i + 1], '\0' };
+		char *endptr;
+
+		decoded[i / 2] = (unsigned char) strtoul(byte_str, &endptr, 16);
+		if (*endptr || !isxdigit((unsigned char) byte_str[0])) {
+			ret = -1;
+			goto end;
+		}
+	}
+
+	*data = decoded;
+	*len = str_len / 2;
+	decoded = NULL;
+	ret = 0;
+end:
+	free(decoded);
+	return ret;
+}
+
 static
 int parse_int(xmlChar *str, int64_t *val)
 {
@@ -1724,9 +1897,14 @@ end:
 	return ret;
 }
 
+/*
+ * Enable an event described by an event node, or add it to batch when the
+ * event can be batched.
+ */
 static
 int process_event_node(xmlNodePtr event_node, struct lttng_handle *handle,
-	const char *channel_name, const enum process_event_node_phase phase)
+	const char *channel_name, const enum process_event_node_phase phase,
+	struct lttng_event_batch *batch)
 {
 	int ret = 0, i;
 	xmlNodePtr node;
@@ -1734,6 +1912,9 @@ int process_event_node(xmlNodePtr event_node, struct lttng_handle *handle,
 	char **exclusions = NULL;
 	unsigned long exclusion_count = 0;
 	char *filter_expression = NULL;
+	uint64_t filter_bytecode_key = 0;
+	void *filter_bytecode = NULL;
+	size_t filter_bytecode_len = 0;
 
 	assert(event_node);
 	assert(handle);
@@ -1886,6 +2067,39 @@ int process_event_node(xmlNodePtr event_node, struct lttng_handle *handle,
 				ret = -LTTNG_ERR_NOMEM;
 				goto end;
 			}
+		} else if (!strcmp((const char *) node->name,
+			config_element_filter_bytecode)) {
+			xmlNodePtr bytecode_node;
+
+			/* filter_bytecode */
+			for (bytecode_node = xmlFirstElementChild(node);
+					bytecode_node; bytecode_node =
+					xmlNextElementSibling(bytecode_node)) {
+				xmlChar *content =
+					xmlNodeGetContent(bytecode_node);
+
+				if (!content) {
+					ret = -LTTNG_ERR_NOMEM;
+					goto end;
+				}
+
+				if (!strcmp((const char *) bytecode_node->name,
+						config_element_filter_bytecode_key)) {
+					ret = parse_uint(content,
+							&filter_bytecode_key);
+				} else {
+					free(filter_bytecode);
+					filter_bytecode = NULL;
+					ret = parse_hex_binary(content,
+							&filter_bytecode,
+							&filter_bytecode_len);
+				}
+				free(content);
+				if (ret) {
+					ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
+					goto end;
+				}
+			}
 		} else if (!strcmp((const char *) node->name,
 			config_element_exclusions)) {
 			xmlNodePtr exclusion_node;
@@ -2039,8 +2253,32 @@ int process_event_node(xmlNodePtr event_node, struct lttng_handle *handle,
 	}
 
 	if ((event->enabled && phase == ENABLE) || phase == CREATION) {
-		ret = lttng_enable_event_with_exclusions(handle, event, channel_name,
-				filter_expression, exclusion_count, exclusions);
+		if (event->type != LTTNG_EVENT_USERSPACE_PROBE) {
+			ret = -1;
+			/*
+			 * Use the saved bytecode of the filter, if it still
+			 * matches the expression, rather than compiling it.
+			 */
+			if (filter_expression && filter_bytecode &&
+					filter_bytecode_key ==
+					config_get_filter_bytecode_key(
+						filter_expression)) {
+				ret = lttng_event_batch_add_with_filter_bytecode(
+						batch, event, filter_expression,
+						filter_bytecode,
+						filter_bytecode_len,
+						exclusion_count, exclusions);
+			}
+			if (ret) {
+				ret = lttng_event_batch_add(batch, event,
+						filter_expression,
+						exclusion_count, exclusions);
+			}
+		} else {
+			ret = lttng_enable_event_with_exclusions(handle, event,
+					channel_name, filter_expression,
+					exclusion_count, exclusions);
+		}
 		if (ret < 0) {
 			WARN("Enabling event (name:%s) on load failed.", event->name);
 			ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
@@ -2056,6 +2294,55 @@ end:
 	lttng_event_destroy(event);
 	free(exclusions);
 	free(filter_expression);
+	free(filter_bytecode);
+	return ret;
+}
+
+/*
+ * Enable the events of a channel in a single command to the session daemon.
+ */
+static
+int process_event_nodes(xmlNodePtr events_node, struct lttng_handle *handle,
+	const char *channel_name, const enum process_event_node_phase phase)
+{
+	int ret = 0, i, count;
+	xmlNodePtr node;
+	struct lttng_event_batch *batch;
+
+	batch = lttng_event_batch_create(handle, channel_name);
+	if (!batch) {
+		ret = -LTTNG_ERR_NOMEM;
+		goto end;
+	}
+
+	for (node = xmlFirstElementChild(events_node); node;
+		node = xmlNextElementSibling(node)) {
+		ret = process_event_node(node, handle, channel_name, phase,
+				batch);
+		if (ret) {
+			goto end;
+		}
+	}
+
+	ret = lttng_enable_event_batch(batch);
+	if (ret < 0) {
+		WARN("Enabling events of channel %s on load failed.",
+				channel_name);
+		ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
+		goto end;
+	}
+
+	count = lttng_event_batch_get_count(batch);
+	for (i = 0; i < count; i++) {
+		if (lttng_event_batch_get_status(batch, i) < 0) {
+			WARN("Enabling event (name:%s) on load failed.",
+					lttng_event_batch_get_event_name(batch, i));
+			ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
+			goto end;
+		}
+	}
+end:
+	lttng_event_batch_destroy(batch);
 	return ret;
 }
 
@@ -2065,18 +2352,14 @@ int process_events_node(xmlNodePtr events_node, struct lttng_handle *handle,
 {
 	int ret = 0;
 	struct lttng_event event;
-	xmlNodePtr node;
 
 	assert(events_node);
 	assert(handle);
 	assert(channel_name);
 
-	for (node = xmlFirstElementChild(events_node); node;
-		node = xmlNextElementSibling(node)) {
-		ret = process_event_node(node, handle, channel_name, CREATION);
-		if (ret) {
-			goto end;
-		}
+	ret = process_event_nodes(events_node, handle, channel_name, CREATION);
+	if (ret) {
+		goto end;
 	}
 
 	/*
@@ -2092,14 +2375,7 @@ int process_events_node(xmlNodePtr events_node, struct lttng_handle *handle,
 		goto end;
 	}
 
-	for (node = xmlFirstElementChild(events_node); node;
-			node = xmlNextElementSibling(node)) {
-		ret = process_event_node(node, handle, channel_name, ENABLE);
-		if (ret) {
-			goto end;
-		}
-	}
-
+	ret = process_event_nodes(events_node, handle, channel_name, ENABLE);
 end:
 	return ret;
 }
@@ -3263,15 +3539,20 @@ valid:
 	return 1;
 }
 
+/*
+ * The configuration file is read with a streaming reader rather than parsed
+ * into a document: only the session being loaded is kept in memory. Its
+ * subtree is validated against the schema as the reader moves past it, before
+ * it is processed.
+ */
 static
 int load_session_from_file(const char *path, const char *session_name,
 	struct session_config_validation_ctx *validation_ctx, int overwrite,
 	const struct config_load_session_override_attr *overrides)
 {
-	int ret, session_found = !session_name;
-	xmlDocPtr doc = NULL;
-	xmlNodePtr sessions_node;
-	xmlNodePtr session_node;
+	int ret, read_ret, session_found = !session_name;
+	xmlTextReaderPtr reader = NULL;
+	xmlNodePtr session_node = NULL;
 
 	assert(path);
 	assert(validation_ctx);
@@ -3286,37 +3567,79 @@ int load_session_from_file(const char *path, const char *session_name,
 		goto end;
 	}
 
-	doc = xmlParseFile(path);
-	if (!doc) {
+	reader = xmlReaderForFile(path, NULL, 0);
+	if (!reader) {
 		ret = -LTTNG_ERR_LOAD_IO_FAIL;
 		goto end;
 	}
 
-	ret = xmlSchemaValidateDoc(validation_ctx->schema_validation_ctx, doc);
+	ret = xmlTextReaderSchemaValidateCtxt(reader,
+			validation_ctx->schema_validation_ctx, 0);
 	if (ret) {
-		ERR("Session configuration file validation failed");
+		ERR("Failed to set up session configuration file validation");
 		ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
 		goto end;
 	}
 
-	sessions_node = xmlDocGetRootElement(doc);
-	if (!sessions_node) {
-		goto end;
-	}
+	read_ret = xmlTextReaderRead(reader);
+	while (read_ret == 1) {
+		xmlNodePtr expanded_node;
+
+		/* Sessions are the children of the root element. */
+		if (xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT ||
+				xmlTextReaderDepth(reader) != 1) {
+			read_ret = xmlTextReaderRead(reader);
+			continue;
+		}
+
+		expanded_node = xmlTextReaderExpand(reader);
+		if (!expanded_node) {
+			read_ret = -1;
+			break;
+		}
+
+		/* The reader frees the subtree once it has moved past it. */
+		session_node = xmlCopyNode(expanded_node, 1);
+		if (!session_node) {
+			ret = -LTTNG_ERR_NOMEM;
+			goto end;
+		}
+
+		read_ret = xmlTextReaderNext(reader);
+		if (read_ret == -1) {
+			break;
+		}
+
+		if (xmlTextReaderIsValid(reader) != 1) {
+			ERR("Session configuration file validation failed");
+			ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
+			goto end;
+		}
 
-	for (session_node = xmlFirstElementChild(sessions_node);
-		session_node; session_node =
-			xmlNextElementSibling(session_node)) {
 		ret = process_session_node(session_node,
 			session_name, overwrite, overrides);
+		xmlFreeNode(session_node);
+		session_node = NULL;
 		if (session_name && ret == 0) {
 			/* Target session found and loaded */
 			session_found = 1;
-			break;
+			goto end;
 		}
 	}
+
+	if (read_ret == -1) {
+		ret = -LTTNG_ERR_LOAD_IO_FAIL;
+		goto end;
+	}
+
+	if (xmlTextReaderIsValid(reader) != 1) {
+		ERR("Session configuration file validation failed");
+		ret = -LTTNG_ERR_LOAD_INVALID_CONFIG;
+		goto end;
+	}
 end:
-	xmlFreeDoc(doc);
+	xmlFreeNode(session_node);
+	xmlFreeTextReader(reader);
 	if (!ret) {
 		ret = session_found ? 0 : -LTTNG_ERR_LOAD_SESSION_NOENT;
 	}
@@ -3523,9 +3846,16 @@ int config_load_session(const char *path, const char *session_name,
 {
 	int ret;
 	bool session_loaded = false;
+	bool persistent_connection;
 	const char *path_ptr = NULL;
 	struct session_config_validation_ctx validation_ctx = { 0 };
 
+	/*
+	 * Issue all the commands of the load over a single session daemon
+	 * connection. A failure to connect is reported by those commands.
+	 */
+	persistent_connection = !lttng_persistent_connection_open();
+
 	ret = init_session_config_validation_ctx(&validation_ctx);
 	if (ret) {
 		goto end;
@@ -3632,6 +3962,9 @@ int config_load_session(const char *path, const char *session_name,
 	}
 end:
 	fini_session_config_validation_ctx(&validation_ctx);
+	if (persistent_connection) {
+		(void) lttng_persistent_connection_close();
+	}
 	if (ret == -LTTNG_ERR_LOAD_SESSION_NOENT && !session_name && !path) {
 		/*
 		 * Don't report an error if no sessions are found when called
@@ -3650,5 +3983,7 @@ end:
 static
 void __attribute__((destructor)) session_config_exit(void)
 {
+	xmlSchemaFree(session_config_schema_cache.schema);
+	free(session_config_schema_cache.xsd_path);
 	xmlCleanupParser();
 }
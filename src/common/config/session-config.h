@@ -210,6 +210,35 @@ LTTNG_HIDDEN
 int config_writer_write_element_string(struct config_writer *writer,
 		const char *element_name, const char *value);
 
+/*
+ * Write an element of type binary, encoded in hexadecimal.
+ *
+ * writer An instance of a configuration writer.
+ *
+ * element_name Element name.
+ *
+ * data Value of the element.
+ *
+ * len Length of data in bytes.
+ *
+ * Returns zero if the element's value could be written.
+ * Negative values indicate an error.
+ */
+LTTNG_HIDDEN
+int config_writer_write_element_bin_hex(struct config_writer *writer,
+		const char *element_name, const void *data, size_t len);
+
+/*
+ * Return the key identifying the filter bytecode compiled from a filter
+ * expression on this host. Saved bytecode is only used on load if its key
+ * matches the key of the event's filter expression: this catches
+ * expressions edited after the save, bytecode saved on a host of a
+ * different byte order, and bytecode saved by another version of LTTng or
+ * of the bytecode generator. Such filters are compiled again.
+ */
+LTTNG_HIDDEN
+uint64_t config_get_filter_bytecode_key(const char *filter_expression);
+
 /*
  * Load session configurations from a file.
  *
@@ -86,6 +86,32 @@ void consumer_stream_relayd_close(struct lttng_consumer_stream *stream,
 	stream->sent_to_relayd = 0;
 }
 
+/*
+ * Close the output files created ahead of a rotation for the next trace chunk
+ * of the stream, if any.
+ *
+ * The stream lock MUST be acquired.
+ */
+void consumer_stream_close_next_chunk_files(struct lttng_consumer_stream *stream)
+{
+	int ret;
+
+	assert(stream);
+
+	if (stream->rotate_next_out_fd >= 0) {
+		ret = close(stream->rotate_next_out_fd);
+		if (ret) {
+			PERROR("close");
+		}
+		stream->rotate_next_out_fd = -1;
+	}
+
+	if (stream->rotate_next_index_file) {
+		lttng_index_file_put(stream->rotate_next_index_file);
+		stream->rotate_next_index_file = NULL;
+	}
+}
+
 /*
  * Close stream's file descriptors and, if needed, close stream also on the
  * relayd side.
@@ -164,6 +190,8 @@ void consumer_stream_close(struct lttng_consumer_stream *stream)
 		stream->index_file = NULL;
 	}
 
+	consumer_stream_close_next_chunk_files(stream);
+
 	/* Check and cleanup relayd if needed. */
 	rcu_read_lock();
 	relayd = consumer_find_relayd(stream->net_seq_idx);
@@ -29,6 +29,14 @@
  */
 void consumer_stream_close(struct lttng_consumer_stream *stream);
 
+/*
+ * Close the output files created ahead of a rotation for the next trace chunk
+ * of the stream, if any.
+ *
+ * The stream lock MUST be acquired.
+ */
+void consumer_stream_close_next_chunk_files(struct lttng_consumer_stream *stream);
+
 /*
  * Close stream on the relayd side. This call can destroy a relayd if the
  * conditions are met.
@@ -25,11 +25,13 @@
 #include <bin/lttng-consumerd/health-consumerd.h>
 #include <common/common.h>
 #include <common/compat/endian.h>
+#include <common/dynamic-buffer.h>
 #include <common/kernel-ctl/kernel-ctl.h>
 #include <common/kernel-consumer/kernel-consumer.h>
 #include <common/consumer/consumer-stream.h>
 #include <common/consumer/consumer-timer.h>
 #include <common/consumer/consumer-testpoint.h>
+#include <common/relayd/relayd.h>
 #include <common/ust-consumer/ust-consumer.h>
 
 typedef int (*sample_positions_cb)(struct lttng_consumer_stream *stream);
@@ -130,25 +132,56 @@ static void metadata_switch_timer(struct lttng_consumer_local_data *ctx,
 	}
 }
 
+/*
+ * Beacons of the streams of a channel collected during a live timer tick,
+ * sent to the relayd in a single command once all streams were checked.
+ */
+struct live_beacon_batch {
+	/* Relayd of the streams, -1ULL until the first beacon is added. */
+	uint64_t net_seq_idx;
+	/* Array of struct lttcomm_relayd_beacon, in big endian. */
+	struct lttng_dynamic_buffer beacons;
+};
+
 static int send_empty_index(struct lttng_consumer_stream *stream, uint64_t ts,
-		uint64_t stream_id)
+		uint64_t stream_id, struct live_beacon_batch *batch)
 {
 	int ret;
 	struct ctf_packet_index index;
 
+	if (batch && stream->net_seq_idx != (uint64_t) -1ULL &&
+			(batch->net_seq_idx == (uint64_t) -1ULL ||
+			 batch->net_seq_idx == stream->net_seq_idx)) {
+		struct lttcomm_relayd_beacon beacon;
+
+		memset(&beacon, 0, sizeof(beacon));
+		beacon.relay_stream_id = htobe64(stream->relayd_stream_id);
+		beacon.net_seq_num = htobe64(stream->next_net_seq_num - 1);
+		beacon.timestamp_end = htobe64(ts);
+		beacon.stream_id = htobe64(stream_id);
+		ret = lttng_dynamic_buffer_append(&batch->beacons, &beacon,
+				sizeof(beacon));
+		if (ret) {
+			goto end;
+		}
+		batch->net_seq_idx = stream->net_seq_idx;
+		goto end;
+	}
+
 	memset(&index, 0, sizeof(index));
 	index.stream_id = htobe64(stream_id);
 	index.timestamp_end = htobe64(ts);
 	ret = consumer_stream_write_index(stream, &index);
 	if (ret < 0) {
-		goto error;
+		goto end;
 	}
 
-error:
+end:
 	return ret;
 }
 
-int consumer_flush_kernel_index(struct lttng_consumer_stream *stream)
+static int flush_kernel_index(struct lttng_consumer_stream *stream,
+		struct live_beacon_batch *batch)
 {
 	uint64_t ts, stream_id;
 	int ret;
@@ -176,7 +209,7 @@ int consumer_flush_kernel_index(struct lttng_consumer_stream *stream)
 			goto end;
 		}
 		DBG("Stream %" PRIu64 " empty, sending beacon", stream->key);
-		ret = send_empty_index(stream, ts, stream_id);
+		ret = send_empty_index(stream, ts, stream_id, batch);
 		if (ret < 0) {
 			goto end;
 		}
@@ -186,7 +219,13 @@ end:
 	return ret;
 }
 
-static int check_kernel_stream(struct lttng_consumer_stream *stream)
+int consumer_flush_kernel_index(struct lttng_consumer_stream *stream)
+{
+	return flush_kernel_index(stream, NULL);
+}
+
+static int check_kernel_stream(struct lttng_consumer_stream *stream,
+		struct live_beacon_batch *batch)
 {
 	int ret;
 
@@ -225,13 +264,14 @@ static int check_kernel_stream(struct lttng_consumer_stream *stream)
 		}
 		break;
 	}
-	ret = consumer_flush_kernel_index(stream);
+	ret = flush_kernel_index(stream, batch);
 	pthread_mutex_unlock(&stream->lock);
 end:
 	return ret;
 }
 
-int consumer_flush_ust_index(struct lttng_consumer_stream *stream)
+static int flush_ust_index(struct lttng_consumer_stream *stream,
+		struct live_beacon_batch *batch)
 {
 	uint64_t ts, stream_id;
 	int ret;
@@ -260,7 +300,7 @@ int consumer_flush_ust_index(struct lttng_consumer_stream *stream)
 			goto end;
 		}
 		DBG("Stream %" PRIu64 " empty, sending beacon", stream->key);
-		ret = send_empty_index(stream, ts, stream_id);
+		ret = send_empty_index(stream, ts, stream_id, batch);
 		if (ret < 0) {
 			goto end;
 		}
@@ -270,7 +310,13 @@ end:
 	return ret;
 }
 
-static int check_ust_stream(struct lttng_consumer_stream *stream)
+int consumer_flush_ust_index(struct lttng_consumer_stream *stream)
+{
+	return flush_ust_index(stream, NULL);
+}
+
+static int check_ust_stream(struct lttng_consumer_stream *stream,
+		struct live_beacon_batch *batch)
 {
 	int ret;
 
@@ -311,14 +357,61 @@ static int check_ust_stream(struct lttng_consumer_stream *stream)
 		}
 		break;
 	}
-	ret = consumer_flush_ust_index(stream);
+	ret = flush_ust_index(stream, batch);
 	pthread_mutex_unlock(&stream->lock);
 end:
 	return ret;
 }
 
+/*
+ * Send the beacons collected during a live timer tick to the relayd.
+ */
+static int send_beacon_batch(struct live_beacon_batch *batch)
+{
+	int ret;
+	struct consumer_relayd_sock_pair *relayd;
+	uint32_t count = batch->beacons.size /
+			sizeof(struct lttcomm_relayd_beacon);
+
+	if (!count) {
+		ret = 0;
+		goto end;
+	}
+
+	rcu_read_lock();
+	relayd = consumer_find_relayd(batch->net_seq_idx);
+	if (!relayd) {
+		ERR("Relayd ID %" PRIu64 " unknown. Can't send beacons.",
+				batch->net_seq_idx);
+		ret = -1;
+		goto end_unlock;
+	}
+	pthread_mutex_lock(&relayd->ctrl_sock_mutex);
+	ret = relayd_send_beacons(&relayd->control_sock,
+			(const struct lttcomm_relayd_beacon *) batch->beacons.data,
+			count);
+	if (ret < 0) {
+		/*
+		 * Communication error with lttng-relayd,
+		 * perform cleanup now
+		 */
+		ERR("Relayd send beacons failed. Cleaning up relayd %" PRIu64 ".",
+				relayd->net_seq_idx);
+		lttng_consumer_cleanup_relayd(relayd);
+		ret = -1;
+	}
+	pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+end_unlock:
+	rcu_read_unlock();
+end:
+	return ret;
+}
+
 /*
  * Execute action on a live timer
+ *
+ * The beacons of the quiescent streams of the channel are coalesced into a
+ * single relayd command per tick.
  */
 static void live_timer(struct lttng_consumer_local_data *ctx,
 		siginfo_t *si)
@@ -328,10 +421,14 @@ static void live_timer(struct lttng_consumer_local_data *ctx,
 	struct lttng_consumer_stream *stream;
 	struct lttng_ht *ht;
 	struct lttng_ht_iter iter;
+	struct live_beacon_batch batch;
 
 	channel = si->si_value.sival_ptr;
 	assert(channel);
 
+	batch.net_seq_idx = -1ULL;
+	lttng_dynamic_buffer_init(&batch.beacons);
+
 	if (channel->switch_timer_error) {
 		goto error;
 	}
@@ -347,7 +444,7 @@ static void live_timer(struct lttng_consumer_local_data *ctx,
 				ht->hash_fct(&channel->key, lttng_ht_seed),
 				ht->match_fct, &channel->key, &iter.iter,
 				stream, node_channel_id.node) {
-			ret = check_ust_stream(stream);
+			ret = check_ust_stream(stream, &batch);
 			if (ret < 0) {
 				goto error_unlock;
 			}
@@ -358,7 +455,7 @@ static void live_timer(struct lttng_consumer_local_data *ctx,
 				ht->hash_fct(&channel->key, lttng_ht_seed),
 				ht->match_fct, &channel->key, &iter.iter,
 				stream, node_channel_id.node) {
-			ret = check_kernel_stream(stream);
+			ret = check_kernel_stream(stream, &batch);
 			if (ret < 0) {
 				goto error_unlock;
 			}
@@ -369,10 +466,13 @@ static void live_timer(struct lttng_consumer_local_data *ctx,
 		break;
 	}
 
+	(void) send_beacon_batch(&batch);
+
 error_unlock:
 	rcu_read_unlock();
 
 error:
+	lttng_dynamic_buffer_reset(&batch.beacons);
 	return;
 }
 
@@ -707,10 +807,13 @@ end:
 }
 
 /*
- * Execute action on a monitor timer.
+ * Send a monitoring sample of the channel to the session daemon.
+ *
+ * Executed on a monitor timer expiration. Also called by the data threads
+ * when the session of the channel reaches its rotation threshold; no stream
+ * lock may be held by the caller.
  */
-static
-void monitor_timer(struct lttng_consumer_channel *channel)
+void consumer_timer_monitor_sample(struct lttng_consumer_channel *channel)
 {
 	int ret;
 	int channel_monitor_pipe =
@@ -849,7 +952,7 @@ void *consumer_timer_thread(void *data)
 			struct lttng_consumer_channel *channel;
 
 			channel = info.si_value.sival_ptr;
-			monitor_timer(channel);
+			consumer_timer_monitor_sample(channel);
 		} else if (signr == LTTNG_CONSUMER_SIG_EXIT) {
 			assert(CMM_LOAD_SHARED(consumer_quit));
 			goto end;
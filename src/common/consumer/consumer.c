@@ -48,6 +48,7 @@
 #include <common/consumer/consumer-testpoint.h>
 #include <common/align.h>
 #include <common/consumer/consumer-metadata-cache.h>
+#include <common/dynamic-buffer.h>
 
 struct lttng_consumer_global_data consumer_data = {
 	.stream_count = 0,
@@ -281,6 +282,64 @@ static void steal_channel_key(uint64_t key)
 	rcu_read_unlock();
 }
 
+/*
+ * Close the handle on the output directory of a channel. The next file
+ * created in the channel's directory opens it again.
+ *
+ * Must be called with the output directory lock held.
+ */
+static void close_channel_output_dir_handle(
+		struct lttng_consumer_channel *channel)
+{
+	if (!channel->output_dir_handle) {
+		return;
+	}
+	lttng_directory_handle_fini(channel->output_dir_handle);
+	free(channel->output_dir_handle);
+	channel->output_dir_handle = NULL;
+}
+
+/*
+ * Get the handle on the local output directory of a channel, opening it as
+ * the channel's user if needed. The handle stays valid as long as the output
+ * directory lock is held.
+ *
+ * Must be called with the output directory lock held.
+ *
+ * Return the handle on success or else NULL.
+ */
+struct lttng_directory_handle *consumer_channel_get_output_dir_handle(
+		struct lttng_consumer_channel *channel)
+{
+	int ret;
+	struct lttng_directory_handle *handle;
+	const struct lttng_credentials creds = {
+		.uid = channel->uid,
+		.gid = channel->gid,
+	};
+
+	if (channel->output_dir_handle) {
+		goto end;
+	}
+
+	handle = zmalloc(sizeof(*handle));
+	if (!handle) {
+		PERROR("zmalloc directory handle");
+		goto end;
+	}
+	ret = lttng_directory_handle_init_as_user(handle, channel->pathname,
+			&creds);
+	if (ret) {
+		ERR("Failed to open the output directory %s of channel %" PRIu64,
+				channel->pathname, channel->key);
+		free(handle);
+		goto end;
+	}
+	channel->output_dir_handle = handle;
+end:
+	return channel->output_dir_handle;
+}
+
 static void free_channel_rcu(struct rcu_head *head)
 {
 	struct lttng_ht_node_u64 *node =
@@ -299,6 +358,8 @@ static void free_channel_rcu(struct rcu_head *head)
 		ERR("Unknown consumer_data type");
 		abort();
 	}
+	close_channel_output_dir_handle(channel);
+	pthread_mutex_destroy(&channel->output_dir_lock);
 	free(channel);
 }
 
@@ -587,6 +648,8 @@ struct lttng_consumer_stream *consumer_allocate_stream(uint64_t channel_key,
 	stream->monitor = monitor;
 	stream->endpoint_status = CONSUMER_ENDPOINT_ACTIVE;
 	stream->index_file = NULL;
+	stream->rotate_next_out_fd = -1;
+	stream->rotate_next_index_file = NULL;
 	stream->last_sequence_number = -1ULL;
 	stream->trace_archive_id = trace_archive_id;
 	pthread_mutex_init(&stream->lock, NULL);
@@ -991,6 +1054,7 @@ struct lttng_consumer_channel *consumer_allocate_channel(uint64_t key,
 	channel->live_timer_interval = live_timer_interval;
 	pthread_mutex_init(&channel->lock, NULL);
 	pthread_mutex_init(&channel->timer_lock, NULL);
+	pthread_mutex_init(&channel->output_dir_lock, NULL);
 
 	switch (output) {
 	case LTTNG_EVENT_SPLICE:
@@ -1206,6 +1270,33 @@ int lttng_consumer_send_error(struct lttng_consumer_local_data *ctx, int cmd)
 	return 0;
 }
 
+static void free_session_rotate_threshold_rcu(struct rcu_head *head)
+{
+	struct lttng_ht_node_u64 *node =
+		caa_container_of(head, struct lttng_ht_node_u64, head);
+	struct consumer_session_rotate_threshold *session =
+		caa_container_of(node, struct consumer_session_rotate_threshold,
+				node);
+
+	free(session);
+}
+
+static void cleanup_session_rotate_threshold_ht(void)
+{
+	struct lttng_ht_iter iter;
+	struct consumer_session_rotate_threshold *session;
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(consumer_data.session_rotate_threshold_ht->ht,
+			&iter.iter, session, node.node) {
+		lttng_ht_del(consumer_data.session_rotate_threshold_ht, &iter);
+		call_rcu(&session->node.head, free_session_rotate_threshold_rcu);
+	}
+	rcu_read_unlock();
+
+	lttng_ht_destroy(consumer_data.session_rotate_threshold_ht);
+}
+
 /*
  * Close all the tracefiles and stream fds and MUST be called when all
  * instances are destroyed i.e. when all threads were joined and are ended.
@@ -1230,6 +1321,8 @@ void lttng_consumer_cleanup(void)
 
 	lttng_ht_destroy(consumer_data.stream_per_chan_id_ht);
 
+	cleanup_session_rotate_threshold_ht();
+
 	/*
 	 * This HT contains streams that are freed by either the metadata thread or
 	 * the data thread so we do *nothing* on the hash table and simply destroy
@@ -1513,6 +1606,56 @@ end:
 	return (int) ret;
 }
 
+/*
+ * Switch a local stream to its next tracefile, and index file, once the
+ * current one is full. Both files are created through the handle on the
+ * channel's output directory.
+ *
+ * It must be called with the stream lock held.
+ *
+ * Return 0 on success or else a negative value.
+ */
+static
+int rotate_stream_tracefile(struct lttng_consumer_stream *stream)
+{
+	int ret;
+	struct lttng_directory_handle *dir_handle;
+
+	pthread_mutex_lock(&stream->chan->output_dir_lock);
+	dir_handle = consumer_channel_get_output_dir_handle(stream->chan);
+	if (!dir_handle) {
+		ret = -1;
+		goto end;
+	}
+
+	ret = utils_rotate_stream_file_at(dir_handle,
+			stream->name, stream->chan->tracefile_size,
+			stream->chan->tracefile_count, stream->uid, stream->gid,
+			stream->out_fd, &(stream->tracefile_count_current),
+			&stream->out_fd);
+	if (ret < 0) {
+		goto end;
+	}
+
+	if (stream->index_file) {
+		lttng_index_file_put(stream->index_file);
+		stream->index_file = lttng_index_file_create_from_handle(
+				dir_handle,
+				stream->name, stream->uid, stream->gid,
+				stream->chan->tracefile_size,
+				stream->tracefile_count_current,
+				CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
+		if (!stream->index_file) {
+			ret = -1;
+			goto end;
+		}
+	}
+
+end:
+	pthread_mutex_unlock(&stream->chan->output_dir_lock);
+	return ret;
+}
+
 /*
  * Mmap the ring buffer, read it and write the data to the tracefile. This is a
  * core function for writing trace buffers to either the local filesystem or
@@ -1640,29 +1783,13 @@ ssize_t lttng_consumer_on_read_subbuffer_mmap(
 		if (stream->chan->tracefile_size > 0 &&
 				(stream->tracefile_size_current + len) >
 				stream->chan->tracefile_size) {
-			ret = utils_rotate_stream_file(stream->chan->pathname,
-					stream->name, stream->chan->tracefile_size,
-					stream->chan->tracefile_count, stream->uid, stream->gid,
-					stream->out_fd, &(stream->tracefile_count_current),
-					&stream->out_fd);
+			ret = rotate_stream_tracefile(stream);
 			if (ret < 0) {
 				ERR("Rotating output file");
 				goto end;
 			}
 			outfd = stream->out_fd;
 
-			if (stream->index_file) {
-				lttng_index_file_put(stream->index_file);
-				stream->index_file = lttng_index_file_create(stream->chan->pathname,
-						stream->name, stream->uid, stream->gid,
-						stream->chan->tracefile_size,
-						stream->tracefile_count_current,
-						CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
-				if (!stream->index_file) {
-					goto end;
-				}
-			}
-
 			/* Reset current size because we just perform a rotation. */
 			stream->tracefile_size_current = 0;
 			stream->out_fd_offset = 0;
@@ -1842,11 +1969,7 @@ ssize_t lttng_consumer_on_read_subbuffer_splice(
 		if (stream->chan->tracefile_size > 0 &&
 				(stream->tracefile_size_current + len) >
 				stream->chan->tracefile_size) {
-			ret = utils_rotate_stream_file(stream->chan->pathname,
-					stream->name, stream->chan->tracefile_size,
-					stream->chan->tracefile_count, stream->uid, stream->gid,
-					stream->out_fd, &(stream->tracefile_count_current),
-					&stream->out_fd);
+			ret = rotate_stream_tracefile(stream);
 			if (ret < 0) {
 				written = ret;
 				ERR("Rotating output file");
@@ -1854,18 +1977,6 @@ ssize_t lttng_consumer_on_read_subbuffer_splice(
 			}
 			outfd = stream->out_fd;
 
-			if (stream->index_file) {
-				lttng_index_file_put(stream->index_file);
-				stream->index_file = lttng_index_file_create(stream->chan->pathname,
-						stream->name, stream->uid, stream->gid,
-						stream->chan->tracefile_size,
-						stream->tracefile_count_current,
-						CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
-				if (!stream->index_file) {
-					goto end;
-				}
-			}
-
 			/* Reset current size because we just perform a rotation. */
 			stream->tracefile_size_current = 0;
 			stream->out_fd_offset = 0;
@@ -3355,17 +3466,81 @@ error_testpoint:
 	return NULL;
 }
 
+/*
+ * Sample the monitored channels of a session so that the session daemon can
+ * evaluate its consumed size conditions right away.
+ */
+static
+void sample_session_channels(uint64_t session_id)
+{
+	struct lttng_ht_iter iter;
+	struct lttng_consumer_channel *channel;
+
+	rcu_read_lock();
+	cds_lfht_for_each_entry(consumer_data.channel_ht->ht, &iter.iter,
+			channel, node.node) {
+		if (channel->session_id != session_id ||
+				!channel->monitor_timer_enabled) {
+			continue;
+		}
+		consumer_timer_monitor_sample(channel);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Account data written by a data stream to its session. The channels of the
+ * session are sampled when this write crosses the session's rotation
+ * threshold instead of waiting for their monitor timer, which keeps the size
+ * of the trace chunks close to the requested one.
+ *
+ * No stream lock may be held by the caller.
+ */
+static
+void account_session_output(uint64_t session_id, uint64_t written)
+{
+	struct lttng_ht_iter iter;
+	struct lttng_ht_node_u64 *node;
+	struct consumer_session_rotate_threshold *session;
+	uint64_t threshold, total;
+	bool crossed;
+
+	rcu_read_lock();
+	lttng_ht_lookup(consumer_data.session_rotate_threshold_ht, &session_id,
+			&iter);
+	node = lttng_ht_iter_get_node_u64(&iter);
+	if (!node) {
+		rcu_read_unlock();
+		return;
+	}
+	session = caa_container_of(node,
+			struct consumer_session_rotate_threshold, node);
+
+	threshold = uatomic_read(&session->threshold);
+	total = uatomic_add_return(&session->output_written, written);
+	crossed = total >= threshold && total - written < threshold;
+	rcu_read_unlock();
+
+	if (crossed) {
+		DBG("Session %" PRIu64 " reached its rotation threshold (%" PRIu64 " bytes), sampling its channels",
+				session_id, threshold);
+		sample_session_channels(session_id);
+	}
+}
+
 ssize_t lttng_consumer_read_subbuffer(struct lttng_consumer_stream *stream,
 		struct lttng_consumer_local_data *ctx)
 {
 	ssize_t ret;
 	int rotate_ret;
 	bool rotated = false;
+	uint64_t written;
 
 	pthread_mutex_lock(&stream->lock);
 	if (stream->metadata_flag) {
 		pthread_mutex_lock(&stream->metadata_rdv_lock);
 	}
+	written = stream->output_written;
 
 	switch (consumer_data.type) {
 	case LTTNG_CONSUMER_KERNEL:
@@ -3386,6 +3561,7 @@ ssize_t lttng_consumer_read_subbuffer(struct lttng_consumer_stream *stream,
 		pthread_cond_broadcast(&stream->metadata_rdv);
 		pthread_mutex_unlock(&stream->metadata_rdv_lock);
 	}
+	written = stream->output_written - written;
 	pthread_mutex_unlock(&stream->lock);
 	if (rotated) {
 		rotate_ret = consumer_post_rotation(stream, ctx);
@@ -3394,6 +3570,9 @@ ssize_t lttng_consumer_read_subbuffer(struct lttng_consumer_stream *stream,
 			ret = -1;
 		}
 	}
+	if (written && !stream->metadata_flag) {
+		account_session_output(stream->session_id, written);
+	}
 
 	return ret;
 }
@@ -3438,6 +3617,12 @@ int lttng_consumer_init(void)
 		goto error;
 	}
 
+	consumer_data.session_rotate_threshold_ht =
+			lttng_ht_new(0, LTTNG_HT_TYPE_U64);
+	if (!consumer_data.session_rotate_threshold_ht) {
+		goto error;
+	}
+
 	data_ht = lttng_ht_new(0, LTTNG_HT_TYPE_U64);
 	if (!data_ht) {
 		goto error;
@@ -3670,10 +3855,82 @@ found:
 	return relayd;
 }
 
+/*
+ * Relayd stream state needed to query the relayd about a stream's data.
+ */
+struct relayd_pending_stream {
+	uint64_t relayd_stream_id;
+	uint64_t last_net_seq_num;
+	bool metadata;
+};
+
+/*
+ * Ask the relayd whether it still has data in flight for the given streams.
+ *
+ * Only the relayd control socket lock is held during the exchange so that
+ * the network round trips don't block the other consumer threads.
+ *
+ * RCU read side lock MUST be acquired before calling this function.
+ *
+ * Return 1 if data is pending or else 0.
+ */
+static int relayd_data_pending_streams(struct consumer_relayd_sock_pair *relayd,
+		const struct relayd_pending_stream *streams, size_t count)
+{
+	int ret;
+	size_t i;
+	unsigned int is_data_inflight = 0;
+
+	/* Send init command for data pending. */
+	pthread_mutex_lock(&relayd->ctrl_sock_mutex);
+	ret = relayd_begin_data_pending(&relayd->control_sock,
+			relayd->relayd_session_id);
+	if (ret < 0) {
+		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+		/* Communication error thus the relayd so no data pending. */
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (streams[i].metadata) {
+			ret = relayd_quiescent_control(&relayd->control_sock,
+					streams[i].relayd_stream_id);
+		} else {
+			ret = relayd_data_pending(&relayd->control_sock,
+					streams[i].relayd_stream_id,
+					streams[i].last_net_seq_num);
+		}
+
+		if (ret == 1) {
+			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+			return 1;
+		} else if (ret < 0) {
+			ERR("Relayd data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
+			lttng_consumer_cleanup_relayd(relayd);
+			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+			return 0;
+		}
+	}
+
+	/* Send end command for data pending. */
+	ret = relayd_end_data_pending(&relayd->control_sock,
+			relayd->relayd_session_id, &is_data_inflight);
+	pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+	if (ret < 0) {
+		ERR("Relayd end data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
+		lttng_consumer_cleanup_relayd(relayd);
+		return 0;
+	}
+	return !!is_data_inflight;
+}
+
 /*
  * Check if for a given session id there is still data needed to be extract
  * from the buffers.
  *
+ * The consumer data lock is only held while the session's streams are
+ * walked. The relayd, if any, is queried once it has been released.
+ *
  * Return 1 if data is pending or else 0 meaning ready to be read.
  */
 int consumer_data_pending(uint64_t id)
@@ -3683,10 +3940,12 @@ int consumer_data_pending(uint64_t id)
 	struct lttng_ht *ht;
 	struct lttng_consumer_stream *stream;
 	struct consumer_relayd_sock_pair *relayd = NULL;
+	struct lttng_dynamic_buffer relayd_streams;
 	int (*data_pending)(struct lttng_consumer_stream *);
 
 	DBG("Consumer data pending command on session id %" PRIu64, id);
 
+	lttng_dynamic_buffer_init(&relayd_streams);
 	rcu_read_lock();
 	pthread_mutex_lock(&consumer_data.lock);
 
@@ -3705,6 +3964,7 @@ int consumer_data_pending(uint64_t id)
 
 	/* Ease our life a bit */
 	ht = consumer_data.stream_list_ht;
+	relayd = find_relayd_by_session_id(id);
 
 	cds_lfht_for_each_entry_duplicate(ht->ht,
 			ht->hash_fct(&id, lttng_ht_seed),
@@ -3728,59 +3988,35 @@ int consumer_data_pending(uint64_t id)
 			}
 		}
 
-		pthread_mutex_unlock(&stream->lock);
-	}
-
-	relayd = find_relayd_by_session_id(id);
-	if (relayd) {
-		unsigned int is_data_inflight = 0;
-
-		/* Send init command for data pending. */
-		pthread_mutex_lock(&relayd->ctrl_sock_mutex);
-		ret = relayd_begin_data_pending(&relayd->control_sock,
-				relayd->relayd_session_id);
-		if (ret < 0) {
-			pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
-			/* Communication error thus the relayd so no data pending. */
-			goto data_not_pending;
-		}
-
-		cds_lfht_for_each_entry_duplicate(ht->ht,
-				ht->hash_fct(&id, lttng_ht_seed),
-				ht->match_fct, &id,
-				&iter.iter, stream, node_session_id.node) {
-			if (stream->metadata_flag) {
-				ret = relayd_quiescent_control(&relayd->control_sock,
-						stream->relayd_stream_id);
-			} else {
-				ret = relayd_data_pending(&relayd->control_sock,
-						stream->relayd_stream_id,
-						stream->next_net_seq_num - 1);
-			}
-
-			if (ret == 1) {
-				pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+		if (relayd) {
+			struct relayd_pending_stream pending_stream = {
+				.relayd_stream_id = stream->relayd_stream_id,
+				.last_net_seq_num = stream->next_net_seq_num - 1,
+				.metadata = !!stream->metadata_flag,
+			};
+
+			ret = lttng_dynamic_buffer_append(&relayd_streams,
+					&pending_stream, sizeof(pending_stream));
+			if (ret) {
+				ERR("Failed to allocate relayd data pending stream");
+				pthread_mutex_unlock(&stream->lock);
 				goto data_pending;
-			} else if (ret < 0) {
-				ERR("Relayd data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
-				lttng_consumer_cleanup_relayd(relayd);
-				pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
-				goto data_not_pending;
 			}
 		}
 
-		/* Send end command for data pending. */
-		ret = relayd_end_data_pending(&relayd->control_sock,
-				relayd->relayd_session_id, &is_data_inflight);
-		pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
-		if (ret < 0) {
-			ERR("Relayd end data pending failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
-			lttng_consumer_cleanup_relayd(relayd);
-			goto data_not_pending;
-		}
-		if (is_data_inflight) {
-			goto data_pending;
-		}
+		pthread_mutex_unlock(&stream->lock);
+	}
+
+	pthread_mutex_unlock(&consumer_data.lock);
+
+	/*
+	 * The relayd is only queried once no data is left in the local
+	 * buffers. It remains valid as long as the RCU read side lock is held.
+	 */
+	if (relayd && relayd_data_pending_streams(relayd,
+			(const struct relayd_pending_stream *) relayd_streams.data,
+			relayd_streams.size / sizeof(struct relayd_pending_stream))) {
+		goto data_pending_unlocked;
 	}
 
 	/*
@@ -3789,16 +4025,17 @@ int consumer_data_pending(uint64_t id)
 	 * analysis from the trace files.
 	 */
 
-data_not_pending:
 	/* Data is available to be read by a viewer. */
-	pthread_mutex_unlock(&consumer_data.lock);
 	rcu_read_unlock();
+	lttng_dynamic_buffer_reset(&relayd_streams);
 	return 0;
 
 data_pending:
-	/* Data is still being extracted from buffers. */
 	pthread_mutex_unlock(&consumer_data.lock);
+data_pending_unlocked:
+	/* Data is still being extracted from buffers. */
 	rcu_read_unlock();
+	lttng_dynamic_buffer_reset(&relayd_streams);
 	return 1;
 }
 
@@ -3884,11 +4121,151 @@ end:
 	return ret;
 }
 
+/* Output files of a stream in the next trace chunk. */
+struct next_chunk_files {
+	struct lttng_consumer_stream *stream;
+	int out_fd;
+	struct lttng_index_file *index_file;
+};
+
+static
+void close_next_chunk_files(struct next_chunk_files *files)
+{
+	int ret;
+
+	if (files->out_fd >= 0) {
+		ret = close(files->out_fd);
+		if (ret) {
+			PERROR("close");
+		}
+		files->out_fd = -1;
+	}
+	if (files->index_file) {
+		lttng_index_file_put(files->index_file);
+		files->index_file = NULL;
+	}
+}
+
+/*
+ * Create the output files of the local streams of a channel in the directory
+ * of the next trace chunk, ahead of the moment the streams reach their rotate
+ * position. The files are appended to "files_buffer".
+ *
+ * The name of the files only depends on the name of the stream and on
+ * attributes of the channel which don't change, so the stream locks are not
+ * needed. The files are installed in their stream later, under its lock.
+ *
+ * Must be called with the channel lock and the RCU read-side lock held.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static
+int create_next_chunk_files(struct lttng_consumer_channel *channel,
+		struct lttng_dynamic_buffer *files_buffer)
+{
+	int ret;
+	struct lttng_consumer_stream *stream;
+	struct lttng_ht_iter iter;
+	struct lttng_ht *ht = consumer_data.stream_per_chan_id_ht;
+	struct lttng_directory_handle *dir_handle;
+
+	pthread_mutex_lock(&channel->output_dir_lock);
+	/* Opened as the session user, in the new chunk. */
+	dir_handle = consumer_channel_get_output_dir_handle(channel);
+	if (!dir_handle) {
+		ret = -1;
+		goto end;
+	}
+
+	cds_lfht_for_each_entry_duplicate(ht->ht,
+			ht->hash_fct(&channel->key, lttng_ht_seed),
+			ht->match_fct, &channel->key, &iter.iter,
+			stream, node_channel_id.node) {
+		struct next_chunk_files files = {
+			.stream = stream,
+			.out_fd = -1,
+			.index_file = NULL,
+		};
+
+		health_code_update();
+
+		ret = utils_create_stream_file_at(dir_handle, stream->name,
+				channel->tracefile_size, 0,
+				stream->uid, stream->gid, NULL);
+		if (ret < 0) {
+			ERR("Failed to create the next trace chunk file of stream %" PRIu64,
+					stream->key);
+			goto end;
+		}
+		files.out_fd = ret;
+
+		if (!stream->metadata_flag) {
+			files.index_file = lttng_index_file_create_from_handle(
+					dir_handle, stream->name,
+					stream->uid, stream->gid,
+					channel->tracefile_size, 0,
+					CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
+			if (!files.index_file) {
+				ERR("Failed to create the next trace chunk index file of stream %" PRIu64,
+						stream->key);
+				close_next_chunk_files(&files);
+				ret = -1;
+				goto end;
+			}
+		}
+
+		ret = lttng_dynamic_buffer_append(files_buffer, &files,
+				sizeof(files));
+		if (ret) {
+			close_next_chunk_files(&files);
+			goto end;
+		}
+	}
+	ret = 0;
+
+end:
+	pthread_mutex_unlock(&channel->output_dir_lock);
+	return ret;
+}
+
+/*
+ * Hand the next trace chunk files created for a stream, if any, over to it.
+ *
+ * Must be called with the stream lock held.
+ */
+static
+void install_next_chunk_files(struct lttng_consumer_stream *stream,
+		struct lttng_dynamic_buffer *files_buffer)
+{
+	size_t i;
+	struct next_chunk_files *files =
+			(struct next_chunk_files *) files_buffer->data;
+
+	for (i = 0; i < files_buffer->size / sizeof(*files); i++) {
+		if (files[i].stream != stream) {
+			continue;
+		}
+		consumer_stream_close_next_chunk_files(stream);
+		stream->rotate_next_out_fd = files[i].out_fd;
+		stream->rotate_next_index_file = files[i].index_file;
+		files[i].out_fd = -1;
+		files[i].index_file = NULL;
+		break;
+	}
+}
+
 /*
  * Sample the rotate position for all the streams of a channel. If a stream
  * is already at the rotate position (produced == consumed), we flag it as
  * ready for rotation. The rotation of ready streams occurs after we have
  * replied to the session daemon that we have finished sampling the positions.
+ *
+ * The files of the local streams are created in the new chunk right away. This
+ * keeps the file system operations out of the data path, which only has to
+ * swap the output files once a stream reaches its rotate position. Streams
+ * split in multiple trace files (tracefile_size) are not handled this way
+ * since their current file index can change before the rotation occurs.
+ *
  * Must be called with RCU read-side lock held to ensure existence of channel.
  *
  * Returns 0 on success, < 0 on error
@@ -3902,9 +4279,12 @@ int lttng_consumer_rotate_channel(struct lttng_consumer_channel *channel,
 	struct lttng_consumer_stream *stream;
 	struct lttng_ht_iter iter;
 	struct lttng_ht *ht = consumer_data.stream_per_chan_id_ht;
+	struct lttng_dynamic_buffer next_files;
+	size_t i;
 
 	DBG("Consumer sample rotate position for channel %" PRIu64, key);
 
+	lttng_dynamic_buffer_init(&next_files);
 	rcu_read_lock();
 
 	pthread_mutex_lock(&channel->lock);
@@ -3917,6 +4297,11 @@ int lttng_consumer_rotate_channel(struct lttng_consumer_channel *channel,
 		goto end_unlock_channel;
 	}
 
+	/* The handle on the previous output directory is stale. */
+	pthread_mutex_lock(&channel->output_dir_lock);
+	close_channel_output_dir_handle(channel);
+	pthread_mutex_unlock(&channel->output_dir_lock);
+
 	if (relayd_id == -1ULL) {
 		/*
 		 * The domain path (/ust or /kernel) has been created before, we
@@ -3931,6 +4316,16 @@ int lttng_consumer_rotate_channel(struct lttng_consumer_channel *channel,
 			ret = -1;
 			goto end_unlock_channel;
 		}
+
+		if (!channel->tracefile_size) {
+			ret = create_next_chunk_files(channel, &next_files);
+			if (ret < 0) {
+				ERR("Failed to create the trace files in %s during rotation",
+						channel->pathname);
+				ret = -1;
+				goto end_unlock_channel;
+			}
+		}
 	}
 
 	cds_lfht_for_each_entry_duplicate(ht->ht,
@@ -3953,6 +4348,7 @@ int lttng_consumer_rotate_channel(struct lttng_consumer_channel *channel,
 			ERR("Failed to sample channel path name during channel rotation");
 			goto end_unlock_stream;
 		}
+		install_next_chunk_files(stream, &next_files);
 		ret = lttng_consumer_sample_snapshot_positions(stream);
 		if (ret < 0) {
 			ERR("Failed to sample snapshot position during channel rotation");
@@ -3991,6 +4387,12 @@ end_unlock_stream:
 end_unlock_channel:
 	pthread_mutex_unlock(&channel->lock);
 end:
+	/* Files of the streams which were not installed. */
+	for (i = 0; i < next_files.size / sizeof(struct next_chunk_files); i++) {
+		close_next_chunk_files(
+				&((struct next_chunk_files *) next_files.data)[i]);
+	}
+	lttng_dynamic_buffer_reset(&next_files);
 	rcu_read_unlock();
 	return ret;
 }
@@ -4059,6 +4461,7 @@ int rotate_local_stream(struct lttng_consumer_local_data *ctx,
 		struct lttng_consumer_stream *stream)
 {
 	int ret;
+	struct lttng_directory_handle *dir_handle;
 
 	DBG("Rotate local stream: stream key %" PRIu64 ", channel key %" PRIu64 " at path %s",
 			stream->key,
@@ -4073,15 +4476,40 @@ int rotate_local_stream(struct lttng_consumer_local_data *ctx,
 		goto error;
 	}
 
-	ret = utils_create_stream_file(
-			stream->channel_read_only_attributes.path,
+	if (stream->rotate_next_out_fd >= 0) {
+		/* The files of the new chunk were created at sampling time. */
+		stream->out_fd = stream->rotate_next_out_fd;
+		stream->rotate_next_out_fd = -1;
+		stream->tracefile_size_current = 0;
+		if (!stream->metadata_flag) {
+			lttng_index_file_put(stream->index_file);
+			stream->index_file = stream->rotate_next_index_file;
+			stream->rotate_next_index_file = NULL;
+			stream->out_fd_offset = 0;
+		}
+		ret = 0;
+		goto end;
+	}
+
+	/*
+	 * The path sampled by the stream at the start of the rotation is the
+	 * channel's current output directory.
+	 */
+	pthread_mutex_lock(&stream->chan->output_dir_lock);
+	dir_handle = consumer_channel_get_output_dir_handle(stream->chan);
+	if (!dir_handle) {
+		ERR("Rotate open stream output directory");
+		goto error_unlock;
+	}
+
+	ret = utils_create_stream_file_at(dir_handle,
 			stream->name,
 			stream->channel_read_only_attributes.tracefile_size,
 			stream->tracefile_count_current,
 			stream->uid, stream->gid, NULL);
 	if (ret < 0) {
 		ERR("Rotate create stream file");
-		goto error;
+		goto error_unlock;
 	}
 	stream->out_fd = ret;
 	stream->tracefile_size_current = 0;
@@ -4091,23 +4519,25 @@ int rotate_local_stream(struct lttng_consumer_local_data *ctx,
 
 		lttng_index_file_put(stream->index_file);
 
-		index_file = lttng_index_file_create(
-				stream->channel_read_only_attributes.path,
+		index_file = lttng_index_file_create_from_handle(dir_handle,
 				stream->name, stream->uid, stream->gid,
 				stream->channel_read_only_attributes.tracefile_size,
 				stream->tracefile_count_current,
 				CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
 		if (!index_file) {
 			ERR("Create index file during rotation");
-			goto error;
+			goto error_unlock;
 		}
 		stream->index_file = index_file;
 		stream->out_fd_offset = 0;
 	}
 
+	pthread_mutex_unlock(&stream->chan->output_dir_lock);
 	ret = 0;
 	goto end;
 
+error_unlock:
+	pthread_mutex_unlock(&stream->chan->output_dir_lock);
 error:
 	ret = -1;
 end:
@@ -4213,12 +4643,76 @@ error:
 	return ret;
 }
 
+/*
+ * Send the rotation positions collected for the data streams of a channel
+ * to their relayd in a single command. Relay daemons older than 2.12 get one
+ * command per stream.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+static
+int rotate_relay_streams(uint64_t relayd_id, const char *new_pathname,
+		uint64_t new_chunk_id,
+		const struct lttng_dynamic_buffer *positions)
+{
+	int ret = 0;
+	uint32_t i;
+	struct consumer_relayd_sock_pair *relayd;
+	const struct lttcomm_relayd_stream_rotation_position *position =
+			(const struct lttcomm_relayd_stream_rotation_position *)
+					positions->data;
+	const uint32_t count = positions->size / sizeof(*position);
+
+	if (!count) {
+		goto end;
+	}
+
+	DBG("Rotate %" PRIu32 " relay streams", count);
+	relayd = consumer_find_relayd(relayd_id);
+	if (!relayd) {
+		ERR("Failed to find relayd");
+		ret = -1;
+		goto end;
+	}
+
+	pthread_mutex_lock(&relayd->ctrl_sock_mutex);
+	if (relayd->control_sock.minor >= 12) {
+		ret = relayd_rotate_streams(&relayd->control_sock, new_pathname,
+				new_chunk_id, position, count);
+	} else {
+		for (i = 0; i < count && !ret; i++) {
+			ret = relayd_rotate_stream(&relayd->control_sock,
+					be64toh(position[i].stream_id),
+					new_pathname, new_chunk_id,
+					be64toh(position[i].rotate_at_seq_num));
+		}
+	}
+	pthread_mutex_unlock(&relayd->ctrl_sock_mutex);
+	if (ret < 0) {
+		ERR("Relayd rotate streams failed. Cleaning up relayd %" PRIu64".", relayd->net_seq_idx);
+		lttng_consumer_cleanup_relayd(relayd);
+	}
+
+end:
+	return ret;
+}
+
 /*
  * Rotate all the ready streams now.
  *
  * This is especially important for low throughput streams that have already
  * been consumed, we cannot wait for their next packet to perform the
  * rotation.
+ *
+ * The ready data streams sent to a relayd are rotated with a single command
+ * once all of them have been visited rather than with a round trip each.
+ * Their lock is held until the command has been sent: the relayd expects the
+ * rotation position of a stream before receiving its next index. Their
+ * rotation state is only updated once the command has succeeded.
+ *
+ * The metadata streams and the local streams are still rotated one after the
+ * other by this thread. Rotating them in parallel was left out.
+ *
  * Need to be called with RCU read-side lock held to ensure existence of
  * channel.
  *
@@ -4231,6 +4725,13 @@ int lttng_consumer_rotate_ready_streams(struct lttng_consumer_channel *channel,
 	struct lttng_consumer_stream *stream;
 	struct lttng_ht_iter iter;
 	struct lttng_ht *ht = consumer_data.stream_per_chan_id_ht;
+	struct lttng_dynamic_buffer relay_positions, relay_streams;
+	char relay_pathname[LTTNG_PATH_MAX];
+	uint64_t relay_chunk_id = 0, relayd_id = -1ULL;
+	size_t i;
+
+	lttng_dynamic_buffer_init(&relay_positions);
+	lttng_dynamic_buffer_init(&relay_streams);
 
 	rcu_read_lock();
 
@@ -4250,6 +4751,43 @@ int lttng_consumer_rotate_ready_streams(struct lttng_consumer_channel *channel,
 		}
 		DBG("Consumer rotate ready stream %" PRIu64, stream->key);
 
+		if (stream->net_seq_idx != (uint64_t) -1ULL &&
+				!stream->metadata_flag) {
+			struct lttcomm_relayd_stream_rotation_position position;
+
+			if (relay_positions.size == 0) {
+				relayd_id = stream->net_seq_idx;
+				relay_chunk_id = stream->chan->current_chunk_id;
+				ret = lttng_strncpy(relay_pathname,
+						stream->channel_read_only_attributes.path,
+						sizeof(relay_pathname));
+				if (ret) {
+					pthread_mutex_unlock(&stream->lock);
+					goto end;
+				}
+			}
+			/* All the streams of a channel share the same relayd. */
+			assert(stream->net_seq_idx == relayd_id);
+
+			position.stream_id = htobe64(stream->relayd_stream_id);
+			position.rotate_at_seq_num =
+					htobe64(stream->last_sequence_number);
+			ret = lttng_dynamic_buffer_append(&relay_positions,
+					&position, sizeof(position));
+			if (ret) {
+				pthread_mutex_unlock(&stream->lock);
+				goto end;
+			}
+			ret = lttng_dynamic_buffer_append(&relay_streams,
+					&stream, sizeof(stream));
+			if (ret) {
+				pthread_mutex_unlock(&stream->lock);
+				goto end;
+			}
+			/* Unlocked once the rotation command is sent. */
+			continue;
+		}
+
 		ret = lttng_consumer_rotate_stream(ctx, stream, NULL);
 		pthread_mutex_unlock(&stream->lock);
 		if (ret) {
@@ -4262,10 +4800,21 @@ int lttng_consumer_rotate_ready_streams(struct lttng_consumer_channel *channel,
 		}
 	}
 
-	ret = 0;
+	ret = rotate_relay_streams(relayd_id, relay_pathname, relay_chunk_id,
+			&relay_positions);
 
 end:
+	for (i = 0; i < relay_streams.size / sizeof(stream); i++) {
+		stream = ((struct lttng_consumer_stream **) relay_streams.data)[i];
+		if (!ret) {
+			stream->trace_archive_id++;
+			lttng_consumer_reset_stream_rotate_state(stream);
+		}
+		pthread_mutex_unlock(&stream->lock);
+	}
 	rcu_read_unlock();
+	lttng_dynamic_buffer_reset(&relay_positions);
+	lttng_dynamic_buffer_reset(&relay_streams);
 	return ret;
 }
 
@@ -4463,3 +5012,79 @@ int lttng_consumer_mkdir(const char *path, uid_t uid, gid_t gid,
 		return mkdir_local(path, uid, gid);
 	}
 }
+
+/*
+ * Set the consumed size at which the session daemon rotates a session. A
+ * threshold of 0 disables the accounting of the session.
+ *
+ * The data already written by the streams of the session is accounted when
+ * the threshold is first set, like the session daemon does when it sums the
+ * channel samples.
+ *
+ * Returns 0 on success, < 0 on error
+ */
+int lttng_consumer_set_session_rotate_threshold(uint64_t session_id,
+		uint64_t threshold)
+{
+	int ret;
+	struct lttng_ht_iter iter;
+	struct lttng_ht_node_u64 *node;
+	struct lttng_consumer_stream *stream;
+	struct consumer_session_rotate_threshold *session;
+	struct lttng_ht *ht = consumer_data.session_rotate_threshold_ht;
+
+	DBG("Consumer set rotation threshold of session %" PRIu64 " to %" PRIu64,
+			session_id, threshold);
+
+	rcu_read_lock();
+	lttng_ht_lookup(ht, &session_id, &iter);
+	node = lttng_ht_iter_get_node_u64(&iter);
+	if (node) {
+		session = caa_container_of(node,
+				struct consumer_session_rotate_threshold, node);
+		if (threshold) {
+			uatomic_set(&session->threshold, threshold);
+		} else {
+			ret = lttng_ht_del(ht, &iter);
+			assert(!ret);
+			call_rcu(&session->node.head,
+					free_session_rotate_threshold_rcu);
+		}
+		ret = 0;
+		goto end;
+	}
+
+	if (!threshold) {
+		ret = 0;
+		goto end;
+	}
+
+	session = zmalloc(sizeof(*session));
+	if (!session) {
+		PERROR("zmalloc consumer_session_rotate_threshold");
+		ret = -1;
+		goto end;
+	}
+	lttng_ht_node_init_u64(&session->node, session_id);
+	session->threshold = threshold;
+
+	cds_lfht_for_each_entry_duplicate(consumer_data.stream_list_ht->ht,
+			consumer_data.stream_list_ht->hash_fct(&session_id,
+				lttng_ht_seed),
+			consumer_data.stream_list_ht->match_fct, &session_id,
+			&iter.iter, stream, node_session_id.node) {
+		if (stream->metadata_flag) {
+			continue;
+		}
+		pthread_mutex_lock(&stream->lock);
+		session->output_written += stream->output_written;
+		pthread_mutex_unlock(&stream->lock);
+	}
+
+	lttng_ht_add_unique_u64(ht, &session->node);
+	ret = 0;
+
+end:
+	rcu_read_unlock();
+	return ret;
+}
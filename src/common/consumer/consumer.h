@@ -29,6 +29,7 @@
 #include <lttng/lttng.h>
 
 #include <common/hashtable/hashtable.h>
+#include <common/compat/directory-handle.h>
 #include <common/compat/fcntl.h>
 #include <common/compat/uuid.h>
 #include <common/sessiond-comm/sessiond-comm.h>
@@ -68,6 +69,7 @@ enum lttng_consumer_command {
 	LTTNG_CONSUMER_CHECK_ROTATION_PENDING_LOCAL,
 	LTTNG_CONSUMER_CHECK_ROTATION_PENDING_RELAY,
 	LTTNG_CONSUMER_MKDIR,
+	LTTNG_CONSUMER_SET_SESSION_ROTATE_THRESHOLD,
 };
 
 /* State of each fd in consumer */
@@ -239,6 +241,18 @@ struct lttng_consumer_channel {
 	 * allows to keep track of where each stream on the relay is writing.
 	 */
 	uint64_t current_chunk_id;
+
+	/*
+	 * Handle on the local output directory of the channel (pathname),
+	 * opened as the channel's user on first use and closed when a
+	 * rotation changes the path. NULL until then.
+	 *
+	 * The output directory lock protects it. It is nested INSIDE the
+	 * channel and stream locks and no other lock is taken while it is
+	 * held.
+	 */
+	struct lttng_directory_handle *output_dir_handle;
+	pthread_mutex_t output_dir_lock;
 };
 
 /*
@@ -439,6 +453,14 @@ struct lttng_consumer_stream {
 	 * channel_read_only_attributes.path.
 	 */
 	unsigned long rotate_position;
+	/*
+	 * Output files of the stream in the next trace chunk. They are created
+	 * when the rotate position is sampled so that reaching that position
+	 * only has to swap them in place of out_fd and index_file. Only used
+	 * for local streams; -1 and NULL otherwise.
+	 */
+	int rotate_next_out_fd;
+	struct lttng_index_file *rotate_next_index_file;
 
 	/*
 	 * Read-only copies of channel values. We cannot safely access the
@@ -599,6 +621,22 @@ struct lttng_consumer_local_data {
 	int channel_monitor_pipe;
 };
 
+/*
+ * Size-based rotation threshold of a session, set by the session daemon.
+ *
+ * The data written by the streams of the session is accounted here so that
+ * the channels of the session can be sampled as soon as the threshold is
+ * crossed rather than on their next monitor timer expiration.
+ */
+struct consumer_session_rotate_threshold {
+	/* Indexed by session id. */
+	struct lttng_ht_node_u64 node;
+	/* Session consumed size at which a rotation is triggered. */
+	uint64_t threshold;
+	/* Bytes written by the data streams of the session. Atomic. */
+	uint64_t output_written;
+};
+
 /*
  * Library-level data. One instance per process.
  */
@@ -647,6 +685,12 @@ struct lttng_consumer_global_data {
 	 * This HT uses the "node_channel_id" of the consumer stream.
 	 */
 	struct lttng_ht *stream_per_chan_id_ht;
+
+	/*
+	 * Size-based rotation thresholds of the sessions, indexed by session
+	 * id. See struct consumer_session_rotate_threshold.
+	 */
+	struct lttng_ht *session_rotate_threshold_ht;
 };
 
 /*
@@ -766,6 +810,8 @@ void consumer_del_metadata_stream(struct lttng_consumer_stream *stream,
 int consumer_add_channel(struct lttng_consumer_channel *channel,
 		struct lttng_consumer_local_data *ctx);
 void consumer_del_channel(struct lttng_consumer_channel *channel);
+struct lttng_directory_handle *consumer_channel_get_output_dir_handle(
+		struct lttng_consumer_channel *channel);
 
 /* lttng-relayd consumer command */
 struct consumer_relayd_sock_pair *consumer_find_relayd(uint64_t key);
@@ -852,6 +898,8 @@ int lttng_consumer_check_rotation_pending_relay(uint64_t session_id,
 void lttng_consumer_reset_stream_rotate_state(struct lttng_consumer_stream *stream);
 int lttng_consumer_mkdir(const char *path, uid_t uid, gid_t gid,
 		uint64_t relayd_id);
+int lttng_consumer_set_session_rotate_threshold(uint64_t session_id,
+		uint64_t threshold);
 void lttng_consumer_cleanup_relayd(struct consumer_relayd_sock_pair *relayd);
 
 #endif /* LIB_CONSUMER_H */
@@ -282,9 +282,12 @@
 
 /*
  * Wait period before retrying the lttng_data_pending command in the lttng
- * stop command of liblttng-ctl.
+ * stop command of liblttng-ctl. The first retries use shorter periods,
+ * starting at DEFAULT_DATA_AVAILABILITY_MIN_WAIT_TIME and doubling up to
+ * DEFAULT_DATA_AVAILABILITY_WAIT_TIME.
  */
 #define DEFAULT_DATA_AVAILABILITY_WAIT_TIME 200000  /* usec */
+#define DEFAULT_DATA_AVAILABILITY_MIN_WAIT_TIME 1000  /* usec */
 
 /*
  * Wait period before retrying the lttng_consumer_flushed_cache when
@@ -309,6 +312,9 @@
 #define DEFAULT_APP_SOCKET_RW_TIMEOUT       CONFIG_DEFAULT_APP_SOCKET_RW_TIMEOUT
 #define DEFAULT_APP_SOCKET_TIMEOUT_ENV      "LTTNG_APP_SOCKET_TIMEOUT"
 
+/* Number of session daemon threads processing client commands. */
+#define DEFAULT_CLIENT_WORKER_THREADS       4
+
 #define DEFAULT_UST_STREAM_FD_NUM			2 /* Number of fd per UST stream. */
 
 #define DEFAULT_SNAPSHOT_NAME				"snapshot"
@@ -318,12 +324,24 @@
 #define DEFAULT_INDEX_FILE_SUFFIX			".idx"
 #define DEFAULT_INDEX_DIR					"index"
 
+/*
+ * Number of recently received indexes kept in memory, per stream, by the
+ * relay daemon to serve live viewers.
+ */
+#define DEFAULT_LIVE_INDEX_CACHE_SIZE			32
+
 /* Default lttng command live timer value in usec. */
 #define DEFAULT_LTTNG_LIVE_TIMER			CONFIG_DEFAULT_LTTNG_LIVE_TIMER
 
 /* Default runas worker name */
 #define DEFAULT_RUN_AS_WORKER_NAME			"lttng-runas"
 
+/*
+ * Number of run_as workers forked by a daemon. Commands issued concurrently
+ * by different threads are dispatched to idle workers.
+ */
+#define DEFAULT_RUN_AS_WORKER_POOL_SIZE			4
+
 /* Default LTTng MI XML namespace. */
 #define DEFAULT_LTTNG_MI_NAMESPACE		"https://lttng.org/xml/ns/lttng-mi"
 
@@ -20,6 +20,14 @@
 
 #include <common/sessiond-comm/sessiond-comm.h>
 
+/*
+ * Version of the filter bytecode generator. Bump it whenever the bytecode
+ * generated for a given filter expression changes, e.g. on changes to
+ * filter_visitor_bytecode_generate() or to the IR passes, so that bytecode
+ * saved by a previous generator is compiled again rather than reused.
+ */
+#define LTTNG_FILTER_BYTECODE_GENERATOR_VERSION	1
+
 struct bytecode_symbol_iterator;
 
 /*
@@ -31,19 +31,17 @@
 #include "index.h"
 
 /*
- * Create the index file associated with a trace file.
+ * Write the header of a new index file and wrap its file descriptor. The
+ * file descriptor is closed on error.
  *
  * Return allocated struct lttng_index_file, NULL on error.
  */
-struct lttng_index_file *lttng_index_file_create(const char *path_name,
-		char *stream_name, int uid, int gid,
-		uint64_t size, uint64_t count, uint32_t major, uint32_t minor)
+static struct lttng_index_file *index_file_create_from_fd(int fd,
+		uint32_t major, uint32_t minor)
 {
 	struct lttng_index_file *index_file;
-	int ret, fd = -1;
 	ssize_t size_ret;
 	struct ctf_packet_index_file_hdr hdr;
-	char fullpath[PATH_MAX];
 	uint32_t element_len = ctf_packet_index_len(major, minor);
 
 	index_file = zmalloc(sizeof(*index_file));
@@ -52,6 +50,44 @@ struct lttng_index_file *lttng_index_file_create(const char *path_name,
 		goto error;
 	}
 
+	hdr.magic = htobe32(CTF_INDEX_MAGIC);
+	hdr.index_major = htobe32(major);
+	hdr.index_minor = htobe32(minor);
+	hdr.packet_index_len = htobe32(element_len);
+
+	size_ret = lttng_write(fd, &hdr, sizeof(hdr));
+	if (size_ret < sizeof(hdr)) {
+		PERROR("write index header");
+		goto error;
+	}
+	index_file->fd = fd;
+	index_file->major = major;
+	index_file->minor = minor;
+	index_file->element_len = element_len;
+	urcu_ref_init(&index_file->ref);
+
+	return index_file;
+
+error:
+	if (close(fd) < 0) {
+		PERROR("close index fd");
+	}
+	free(index_file);
+	return NULL;
+}
+
+/*
+ * Create the index file associated with a trace file.
+ *
+ * Return allocated struct lttng_index_file, NULL on error.
+ */
+struct lttng_index_file *lttng_index_file_create(const char *path_name,
+		char *stream_name, int uid, int gid,
+		uint64_t size, uint64_t count, uint32_t major, uint32_t minor)
+{
+	int ret;
+	char fullpath[PATH_MAX];
+
 	ret = snprintf(fullpath, sizeof(fullpath), "%s/" DEFAULT_INDEX_DIR,
 			path_name);
 	if (ret < 0) {
@@ -86,36 +122,63 @@ struct lttng_index_file *lttng_index_file_create(const char *path_name,
 	if (ret < 0) {
 		goto error;
 	}
-	fd = ret;
+	return index_file_create_from_fd(ret, major, minor);
 
-	hdr.magic = htobe32(CTF_INDEX_MAGIC);
-	hdr.index_major = htobe32(major);
-	hdr.index_minor = htobe32(minor);
-	hdr.packet_index_len = htobe32(element_len);
+error:
+	return NULL;
+}
 
-	size_ret = lttng_write(fd, &hdr, sizeof(hdr));
-	if (size_ret < sizeof(hdr)) {
-		PERROR("write index header");
+/*
+ * Create the index file associated with a trace file found in the
+ * directory of a handle.
+ *
+ * Return allocated struct lttng_index_file, NULL on error.
+ */
+struct lttng_index_file *lttng_index_file_create_from_handle(
+		const struct lttng_directory_handle *dir_handle,
+		const char *stream_name, int uid, int gid,
+		uint64_t size, uint64_t count, uint32_t major, uint32_t minor)
+{
+	int ret;
+	char index_file_name[PATH_MAX];
+	const struct lttng_credentials creds = {
+		.uid = (uid_t) uid,
+		.gid = (gid_t) gid,
+	};
+
+	ret = snprintf(index_file_name, sizeof(index_file_name),
+			DEFAULT_INDEX_DIR "/%s", stream_name);
+	if (ret < 0 || ret >= sizeof(index_file_name)) {
+		ERR("Failed to format index file name of stream %s",
+				stream_name);
 		goto error;
 	}
-	index_file->fd = fd;
-	index_file->major = major;
-	index_file->minor = minor;
-	index_file->element_len = element_len;
-	urcu_ref_init(&index_file->ref);
-
-	return index_file;
-
-error:
-	if (fd >= 0) {
-		int close_ret;
 
-		close_ret = close(fd);
-		if (close_ret < 0) {
-			PERROR("close index fd");
+	/* Create index directory if necessary. */
+	ret = lttng_directory_handle_create_subdirectory_as_user(dir_handle,
+			DEFAULT_INDEX_DIR, S_IRWXU | S_IRWXG,
+			(uid < 0 || gid < 0) ? NULL : &creds);
+	if (ret < 0) {
+		if (errno != EEXIST) {
+			PERROR("Index trace directory creation error");
+			goto error;
 		}
 	}
-	free(index_file);
+
+	/* Same unlink as lttng_index_file_create(). */
+	ret = utils_unlink_stream_file_at(dir_handle, index_file_name, size,
+			count, uid, gid, DEFAULT_INDEX_FILE_SUFFIX);
+	if (ret < 0 && errno != ENOENT) {
+		goto error;
+	}
+	ret = utils_create_stream_file_at(dir_handle, index_file_name, size,
+			count, uid, gid, DEFAULT_INDEX_FILE_SUFFIX);
+	if (ret < 0) {
+		goto error;
+	}
+	return index_file_create_from_fd(ret, major, minor);
+
+error:
 	return NULL;
 }
 
@@ -134,14 +197,15 @@ int lttng_index_file_write(const struct lttng_index_file *index_file,
 	assert(index_file);
 	assert(element);
 
-	fd = index_file->fd;
 	len = index_file->element_len;
 
+	fd = lttng_index_file_get_fd(index_file);
 	if (fd < 0) {
 		goto error;
 	}
 
 	ret = lttng_write(fd, element, len);
+	lttng_index_file_put_fd(index_file);
 	if (ret < len) {
 		PERROR("writing index file");
 		goto error;
@@ -161,16 +225,18 @@ int lttng_index_file_read(const struct lttng_index_file *index_file,
 		struct ctf_packet_index *element)
 {
 	ssize_t ret;
-	int fd = index_file->fd;
+	int fd;
 	size_t len = index_file->element_len;
 
 	assert(element);
 
+	fd = lttng_index_file_get_fd(index_file);
 	if (fd < 0) {
 		goto error;
 	}
 
 	ret = lttng_read(fd, element, len);
+	lttng_index_file_put_fd(index_file);
 	if (ret < 0) {
 		PERROR("read index file");
 		goto error;
@@ -185,6 +251,107 @@ error:
 	return -1;
 }
 
+/*
+ * Read the index entry at position "pos" (in number of entries, starting at
+ * 0) of the given index file. The file offset is left untouched.
+ *
+ * Return 0 on success, -1 on error.
+ */
+int lttng_index_file_read_at(const struct lttng_index_file *index_file,
+		uint64_t pos, struct ctf_packet_index *element)
+{
+	ssize_t ret;
+	int fd;
+	size_t len = index_file->element_len;
+	off_t offset = sizeof(struct ctf_packet_index_file_hdr) + pos * len;
+
+	assert(element);
+
+	fd = lttng_index_file_get_fd(index_file);
+	if (fd < 0) {
+		goto error;
+	}
+
+	ret = lttng_pread(fd, element, len, offset);
+	lttng_index_file_put_fd(index_file);
+	if (ret < 0) {
+		PERROR("read index file at position %" PRIu64, pos);
+		goto error;
+	}
+	if (ret < len) {
+		ERR("lttng_pread expected %zu, returned %zd", len, ret);
+		goto error;
+	}
+	return 0;
+
+error:
+	return -1;
+}
+
+/*
+ * Position the file offset of the given index file so that the next
+ * lttng_index_file_read returns the entry at position "pos".
+ *
+ * Return 0 on success, -1 on error.
+ */
+int lttng_index_file_seek(const struct lttng_index_file *index_file,
+		uint64_t pos)
+{
+	int fd;
+	off_t ret;
+	off_t offset = sizeof(struct ctf_packet_index_file_hdr) +
+			pos * index_file->element_len;
+
+	fd = lttng_index_file_get_fd(index_file);
+	if (fd < 0) {
+		return -1;
+	}
+	ret = lseek(fd, offset, SEEK_SET);
+	lttng_index_file_put_fd(index_file);
+	if (ret < 0) {
+		PERROR("lseek index file to position %" PRIu64, pos);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Find the position of the first of the "nr_indexes" entries of the given
+ * index file whose end timestamp is at or after "timestamp". The end
+ * timestamps of the entries of an index file are monotonic. "pos" is set to
+ * "nr_indexes" when every entry ends before "timestamp".
+ *
+ * Return 0 on success, -1 on error.
+ */
+int lttng_index_file_find_timestamp(const struct lttng_index_file *index_file,
+		uint64_t nr_indexes, uint64_t timestamp, uint64_t *pos)
+{
+	int ret;
+	uint64_t low = 0, high = nr_indexes;
+
+	assert(pos);
+
+	while (low < high) {
+		uint64_t mid = low + (high - low) / 2;
+		struct ctf_packet_index index;
+
+		memset(&index, 0, sizeof(index));
+		ret = lttng_index_file_read_at(index_file, mid, &index);
+		if (ret) {
+			goto end;
+		}
+		if (be64toh(index.timestamp_end) < timestamp) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	*pos = low;
+	ret = 0;
+end:
+	return ret;
+}
+
 /*
  * Open index file using a given path, channel name and tracefile count.
  *
@@ -276,6 +443,31 @@ error:
 	return NULL;
 }
 
+void lttng_index_file_set_fd_ops(struct lttng_index_file *index_file,
+		const struct lttng_index_file_fd_ops *fd_ops, void *data)
+{
+	assert(!index_file->fd_ops);
+
+	index_file->fd_ops = fd_ops;
+	index_file->fd_ops_data = data;
+	index_file->fd = -1;
+}
+
+int lttng_index_file_get_fd(const struct lttng_index_file *index_file)
+{
+	if (index_file->fd_ops) {
+		return index_file->fd_ops->get_fd(index_file->fd_ops_data);
+	}
+	return index_file->fd;
+}
+
+void lttng_index_file_put_fd(const struct lttng_index_file *index_file)
+{
+	if (index_file->fd_ops) {
+		index_file->fd_ops->put_fd(index_file->fd_ops_data);
+	}
+}
+
 void lttng_index_file_get(struct lttng_index_file *index_file)
 {
 	urcu_ref_get(&index_file->ref);
@@ -286,7 +478,9 @@ static void lttng_index_file_release(struct urcu_ref *ref)
 	struct lttng_index_file *index_file = caa_container_of(ref,
 			struct lttng_index_file, ref);
 
-	if (close(index_file->fd)) {
+	if (index_file->fd_ops) {
+		index_file->fd_ops->release(index_file->fd_ops_data);
+	} else if (close(index_file->fd)) {
 		PERROR("close index fd");
 	}
 	free(index_file);
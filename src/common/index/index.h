@@ -22,15 +22,31 @@
 
 #include <inttypes.h>
 #include <urcu/ref.h>
+#include <common/compat/directory-handle.h>
 
 #include "ctf-index.h"
 
+/*
+ * Lets the owner of an index file manage its file descriptor, e.g. to keep it
+ * in a file descriptor cache. The file descriptor is only used between
+ * get_fd() and put_fd(); release() replaces closing it.
+ */
+struct lttng_index_file_fd_ops {
+	/* Return the file descriptor or -1 on error. */
+	int (*get_fd)(void *data);
+	void (*put_fd)(void *data);
+	void (*release)(void *data);
+};
+
 struct lttng_index_file {
+	/* -1 when fd_ops is set. */
 	int fd;
 	uint32_t major;
 	uint32_t minor;
 	uint32_t element_len;
 	struct urcu_ref ref;
+	const struct lttng_index_file_fd_ops *fd_ops;
+	void *fd_ops_data;
 };
 
 /*
@@ -40,6 +56,10 @@ struct lttng_index_file {
 struct lttng_index_file *lttng_index_file_create(const char *path_name,
 		char *stream_name, int uid, int gid, uint64_t size,
 		uint64_t count, uint32_t major, uint32_t minor);
+struct lttng_index_file *lttng_index_file_create_from_handle(
+		const struct lttng_directory_handle *dir_handle,
+		const char *stream_name, int uid, int gid, uint64_t size,
+		uint64_t count, uint32_t major, uint32_t minor);
 struct lttng_index_file *lttng_index_file_open(const char *path_name,
 		const char *channel_name, uint64_t tracefile_count,
 		uint64_t tracefile_count_current);
@@ -47,6 +67,26 @@ int lttng_index_file_write(const struct lttng_index_file *index_file,
 		const struct ctf_packet_index *element);
 int lttng_index_file_read(const struct lttng_index_file *index_file,
 		struct ctf_packet_index *element);
+int lttng_index_file_read_at(const struct lttng_index_file *index_file,
+		uint64_t pos, struct ctf_packet_index *element);
+int lttng_index_file_seek(const struct lttng_index_file *index_file,
+		uint64_t pos);
+int lttng_index_file_find_timestamp(const struct lttng_index_file *index_file,
+		uint64_t nr_indexes, uint64_t timestamp, uint64_t *pos);
+
+/*
+ * Hand the file descriptor of an index file over to fd_ops. The index file
+ * must not be in use.
+ */
+void lttng_index_file_set_fd_ops(struct lttng_index_file *index_file,
+		const struct lttng_index_file_fd_ops *fd_ops, void *data);
+/*
+ * Bracket the direct uses of an index file's descriptor. Return the file
+ * descriptor or -1 on error, in which case lttng_index_file_put_fd() must not
+ * be called.
+ */
+int lttng_index_file_get_fd(const struct lttng_index_file *index_file);
+void lttng_index_file_put_fd(const struct lttng_index_file *index_file);
 
 void lttng_index_file_get(struct lttng_index_file *index_file);
 void lttng_index_file_put(struct lttng_index_file *index_file);
@@ -137,6 +137,8 @@ static int lttng_kconsumer_snapshot_channel(
 {
 	int ret;
 	struct lttng_consumer_stream *stream;
+	struct lttng_directory_handle dir_handle;
+	bool dir_handle_initialized = false;
 
 	DBG("Kernel consumer snapshot channel %" PRIu64, key);
 
@@ -150,6 +152,22 @@ static int lttng_kconsumer_snapshot_channel(
 		goto end;
 	}
 
+	if (relayd_id == (uint64_t) -1ULL) {
+		const struct lttng_credentials creds = {
+			.uid = channel->uid,
+			.gid = channel->gid,
+		};
+
+		/* The files of all the streams are created in this directory. */
+		ret = lttng_directory_handle_init_as_user(&dir_handle, path,
+				&creds);
+		if (ret) {
+			ERR("Failed to open snapshot output directory %s", path);
+			goto end;
+		}
+		dir_handle_initialized = true;
+	}
+
 	cds_list_for_each_entry(stream, &channel->streams.head, send_node) {
 		unsigned long consumed_pos, produced_pos;
 
@@ -173,12 +191,13 @@ static int lttng_kconsumer_snapshot_channel(
 				goto end_unlock;
 			}
 		} else {
-			ret = utils_create_stream_file(path, stream->name,
+			ret = utils_create_stream_file_at(&dir_handle,
+					stream->name,
 					stream->chan->tracefile_size,
 					stream->tracefile_count_current,
 					stream->uid, stream->gid, NULL);
 			if (ret < 0) {
-				ERR("utils_create_stream_file");
+				ERR("utils_create_stream_file_at");
 				goto end_unlock;
 			}
 
@@ -324,6 +343,9 @@ error_put_subbuf:
 end_unlock:
 	pthread_mutex_unlock(&stream->lock);
 end:
+	if (dir_handle_initialized) {
+		lttng_directory_handle_fini(&dir_handle);
+	}
 	rcu_read_unlock();
 	return ret;
 }
@@ -1260,6 +1282,26 @@ int lttng_kconsumer_recv_cmd(struct lttng_consumer_local_data *ctx,
 		}
 		break;
 	}
+	case LTTNG_CONSUMER_SET_SESSION_ROTATE_THRESHOLD:
+	{
+		ret = lttng_consumer_set_session_rotate_threshold(
+				msg.u.set_session_rotate_threshold.session_id,
+				msg.u.set_session_rotate_threshold.threshold);
+		if (ret < 0) {
+			ERR("Failed to set the rotation threshold of session %" PRIu64,
+					msg.u.set_session_rotate_threshold.session_id);
+			ret_code = LTTCOMM_CONSUMERD_ENOMEM;
+		}
+
+		health_code_update();
+
+		ret = consumer_send_status_msg(sock, ret_code);
+		if (ret < 0) {
+			/* Somehow, the session daemon is not responding anymore. */
+			goto end_nosignal;
+		}
+		break;
+	}
 	default:
 		goto end_nosignal;
 	}
@@ -1766,10 +1808,21 @@ int lttng_kconsumer_on_recv_stream(struct lttng_consumer_stream *stream)
 	 * monitored.
 	 */
 	if (stream->net_seq_idx == (uint64_t) -1ULL && stream->chan->monitor) {
-		ret = utils_create_stream_file(stream->chan->pathname, stream->name,
+		struct lttng_directory_handle *dir_handle;
+
+		pthread_mutex_lock(&stream->chan->output_dir_lock);
+		dir_handle = consumer_channel_get_output_dir_handle(
+				stream->chan);
+		if (!dir_handle) {
+			pthread_mutex_unlock(&stream->chan->output_dir_lock);
+			ret = -1;
+			goto error;
+		}
+		ret = utils_create_stream_file_at(dir_handle, stream->name,
 				stream->chan->tracefile_size, stream->tracefile_count_current,
 				stream->uid, stream->gid, NULL);
 		if (ret < 0) {
+			pthread_mutex_unlock(&stream->chan->output_dir_lock);
 			goto error;
 		}
 		stream->out_fd = ret;
@@ -1778,17 +1831,20 @@ int lttng_kconsumer_on_recv_stream(struct lttng_consumer_stream *stream)
 		if (!stream->metadata_flag) {
 			struct lttng_index_file *index_file;
 
-			index_file = lttng_index_file_create(stream->chan->pathname,
+			index_file = lttng_index_file_create_from_handle(
+					dir_handle,
 					stream->name, stream->uid, stream->gid,
 					stream->chan->tracefile_size,
 					stream->tracefile_count_current,
 					CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
 			if (!index_file) {
+				pthread_mutex_unlock(&stream->chan->output_dir_lock);
 				goto error;
 			}
 			assert(!stream->index_file);
 			stream->index_file = index_file;
 		}
+		pthread_mutex_unlock(&stream->chan->output_dir_lock);
 	}
 
 	if (stream->output == LTTNG_EVENT_MMAP) {
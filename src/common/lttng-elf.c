@@ -24,6 +24,8 @@
 #include <common/macros.h>
 #include <common/readwrite.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -44,6 +46,9 @@
 #define NOTE_STAPSDT_NAME "stapsdt"
 #define NOTE_STAPSDT_TYPE 3
 
+/* Number of binaries kept mapped and indexed between lookups. */
+#define LTTNG_ELF_IMAGE_CACHE_SIZE 4
+
 #if BYTE_ORDER == LITTLE_ENDIAN
 #define NATIVE_ELF_ENDIANNESS ELFDATA2LSB
 #else
@@ -200,6 +205,56 @@ struct lttng_elf {
 	struct lttng_elf_ehdr *ehdr;
 };
 
+struct lttng_elf_section {
+	bool present;
+	uint64_t offset;
+	uint64_t addr;
+	uint64_t size;
+	uint64_t entsize;
+};
+
+/* Function symbol of the symbol table index. */
+struct lttng_elf_func_sym {
+	const char *name;
+	uint64_t addr;
+	/* Position in the symbol table; the first definition wins. */
+	size_t index;
+};
+
+/*
+ * Parsed ELF binary along with a copy of the sections needed to resolve
+ * userspace probes. An image is identified by the device, inode, size and
+ * modification times of the file so that a binary replaced on disk is
+ * parsed again.
+ *
+ * The sections are copied rather than mapped: a cached binary truncated
+ * on disk would otherwise fault (SIGBUS) on the next lookup.
+ */
+struct lttng_elf_image {
+	dev_t dev;
+	ino_t ino;
+	off_t size;
+	time_t mtime;
+	time_t ctime;
+	uint8_t bitness;
+	struct lttng_elf_section text;
+	struct lttng_elf_section symtab;
+	struct lttng_elf_section strtab;
+	struct lttng_elf_section stapsdt;
+	char *symtab_data;
+	char *strtab_data;
+	char *stapsdt_data;
+	/* Function symbols sorted by name, populated on first lookup. */
+	bool func_syms_populated;
+	struct lttng_elf_func_sym *func_syms;
+	size_t nb_func_syms;
+	unsigned long last_use;
+};
+
+static struct lttng_elf_image *image_cache[LTTNG_ELF_IMAGE_CACHE_SIZE];
+static unsigned long image_cache_clock;
+static pthread_mutex_t image_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
 static inline
 int is_elf_32_bit(struct lttng_elf *elf)
 {
@@ -604,275 +659,456 @@ void lttng_elf_destroy(struct lttng_elf *elf)
 	free(elf);
 }
 
+/*
+ * Fill `section` from a section header if its content lies within the file.
+ */
+static
+void lttng_elf_image_set_section(struct lttng_elf_image *image,
+		struct lttng_elf_section *section, struct lttng_elf_shdr *shdr,
+		bool check_bounds)
+{
+	if (section->present) {
+		/* Keep the first section bearing that name. */
+		return;
+	}
+
+	if (check_bounds && (shdr->sh_offset > image->size ||
+			shdr->sh_size > image->size - shdr->sh_offset)) {
+		DBG("ELF section is out of the file's bounds.");
+		return;
+	}
+
+	section->present = true;
+	section->offset = shdr->sh_offset;
+	section->addr = shdr->sh_addr;
+	section->size = shdr->sh_size;
+	section->entsize = shdr->sh_entsize;
+}
+
+/*
+ * Walk the section headers once and record the sections used to resolve
+ * function symbols and SDT probes.
+ */
 static
-int lttng_elf_get_section_hdr_by_name(struct lttng_elf *elf,
-		const char *section_name, struct lttng_elf_shdr **section_hdr)
+int lttng_elf_image_populate_sections(struct lttng_elf_image *image,
+		struct lttng_elf *elf)
 {
 	int i;
-	char *curr_section_name;
-	for (i = 0; i < elf->ehdr->e_shnum; ++i) {
-		*section_hdr = lttng_elf_get_section_hdr(elf, i);
-		curr_section_name = lttng_elf_get_section_name(elf,
-				(*section_hdr)->sh_name);
+	struct lttng_elf_section dynsym = {}, dynstr = {};
+
+	for (i = 0; i < elf->ehdr->e_shnum; i++) {
+		struct lttng_elf_shdr shdr;
+		char *name;
 
-		if (!curr_section_name) {
+		if (populate_section_header(elf, &shdr, i)) {
+			DBG("Error populating section header.");
+			return LTTNG_ERR_ELF_PARSING;
+		}
+
+		name = lttng_elf_get_section_name(elf, shdr.sh_name);
+		if (!name) {
 			continue;
 		}
-		if (strcmp(curr_section_name, section_name) == 0) {
-			return 0;
+
+		if (!strcmp(name, TEXT_SECTION_NAME)) {
+			lttng_elf_image_set_section(image, &image->text, &shdr,
+					false);
+		} else if (!strcmp(name, SYMBOL_TAB_SECTION_NAME)) {
+			lttng_elf_image_set_section(image, &image->symtab,
+					&shdr, true);
+		} else if (!strcmp(name, STRING_TAB_SECTION_NAME)) {
+			lttng_elf_image_set_section(image, &image->strtab,
+					&shdr, true);
+		} else if (!strcmp(name, DYNAMIC_SYMBOL_TAB_SECTION_NAME)) {
+			lttng_elf_image_set_section(image, &dynsym, &shdr,
+					true);
+		} else if (!strcmp(name, DYNAMIC_STRING_TAB_SECTION_NAME)) {
+			lttng_elf_image_set_section(image, &dynstr, &shdr,
+					true);
+		} else if (!strcmp(name, NOTE_STAPSDT_SECTION_NAME)) {
+			lttng_elf_image_set_section(image, &image->stapsdt,
+					&shdr, true);
 		}
+		free(name);
 	}
-	return LTTNG_ERR_ELF_PARSING;
+
+	/*
+	 * The .symtab section might not exist on stripped binaries. All
+	 * symbols in the dynamic symbol table are in the (normal) symbol
+	 * table if it exists.
+	 */
+	if (!image->symtab.present) {
+		image->symtab = dynsym;
+		image->strtab = dynstr;
+	}
+
+	return 0;
 }
 
 static
-char *lttng_elf_get_section_data(struct lttng_elf *elf,
-		struct lttng_elf_shdr *shdr)
+void lttng_elf_image_destroy(struct lttng_elf_image *image)
 {
-	int ret;
-	off_t section_offset;
-	char *data;
-
-	if (!elf || !shdr) {
-		goto error;
+	if (!image) {
+		return;
 	}
 
-	section_offset = shdr->sh_offset;
-	if (lseek(elf->fd, section_offset, SEEK_SET) < 0) {
-		PERROR("Error seeking to section offset");
-		goto error;
-	}
+	free(image->symtab_data);
+	free(image->strtab_data);
+	free(image->stapsdt_data);
+	free(image->func_syms);
+	free(image);
+}
 
-	data = zmalloc(shdr->sh_size);
+/*
+ * Read the content of a section of the binary referred to by `fd`.
+ *
+ * Return a newly allocated buffer on success, NULL on failure.
+ */
+static
+char *lttng_elf_image_read_section(int fd,
+		const struct lttng_elf_section *section)
+{
+	char *data;
+	ssize_t ret;
+
+	/* Never empty so that a zero-sized section is not an error. */
+	data = zmalloc(section->size + 1);
 	if (!data) {
-		PERROR("Error allocating buffer for ELF section data");
+		PERROR("Error allocating ELF section buffer");
 		goto error;
 	}
-	ret = lttng_read(elf->fd, data, shdr->sh_size);
-	if (ret == -1) {
-		PERROR("Error reading ELF section data");
-		goto free_error;
+
+	ret = lttng_pread(fd, data, section->size, section->offset);
+	if (ret < 0 || (uint64_t) ret != section->size) {
+		DBG("Error reading ELF section: offset = %" PRIu64
+				", size = %" PRIu64, section->offset,
+				section->size);
+		goto error;
 	}
 
 	return data;
-
-free_error:
-	free(data);
 error:
+	free(data);
 	return NULL;
 }
 
 /*
- * Convert the virtual address in a binary's mapping to the offset of
- * the corresponding instruction in the binary file.
- * This function assumes the address is in the text section.
+ * Parse the headers of the binary referred to by `fd` and copy the
+ * sections needed to resolve probes. The file descriptor is not kept by
+ * the image.
  *
- * Returns the offset on success or non-zero in case of failure.
+ * Return a pointer to the image on success, NULL on failure.
  */
 static
-int lttng_elf_convert_addr_in_text_to_offset(struct lttng_elf *elf_handle,
-		size_t addr, uint64_t *offset)
+struct lttng_elf_image *lttng_elf_image_create(int fd, const struct stat *st)
 {
-	int ret = 0;
-	off_t text_section_offset;
-	off_t text_section_addr_beg;
-	off_t text_section_addr_end;
-	off_t offset_in_section;
-	struct lttng_elf_shdr *text_section_hdr = NULL;
-
-	if (!elf_handle) {
-		DBG("Invalid ELF handle.");
-		ret = LTTNG_ERR_ELF_PARSING;
+	int ret;
+	struct lttng_elf *elf = NULL;
+	struct lttng_elf_image *image = NULL;
+
+	if (st->st_size <= 0) {
+		DBG("Empty ELF binary.");
 		goto error;
 	}
 
-	/* Get a pointer to the .text section header. */
-	ret = lttng_elf_get_section_hdr_by_name(elf_handle,
-			TEXT_SECTION_NAME, &text_section_hdr);
-	if (ret) {
-		DBG("Text section not found in binary.");
-		ret = LTTNG_ERR_ELF_PARSING;
+	image = zmalloc(sizeof(*image));
+	if (!image) {
+		PERROR("Error allocating struct lttng_elf_image");
 		goto error;
 	}
 
-	text_section_offset = text_section_hdr->sh_offset;
-	text_section_addr_beg = text_section_hdr->sh_addr;
-	text_section_addr_end = text_section_addr_beg + text_section_hdr->sh_size;
+	image->dev = st->st_dev;
+	image->ino = st->st_ino;
+	image->size = st->st_size;
+	image->mtime = st->st_mtime;
+	image->ctime = st->st_ctime;
 
-	/*
-	 * Verify that the address is within the .text section boundaries.
-	 */
-	if (addr < text_section_addr_beg || addr > text_section_addr_end) {
-		DBG("Address found is outside of the .text section addr=0x%zx, "
-			".text section=[0x%jd - 0x%jd].", addr, (intmax_t)text_section_addr_beg,
-			(intmax_t)text_section_addr_end);
-		ret = LTTNG_ERR_ELF_PARSING;
+	elf = lttng_elf_create(fd);
+	if (!elf) {
 		goto error;
 	}
+	image->bitness = elf->bitness;
 
-	offset_in_section = addr - text_section_addr_beg;
+	ret = lttng_elf_image_populate_sections(image, elf);
+	if (ret) {
+		goto error;
+	}
 
-	/*
-	 * Add the target offset in the text section to the offset of this text
-	 * section from the beginning of the binary file.
-	 */
-	*offset = text_section_offset + offset_in_section;
+	if (image->symtab.present && image->strtab.present) {
+		image->symtab_data = lttng_elf_image_read_section(elf->fd,
+				&image->symtab);
+		image->strtab_data = lttng_elf_image_read_section(elf->fd,
+				&image->strtab);
+		if (!image->symtab_data || !image->strtab_data) {
+			goto error;
+		}
+	}
+
+	if (image->stapsdt.present) {
+		image->stapsdt_data = lttng_elf_image_read_section(elf->fd,
+				&image->stapsdt);
+		if (!image->stapsdt_data) {
+			goto error;
+		}
+	}
+
+	lttng_elf_destroy(elf);
+	return image;
 
 error:
-	return ret;
+	lttng_elf_destroy(elf);
+	lttng_elf_image_destroy(image);
+	return NULL;
 }
 
 /*
- * Compute the offset of a symbol from the begining of the ELF binary.
+ * Get the image of the binary referred to by `fd`, parsing and reading it
+ * if it is not already cached. The least recently used image is evicted
+ * when the cache is full.
  *
- * On success, returns 0 offset parameter is set to the computed value
- * On failure, returns -1.
+ * The image cache lock must be held. Return NULL on failure.
  */
-int lttng_elf_get_symbol_offset(int fd, char *symbol, uint64_t *offset)
+static
+struct lttng_elf_image *lttng_elf_image_get(int fd)
 {
-	int ret = 0;
-	int sym_found = 0;
-	int sym_count = 0;
-	int sym_idx = 0;
-	uint64_t addr = 0;
-	char *curr_sym_str = NULL;
-	char *symbol_table_data = NULL;
-	char *string_table_data = NULL;
-	char *string_table_name = NULL;
-	struct lttng_elf_shdr *symtab_hdr = NULL;
-	struct lttng_elf_shdr *strtab_hdr = NULL;
-	struct lttng_elf *elf = NULL;
+	int i, victim = 0;
+	struct stat st;
+	struct lttng_elf_image *image;
 
-	if (!symbol || !offset ) {
-		ret = LTTNG_ERR_ELF_PARSING;
-		goto end;
+	if (fd < 0) {
+		return NULL;
 	}
 
-	elf = lttng_elf_create(fd);
-	if (!elf) {
-		ret = LTTNG_ERR_ELF_PARSING;
-		goto end;
+	if (fstat(fd, &st)) {
+		PERROR("Error getting ELF binary status");
+		return NULL;
 	}
 
-	/*
-	 * The .symtab section might not exist on stripped binaries.
-	 * Try to get the symbol table section header first. If it's absent,
-	 * try to get the dynamic symbol table. All symbols in the dynamic
-	 * symbol tab are in the (normal) symbol table if it exists.
-	 */
-	ret = lttng_elf_get_section_hdr_by_name(elf, SYMBOL_TAB_SECTION_NAME,
-			&symtab_hdr);
-	if (ret) {
-		DBG("Cannot get ELF Symbol Table section. Trying to get ELF Dynamic Symbol Table section.");
-		/* Get the dynamic symbol table section header. */
-		ret = lttng_elf_get_section_hdr_by_name(elf, DYNAMIC_SYMBOL_TAB_SECTION_NAME,
-				&symtab_hdr);
-		if (ret) {
-			DBG("Cannot get ELF Symbol Table nor Dynamic Symbol Table sections.");
-			ret = LTTNG_ERR_ELF_PARSING;
-			goto destroy_elf;
+	for (i = 0; i < LTTNG_ELF_IMAGE_CACHE_SIZE; i++) {
+		image = image_cache[i];
+		if (!image) {
+			victim = i;
+			continue;
+		}
+		if (image->dev == st.st_dev && image->ino == st.st_ino &&
+				image->size == st.st_size &&
+				image->mtime == st.st_mtime &&
+				image->ctime == st.st_ctime) {
+			DBG("Using cached ELF binary image");
+			image->last_use = ++image_cache_clock;
+			return image;
+		}
+		if (image_cache[victim] &&
+				image->last_use < image_cache[victim]->last_use) {
+			victim = i;
 		}
-		string_table_name = DYNAMIC_STRING_TAB_SECTION_NAME;
-	} else {
-		string_table_name = STRING_TAB_SECTION_NAME;
 	}
 
-	/* Get the data associated with the symbol table section. */
-	symbol_table_data = lttng_elf_get_section_data(elf, symtab_hdr);
-	if (symbol_table_data == NULL) {
-		DBG("Cannot get ELF Symbol Table data.");
-		ret = LTTNG_ERR_ELF_PARSING;
-		goto destroy_elf;
+	image = lttng_elf_image_create(fd, &st);
+	if (!image) {
+		return NULL;
 	}
 
-	/* Get the string table section header. */
-	ret = lttng_elf_get_section_hdr_by_name(elf, string_table_name,
-			&strtab_hdr);
+	lttng_elf_image_destroy(image_cache[victim]);
+	image->last_use = ++image_cache_clock;
+	image_cache[victim] = image;
+	return image;
+}
+
+static
+int compare_func_sym(const void *a, const void *b)
+{
+	const struct lttng_elf_func_sym *sym_a = a, *sym_b = b;
+	int ret;
+
+	ret = strcmp(sym_a->name, sym_b->name);
 	if (ret) {
-		DBG("Cannot get ELF string table section.");
-		goto free_symbol_table_data;
+		return ret;
 	}
+	return sym_a->index < sym_b->index ? -1 : sym_a->index > sym_b->index;
+}
 
-	/* Get the data associated with the string table section. */
-	string_table_data = lttng_elf_get_section_data(elf, strtab_hdr);
-	if (string_table_data == NULL) {
-		DBG("Cannot get ELF string table section data.");
-		ret = LTTNG_ERR_ELF_PARSING;
-		goto free_symbol_table_data;
+static
+int compare_func_sym_name(const void *key, const void *elem)
+{
+	const struct lttng_elf_func_sym *sym = elem;
+
+	return strcmp(key, sym->name);
+}
+
+/*
+ * Build the index of the function symbols of an image, sorted by name.
+ */
+static
+int lttng_elf_image_populate_func_syms(struct lttng_elf_image *image)
+{
+	size_t sym_idx, sym_count, sym_size;
+	const char *symbol_table_data, *string_table_data;
+
+	if (!image->symtab.present || !image->strtab.present) {
+		DBG("Cannot get ELF Symbol Table nor Dynamic Symbol Table sections.");
+		return LTTNG_ERR_ELF_PARSING;
+	}
+
+	sym_size = image->bitness == ELFCLASS32 ?
+			sizeof(Elf32_Sym) : sizeof(Elf64_Sym);
+	if (image->symtab.entsize < sym_size) {
+		DBG("Invalid ELF Symbol Table entry size.");
+		return LTTNG_ERR_ELF_PARSING;
 	}
 
-	/* Get the number of symbol in the table for the iteration. */
-	sym_count = symtab_hdr->sh_size / symtab_hdr->sh_entsize;
+	symbol_table_data = image->symtab_data;
+	string_table_data = image->strtab_data;
+	sym_count = image->symtab.size / image->symtab.entsize;
+
+	image->func_syms = zmalloc(sym_count * sizeof(*image->func_syms));
+	if (!image->func_syms && sym_count) {
+		PERROR("Error allocating ELF symbol index");
+		return LTTNG_ERR_NOMEM;
+	}
 
-	/* Loop over all symbol. */
 	for (sym_idx = 0; sym_idx < sym_count; sym_idx++) {
 		struct lttng_elf_sym curr_sym;
+		struct lttng_elf_func_sym *func_sym;
+		const char *sym_data = symbol_table_data +
+				sym_idx * image->symtab.entsize;
 
-		/* Get the symbol at the current index. */
-		if (is_elf_32_bit(elf)) {
-			Elf32_Sym tmp = ((Elf32_Sym *) symbol_table_data)[sym_idx];
+		/* The section is not guaranteed to be aligned in the file. */
+		if (image->bitness == ELFCLASS32) {
+			Elf32_Sym tmp;
+
+			memcpy(&tmp, sym_data, sizeof(tmp));
 			copy_sym(tmp, curr_sym);
 		} else {
-			Elf64_Sym tmp = ((Elf64_Sym *) symbol_table_data)[sym_idx];
+			Elf64_Sym tmp;
+
+			memcpy(&tmp, sym_data, sizeof(tmp));
 			copy_sym(tmp, curr_sym);
 		}
 
 		/*
-		 * If the st_name field is zero, there is no string name for
-		 * this symbol; skip to the next symbol.
+		 * Skip nameless symbols, symbols that are not functions and
+		 * names that are not terminated within the string table.
 		 */
-		if (curr_sym.st_name == 0) {
+		if (curr_sym.st_name == 0 ||
+				ELF_ST_TYPE(curr_sym.st_info) != STT_FUNC ||
+				curr_sym.st_name >= image->strtab.size ||
+				!memchr(string_table_data + curr_sym.st_name, '\0',
+					image->strtab.size - curr_sym.st_name)) {
 			continue;
 		}
 
-		/*
-		 * Use the st_name field in the lttng_elf_sym struct to get offset of
-		 * the symbol's name from the beginning of the string table.
-		 */
-		curr_sym_str = string_table_data + curr_sym.st_name;
+		func_sym = &image->func_syms[image->nb_func_syms++];
+		func_sym->name = string_table_data + curr_sym.st_name;
+		func_sym->addr = curr_sym.st_value;
+		func_sym->index = sym_idx;
+	}
 
-		/*
-		 * If the current symbol is not a function; skip to the next symbol.
-		 */
-		if (ELF_ST_TYPE(curr_sym.st_info) != STT_FUNC) {
-			continue;
-		}
+	qsort(image->func_syms, image->nb_func_syms,
+			sizeof(*image->func_syms), compare_func_sym);
+	image->func_syms_populated = true;
+	DBG("Indexed %zu ELF function symbols", image->nb_func_syms);
+	return 0;
+}
 
-		/*
-		 * Compare with the search symbol. If there is a match set the address
-		 * output parameter and return success.
-		 */
-		if (strcmp(symbol, curr_sym_str) == 0 ) {
-			sym_found = 1;
-			addr = curr_sym.st_value;
-			break;
+/*
+ * Convert the virtual address in a binary's mapping to the offset of
+ * the corresponding instruction in the binary file.
+ * This function assumes the address is in the text section.
+ *
+ * Returns the offset on success or non-zero in case of failure.
+ */
+static
+int lttng_elf_convert_addr_in_text_to_offset(struct lttng_elf_image *image,
+		uint64_t addr, uint64_t *offset)
+{
+	uint64_t text_section_addr_beg;
+	uint64_t text_section_addr_end;
+
+	if (!image->text.present) {
+		DBG("Text section not found in binary.");
+		return LTTNG_ERR_ELF_PARSING;
+	}
+
+	text_section_addr_beg = image->text.addr;
+	text_section_addr_end = text_section_addr_beg + image->text.size;
+
+	/*
+	 * Verify that the address is within the .text section boundaries.
+	 */
+	if (addr < text_section_addr_beg || addr > text_section_addr_end) {
+		DBG("Address found is outside of the .text section addr=0x%" PRIx64 ", "
+			".text section=[0x%" PRIx64 " - 0x%" PRIx64 "].", addr,
+			text_section_addr_beg, text_section_addr_end);
+		return LTTNG_ERR_ELF_PARSING;
+	}
+
+	/*
+	 * Add the target offset in the text section to the offset of this text
+	 * section from the beginning of the binary file.
+	 */
+	*offset = image->text.offset + (addr - text_section_addr_beg);
+	return 0;
+}
+
+/*
+ * Compute the offset of a symbol from the begining of the ELF binary.
+ *
+ * The binary is parsed and its function symbols indexed on first use; later
+ * lookups in the same, unmodified, binary only search the index.
+ *
+ * On success, returns 0 offset parameter is set to the computed value
+ * On failure, returns -1.
+ */
+int lttng_elf_get_symbol_offset(int fd, char *symbol, uint64_t *offset)
+{
+	int ret = 0;
+	struct lttng_elf_image *image;
+	const struct lttng_elf_func_sym *sym;
+
+	if (!symbol || !offset ) {
+		return LTTNG_ERR_ELF_PARSING;
+	}
+
+	pthread_mutex_lock(&image_cache_lock);
+	image = lttng_elf_image_get(fd);
+	if (!image) {
+		ret = LTTNG_ERR_ELF_PARSING;
+		goto end;
+	}
+
+	if (!image->func_syms_populated) {
+		ret = lttng_elf_image_populate_func_syms(image);
+		if (ret) {
+			goto end;
 		}
 	}
 
-	if (!sym_found) {
+	sym = bsearch(symbol, image->func_syms, image->nb_func_syms,
+			sizeof(*image->func_syms), compare_func_sym_name);
+	if (!sym) {
 		DBG("Symbol not found.");
 		ret = LTTNG_ERR_ELF_PARSING;
-		goto free_string_table_data;
+		goto end;
+	}
+
+	/* Rewind to the first definition of the symbol. */
+	while (sym > image->func_syms && !strcmp((sym - 1)->name, symbol)) {
+		sym--;
 	}
 
 	/*
 	 * Use the virtual address of the symbol to compute the offset of this
 	 * symbol from the beginning of the executable file.
 	 */
-	ret = lttng_elf_convert_addr_in_text_to_offset(elf, addr, offset);
+	ret = lttng_elf_convert_addr_in_text_to_offset(image, sym->addr, offset);
 	if (ret) {
 		DBG("Cannot convert addr to offset.");
-		goto free_string_table_data;
+		goto end;
 	}
 
-
-free_string_table_data:
-	free(string_table_data);
-free_symbol_table_data:
-	free(symbol_table_data);
-destroy_elf:
-	lttng_elf_destroy(elf);
 end:
+	pthread_mutex_unlock(&image_cache_lock);
 	return ret;
 }
 
@@ -888,44 +1124,36 @@ int lttng_elf_get_sdt_probe_offsets(int fd, const char *provider_name,
 		const char *probe_name, uint64_t **offsets, uint32_t *nb_probes)
 {
 	int ret = 0, nb_match = 0;
-	struct lttng_elf_shdr *stap_note_section_hdr = NULL;
-	struct lttng_elf *elf = NULL;
-	char *stap_note_section_data = NULL;
-	char *curr_note_section_begin, *curr_data_ptr, *curr_probe, *curr_provider;
-	char *next_note_ptr;
+	struct lttng_elf_image *image;
+	const char *stap_note_section_data;
+	const char *curr_note_section_begin, *curr_data_ptr, *curr_probe, *curr_provider;
+	const char *curr_desc_end;
+	const char *next_note_ptr;
 	uint32_t name_size, desc_size, note_type;
 	uint64_t curr_probe_location, curr_probe_offset, curr_semaphore_location;
 	uint64_t *probe_locs = NULL, *new_probe_locs = NULL;
 
 	if (!provider_name || !probe_name || !nb_probes || !offsets) {
 		DBG("Invalid arguments.");
-		ret = LTTNG_ERR_ELF_PARSING;
-		goto error;
+		return LTTNG_ERR_ELF_PARSING;
 	}
 
-	elf = lttng_elf_create(fd);
-	if (!elf) {
+	pthread_mutex_lock(&image_cache_lock);
+	image = lttng_elf_image_get(fd);
+	if (!image) {
 		DBG("Error allocation ELF.");
 		ret = LTTNG_ERR_ELF_PARSING;
-		goto error;
+		goto end;
 	}
 
-	/* Get the stap note section header. */
-	ret = lttng_elf_get_section_hdr_by_name(elf, NOTE_STAPSDT_SECTION_NAME,
-			&stap_note_section_hdr);
-	if (ret) {
+	/* Get the stap note section. */
+	if (!image->stapsdt.present) {
 		DBG("Cannot get ELF stap note section.");
-		goto destroy_elf_error;
-	}
-
-	/* Get the data associated with the stap note section. */
-	stap_note_section_data = lttng_elf_get_section_data(elf, stap_note_section_hdr);
-	if (stap_note_section_data == NULL) {
-		DBG("Cannot get ELF stap note section data.");
 		ret = LTTNG_ERR_ELF_PARSING;
-		goto destroy_elf_error;
+		goto end;
 	}
 
+	stap_note_section_data = image->stapsdt_data;
 	next_note_ptr = stap_note_section_data;
 	curr_note_section_begin = stap_note_section_data;
 
@@ -934,14 +1162,23 @@ int lttng_elf_get_sdt_probe_offsets(int fd, const char *provider_name,
 		curr_data_ptr = next_note_ptr;
 		/* Check if we have reached the end of the note section. */
 		if (curr_data_ptr >=
-				curr_note_section_begin + stap_note_section_hdr->sh_size) {
+				curr_note_section_begin + image->stapsdt.size) {
 			*nb_probes = nb_match;
 			*offsets = probe_locs;
 			ret = 0;
 			break;
 		}
+
+		/* Stay within the copy of the section. */
+		if (curr_note_section_begin + image->stapsdt.size - curr_data_ptr <
+				3 * sizeof(uint32_t)) {
+			DBG("Truncated note in SDT probe descriptions section.");
+			ret = -1;
+			goto realloc_error;
+		}
+
 		/* Get name size field. */
-		name_size = next_4bytes_boundary(*(uint32_t*) curr_data_ptr);
+		name_size = next_4bytes_boundary(*(const uint32_t *) curr_data_ptr);
 		curr_data_ptr += sizeof(uint32_t);
 
 		/* Sanity check; a zero name_size is reserved. */
@@ -953,11 +1190,11 @@ int lttng_elf_get_sdt_probe_offsets(int fd, const char *provider_name,
 		}
 
 		/* Get description size field. */
-		desc_size = next_4bytes_boundary(*(uint32_t*) curr_data_ptr);
+		desc_size = next_4bytes_boundary(*(const uint32_t *) curr_data_ptr);
 		curr_data_ptr += sizeof(uint32_t);
 
 		/* Get type field. */
-		note_type = *(uint32_t *) curr_data_ptr;
+		note_type = *(const uint32_t *) curr_data_ptr;
 		curr_data_ptr += sizeof(uint32_t);
 
 		/*
@@ -969,6 +1206,12 @@ int lttng_elf_get_sdt_probe_offsets(int fd, const char *provider_name,
 		 */
 		next_note_ptr = next_note_ptr +
 			(3 * sizeof(uint32_t)) + desc_size + name_size;
+		if ((uint64_t) name_size + desc_size >
+				curr_note_section_begin + image->stapsdt.size - curr_data_ptr) {
+			DBG("Truncated note in SDT probe descriptions section.");
+			ret = -1;
+			goto realloc_error;
+		}
 
 		/*
 		 * Move ptr to the end of the name string (we don't need it)
@@ -980,23 +1223,46 @@ int lttng_elf_get_sdt_probe_offsets(int fd, const char *provider_name,
 		}
 
 		curr_data_ptr += name_size;
+		curr_desc_end = curr_data_ptr + desc_size;
+
+		/*
+		 * The descriptor holds three addresses followed by the
+		 * provider and probe names.
+		 */
+		if (desc_size < 3 * sizeof(uint64_t)) {
+			DBG("Invalid description size field in SDT probe descriptions section.");
+			ret = -1;
+			goto realloc_error;
+		}
 
 		/* Get probe location.  */
-		curr_probe_location = *(uint64_t *) curr_data_ptr;
+		memcpy(&curr_probe_location, curr_data_ptr, sizeof(curr_probe_location));
 		curr_data_ptr += sizeof(uint64_t);
 
 		/* Pass over the base. Not needed. */
 		curr_data_ptr += sizeof(uint64_t);
 
 		/* Get semaphore location. */
-		curr_semaphore_location = *(uint64_t *) curr_data_ptr;
+		memcpy(&curr_semaphore_location, curr_data_ptr, sizeof(curr_semaphore_location));
 		curr_data_ptr += sizeof(uint64_t);
 		/* Get provider name. */
 		curr_provider = curr_data_ptr;
-		curr_data_ptr += strlen(curr_provider) + 1;
+		curr_data_ptr = memchr(curr_provider, '\0',
+				curr_desc_end - curr_provider);
+		if (!curr_data_ptr) {
+			DBG("Unterminated provider name in SDT probe descriptions section.");
+			ret = -1;
+			goto realloc_error;
+		}
+		curr_data_ptr++;
 
 		/* Get probe name. */
 		curr_probe = curr_data_ptr;
+		if (!memchr(curr_probe, '\0', curr_desc_end - curr_probe)) {
+			DBG("Unterminated probe name in SDT probe descriptions section.");
+			ret = -1;
+			goto realloc_error;
+		}
 
 		/* Check if the provider and probe name match */
 		if (strcmp(provider_name, curr_provider) == 0 &&
@@ -1033,7 +1299,7 @@ int lttng_elf_get_sdt_probe_offsets(int fd, const char *provider_name,
 			 * Use the virtual address of the probe to compute the offset of
 			 * this probe from the beginning of the executable file.
 			 */
-			ret = lttng_elf_convert_addr_in_text_to_offset(elf,
+			ret = lttng_elf_convert_addr_in_text_to_offset(image,
 					curr_probe_location, &curr_probe_offset);
 			if (ret) {
 				DBG("Conversion error in SDT.");
@@ -1045,10 +1311,7 @@ int lttng_elf_get_sdt_probe_offsets(int fd, const char *provider_name,
 	}
 
 end:
-	free(stap_note_section_data);
-destroy_elf_error:
-	lttng_elf_destroy(elf);
-error:
+	pthread_mutex_unlock(&image_cache_lock);
 	return ret;
 realloc_error:
 	free(probe_locs);
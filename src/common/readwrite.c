@@ -106,3 +106,46 @@ error:
 		return i;
 	}
 }
+
+/*
+ * Same as lttng_read, but reads at the given offset without changing the
+ * file offset. This allows multiple threads to read from the same fd
+ * concurrently.
+ */
+LTTNG_HIDDEN
+ssize_t lttng_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	size_t i = 0;
+	ssize_t ret;
+
+	assert(buf);
+
+	/*
+	 * Deny a read count that can be bigger then the returned value max size.
+	 * This makes the function to never return an overflow value.
+	 */
+	if (count > SSIZE_MAX) {
+		return -EINVAL;
+	}
+
+	do {
+		ret = pread(fd, buf + i, count - i, offset + i);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;	/* retry operation */
+			} else {
+				goto error;
+			}
+		}
+		i += ret;
+		assert(i <= count);
+	} while (count - i > 0 && ret > 0);
+	return i;
+
+error:
+	if (i == 0) {
+		return -1;
+	} else {
+		return i;
+	}
+}
@@ -33,5 +33,7 @@ LTTNG_HIDDEN
 ssize_t lttng_read(int fd, void *buf, size_t count);
 LTTNG_HIDDEN
 ssize_t lttng_write(int fd, const void *buf, size_t count);
+LTTNG_HIDDEN
+ssize_t lttng_pread(int fd, void *buf, size_t count, off_t offset);
 
 #endif /* LTTNG_COMMON_READWRITE_H */
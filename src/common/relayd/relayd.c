@@ -1340,3 +1340,163 @@ error:
 	free(msg);
 	return ret;
 }
+
+/*
+ * Send a batch of live beacons in a single command. The beacons are
+ * expected in big endian.
+ *
+ * Peers older than 2.12 get one RELAYD_SEND_INDEX per beacon.
+ */
+int relayd_send_beacons(struct lttcomm_relayd_sock *rsock,
+		const struct lttcomm_relayd_beacon *beacons, uint32_t count)
+{
+	int ret;
+	uint32_t i;
+	size_t len;
+	struct lttcomm_relayd_beacons *msg = NULL;
+	struct lttcomm_relayd_generic_reply reply;
+
+	/* Code flow error. Safety net. */
+	assert(rsock);
+	assert(beacons || !count);
+
+	if (!count) {
+		ret = 0;
+		goto error;
+	}
+
+	if (rsock->minor < 12) {
+		for (i = 0; i < count; i++) {
+			struct ctf_packet_index index;
+
+			memset(&index, 0, sizeof(index));
+			index.stream_id = beacons[i].stream_id;
+			index.timestamp_end = beacons[i].timestamp_end;
+			ret = relayd_send_index(rsock, &index,
+					be64toh(beacons[i].relay_stream_id),
+					be64toh(beacons[i].net_seq_num));
+			if (ret < 0) {
+				goto error;
+			}
+		}
+		ret = 0;
+		goto error;
+	}
+
+	DBG("Relayd sending %" PRIu32 " beacons", count);
+
+	len = sizeof(*msg) + count * sizeof(*beacons);
+	msg = zmalloc(len);
+	if (!msg) {
+		PERROR("Alloc beacons msg");
+		ret = -1;
+		goto error;
+	}
+	msg->count = htobe32(count);
+	memcpy(msg->beacons, beacons, count * sizeof(*beacons));
+
+	/* Send command */
+	ret = send_command(rsock, RELAYD_SEND_BEACONS, (void *) msg, len, 0);
+	if (ret < 0) {
+		goto error;
+	}
+
+	/* Receive response */
+	ret = recv_reply(rsock, (void *) &reply, sizeof(reply));
+	if (ret < 0) {
+		goto error;
+	}
+
+	reply.ret_code = be32toh(reply.ret_code);
+
+	if (reply.ret_code != LTTNG_OK) {
+		ret = -1;
+		ERR("Relayd send beacons replied error %d", reply.ret_code);
+	} else {
+		/* Success */
+		ret = 0;
+	}
+
+error:
+	free(msg);
+	return ret;
+}
+
+/*
+ * Rotate a batch of data streams to the same new path with a single
+ * command. The positions are expected in big endian.
+ */
+int relayd_rotate_streams(struct lttcomm_relayd_sock *rsock,
+		const char *new_pathname, uint64_t new_chunk_id,
+		const struct lttcomm_relayd_stream_rotation_position *positions,
+		uint32_t count)
+{
+	int ret;
+	size_t path_len, msg_len;
+	struct lttcomm_relayd_rotate_streams *msg = NULL;
+	struct lttcomm_relayd_generic_reply reply;
+
+	/* Code flow error. Safety net. */
+	assert(rsock);
+	assert(positions || !count);
+
+	if (!count) {
+		ret = 0;
+		goto error;
+	}
+
+	DBG("Sending rotate streams command for %" PRIu32 " streams to relayd",
+			count);
+
+	/* Account for the trailing NULL. */
+	path_len = lttng_strnlen(new_pathname, LTTNG_PATH_MAX) + 1;
+	if (path_len > LTTNG_PATH_MAX) {
+		ERR("Path used in relayd rotate streams command exceeds the maximal allowed length");
+		ret = -1;
+		goto error;
+	}
+
+	msg_len = sizeof(*msg) + path_len + count * sizeof(*positions);
+	msg = zmalloc(msg_len);
+	if (!msg) {
+		PERROR("Failed to allocate relayd rotate streams command of %zu bytes",
+				msg_len);
+		ret = -1;
+		goto error;
+	}
+
+	msg->stream_count = htobe32(count);
+	msg->new_chunk_id = htobe64(new_chunk_id);
+	msg->pathname_length = htobe32(path_len);
+	memcpy(msg->data, new_pathname, path_len - 1);
+	memcpy(msg->data + path_len, positions, count * sizeof(*positions));
+
+	/* Send command. */
+	ret = send_command(rsock, RELAYD_ROTATE_STREAMS, (void *) msg, msg_len, 0);
+	if (ret < 0) {
+		ERR("Send rotate streams command");
+		goto error;
+	}
+
+	/* Receive response. */
+	ret = recv_reply(rsock, (void *) &reply, sizeof(reply));
+	if (ret < 0) {
+		ERR("Receive rotate streams reply");
+		goto error;
+	}
+
+	reply.ret_code = be32toh(reply.ret_code);
+
+	if (reply.ret_code != LTTNG_OK) {
+		ret = -1;
+		ERR("Relayd rotate streams replied error %d", reply.ret_code);
+	} else {
+		/* Success. */
+		ret = 0;
+		DBG("Relayd rotated %" PRIu32 " streams successfully", count);
+	}
+
+error:
+	free(msg);
+	return ret;
+}
@@ -59,5 +59,11 @@ int relayd_rotate_rename(struct lttcomm_relayd_sock *sock,
 int relayd_rotate_pending(struct lttcomm_relayd_sock *sock,
 		uint64_t chunk_id);
 int relayd_mkdir(struct lttcomm_relayd_sock *rsock, const char *path);
+int relayd_send_beacons(struct lttcomm_relayd_sock *rsock,
+		const struct lttcomm_relayd_beacon *beacons, uint32_t count);
+int relayd_rotate_streams(struct lttcomm_relayd_sock *rsock,
+		const char *new_pathname, uint64_t new_chunk_id,
+		const struct lttcomm_relayd_stream_rotation_position *positions,
+		uint32_t count);
 
 #endif /* _RELAYD_H */
@@ -32,6 +32,8 @@
 #include <assert.h>
 #include <signal.h>
 
+#include <urcu/uatomic.h>
+
 #include <common/lttng-kernel.h>
 #include <common/common.h>
 #include <common/utils.h>
@@ -68,6 +70,11 @@ struct run_as_rmdir_recursive_data {
 	char path[PATH_MAX];
 };
 
+struct run_as_rename_data {
+	char old_path[PATH_MAX];
+	char new_path[PATH_MAX];
+};
+
 struct run_as_extract_elf_symbol_offset_data {
 	char function[LTTNG_SYMBOL_NAME_LEN];
 };
@@ -93,6 +100,10 @@ struct run_as_rmdir_recursive_ret {
 	int ret;
 };
 
+struct run_as_rename_ret {
+	int ret;
+};
+
 struct run_as_extract_elf_symbol_offset_ret {
 	uint64_t offset;
 };
@@ -108,10 +119,13 @@ enum run_as_cmd {
 	RUN_AS_MKDIR_RECURSIVE,
 	RUN_AS_MKDIRAT_RECURSIVE,
 	RUN_AS_OPEN,
+	RUN_AS_OPENAT,
 	RUN_AS_UNLINK,
+	RUN_AS_UNLINKAT,
 	RUN_AS_RMDIR_RECURSIVE,
 	RUN_AS_EXTRACT_ELF_SYMBOL_OFFSET,
 	RUN_AS_EXTRACT_SDT_PROBE_OFFSETS,
+	RUN_AS_RENAME,
 };
 
 struct run_as_data {
@@ -122,6 +136,7 @@ struct run_as_data {
 		struct run_as_open_data open;
 		struct run_as_unlink_data unlink;
 		struct run_as_rmdir_recursive_data rmdir_recursive;
+		struct run_as_rename_data rename;
 		struct run_as_extract_elf_symbol_offset_data extract_elf_symbol_offset;
 		struct run_as_extract_sdt_probe_offsets_data extract_sdt_probe_offsets;
 	} u;
@@ -151,6 +166,7 @@ struct run_as_ret {
 		struct run_as_open_ret open;
 		struct run_as_unlink_ret unlink;
 		struct run_as_rmdir_recursive_ret rmdir_recursive;
+		struct run_as_rename_ret rename;
 		struct run_as_extract_elf_symbol_offset_ret extract_elf_symbol_offset;
 		struct run_as_extract_sdt_probe_offsets_ret extract_sdt_probe_offsets;
 	} u;
@@ -164,10 +180,22 @@ struct run_as_worker {
 	char *procname;
 };
 
-/* Single global worker per process (for now). */
-static struct run_as_worker *global_worker;
-/* Lock protecting the worker. */
-static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+struct run_as_worker_slot {
+	/* Lock protecting the worker; held for the whole command. */
+	pthread_mutex_t lock;
+	struct run_as_worker *worker;
+};
+
+/*
+ * Pool of workers of the process. Each worker executes one command at a
+ * time, so commands issued concurrently by different threads are spread
+ * over the idle workers instead of waiting on a single one.
+ */
+static struct run_as_worker_slot worker_pool[DEFAULT_RUN_AS_WORKER_POOL_SIZE] = {
+	[0 ... DEFAULT_RUN_AS_WORKER_POOL_SIZE - 1] = {
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+	},
+};
 
 #ifdef VALGRIND
 static
@@ -231,19 +259,32 @@ int _mkdirat(struct run_as_data *data, struct run_as_ret *ret_value)
 static
 int _open(struct run_as_data *data, struct run_as_ret *ret_value)
 {
-	ret_value->u.open.ret = open(data->u.open.path, data->u.open.flags, data->u.open.mode);
+	struct lttng_directory_handle handle;
+
+	(void) lttng_directory_handle_init_from_dirfd(&handle, data->fd);
+	/* Safe to call as we have transitioned to the requested uid/gid. */
+	ret_value->u.open.ret = lttng_directory_handle_open_file(&handle,
+			data->u.open.path, data->u.open.flags,
+			data->u.open.mode);
 	ret_value->fd = ret_value->u.open.ret;
 	ret_value->_errno = errno;
 	ret_value->_error = ret_value->u.open.ret < 0;
+	lttng_directory_handle_fini(&handle);
 	return ret_value->u.open.ret;
 }
 
 static
 int _unlink(struct run_as_data *data, struct run_as_ret *ret_value)
 {
-	ret_value->u.unlink.ret = unlink(data->u.unlink.path);
+	struct lttng_directory_handle handle;
+
+	(void) lttng_directory_handle_init_from_dirfd(&handle, data->fd);
+	/* Safe to call as we have transitioned to the requested uid/gid. */
+	ret_value->u.unlink.ret = lttng_directory_handle_unlink_file(&handle,
+			data->u.unlink.path);
 	ret_value->_errno = errno;
 	ret_value->_error = (ret_value->u.unlink.ret) ? true : false;
+	lttng_directory_handle_fini(&handle);
 	return ret_value->u.unlink.ret;
 }
 
@@ -256,6 +297,16 @@ int _rmdir_recursive(struct run_as_data *data, struct run_as_ret *ret_value)
 	return ret_value->u.rmdir_recursive.ret;
 }
 
+static
+int _rename(struct run_as_data *data, struct run_as_ret *ret_value)
+{
+	ret_value->u.rename.ret = rename(data->u.rename.old_path,
+			data->u.rename.new_path);
+	ret_value->_errno = errno;
+	ret_value->_error = (ret_value->u.rename.ret) ? true : false;
+	return ret_value->u.rename.ret;
+}
+
 #ifdef HAVE_ELF_H
 static
 int _extract_elf_symbol_offset(struct run_as_data *data,
@@ -344,11 +395,15 @@ run_as_fct run_as_enum_to_fct(enum run_as_cmd cmd)
 	case RUN_AS_MKDIRAT_RECURSIVE:
 		return _mkdirat_recursive;
 	case RUN_AS_OPEN:
+	case RUN_AS_OPENAT:
 		return _open;
 	case RUN_AS_UNLINK:
+	case RUN_AS_UNLINKAT:
 		return _unlink;
 	case RUN_AS_RMDIR_RECURSIVE:
 		return _rmdir_recursive;
+	case RUN_AS_RENAME:
+		return _rename;
 	case RUN_AS_EXTRACT_ELF_SYMBOL_OFFSET:
 		return _extract_elf_symbol_offset;
 	case RUN_AS_EXTRACT_SDT_PROBE_OFFSETS:
@@ -410,6 +465,8 @@ int send_fd_to_worker(struct run_as_worker *worker, enum run_as_cmd cmd, int fd)
 	case RUN_AS_EXTRACT_SDT_PROBE_OFFSETS:
 	case RUN_AS_MKDIRAT:
 	case RUN_AS_MKDIRAT_RECURSIVE:
+	case RUN_AS_OPENAT:
+	case RUN_AS_UNLINKAT:
 		break;
 	default:
 		return 0;
@@ -436,6 +493,7 @@ int send_fd_to_master(struct run_as_worker *worker, enum run_as_cmd cmd, int fd)
 
 	switch (cmd) {
 	case RUN_AS_OPEN:
+	case RUN_AS_OPENAT:
 		break;
 	default:
 		return 0;
@@ -466,6 +524,7 @@ int recv_fd_from_worker(struct run_as_worker *worker, enum run_as_cmd cmd, int *
 
 	switch (cmd) {
 	case RUN_AS_OPEN:
+	case RUN_AS_OPENAT:
 		break;
 	default:
 		return 0;
@@ -490,9 +549,13 @@ int recv_fd_from_master(struct run_as_worker *worker, enum run_as_cmd cmd, int *
 	case RUN_AS_EXTRACT_SDT_PROBE_OFFSETS:
 	case RUN_AS_MKDIRAT:
 	case RUN_AS_MKDIRAT_RECURSIVE:
+	case RUN_AS_OPENAT:
+	case RUN_AS_UNLINKAT:
 		break;
 	case RUN_AS_MKDIR:
 	case RUN_AS_MKDIR_RECURSIVE:
+	case RUN_AS_OPEN:
+	case RUN_AS_UNLINK:
 		*fd = AT_FDCWD;
 		/* fall-through */
 	default:
@@ -513,11 +576,13 @@ int cleanup_received_fd(enum run_as_cmd cmd, int fd)
 {
 	int ret = 0;
 
+	/*
+	 * The commands operating on a directory handle release the file
+	 * descriptor they receive when finalizing their handle.
+	 */
 	switch (cmd) {
 	case RUN_AS_EXTRACT_ELF_SYMBOL_OFFSET:
 	case RUN_AS_EXTRACT_SDT_PROBE_OFFSETS:
-	case RUN_AS_MKDIRAT:
-	case RUN_AS_MKDIRAT_RECURSIVE:
 		break;
 	default:
 		return 0;
@@ -817,6 +882,30 @@ int run_as_noworker(enum run_as_cmd cmd,
 		ret = -1;
 		goto end;
 	}
+
+	switch (cmd) {
+	case RUN_AS_MKDIRAT:
+	case RUN_AS_MKDIRAT_RECURSIVE:
+	case RUN_AS_OPENAT:
+	case RUN_AS_UNLINKAT:
+		/*
+		 * These commands release the directory file descriptor they
+		 * are given. Hand them a copy, like the worker receives, to
+		 * leave the caller's one untouched.
+		 */
+		data->fd = dup(data->fd);
+		if (data->fd < 0) {
+			PERROR("Failed to duplicate directory file descriptor");
+			ret_value->_errno = errno;
+			ret_value->_error = true;
+			ret = -1;
+			goto end;
+		}
+		break;
+	default:
+		break;
+	}
+
 	old_mask = umask(0);
 	ret = fct(data, ret_value);
 	saved_errno = ret_value->_errno;
@@ -898,8 +987,8 @@ end:
 }
 
 static
-int run_as_create_worker_no_lock(const char *procname,
-		post_fork_cleanup_cb clean_up_func,
+int run_as_create_worker_no_lock(struct run_as_worker_slot *slot,
+		const char *procname, post_fork_cleanup_cb clean_up_func,
 		void *clean_up_user_data)
 {
 	pid_t pid;
@@ -908,7 +997,7 @@ int run_as_create_worker_no_lock(const char *procname,
 	struct run_as_ret recvret;
 	struct run_as_worker *worker;
 
-	assert(!global_worker);
+	assert(!slot->worker);
 	if (!use_clone()) {
 		/*
 		 * Don't initialize a worker, all run_as tasks will be performed
@@ -960,7 +1049,8 @@ int run_as_create_worker_no_lock(const char *procname,
 
 		/*
 		 * Close all FDs aside from STDIN, STDOUT, STDERR and sockpair[1]
-		 * Sockpair[1] is used as a control channel with the master
+		 * Sockpair[1] is used as a control channel with the master. This
+		 * also closes the sockets of the workers forked before this one.
 		 */
 		for (i = 3; i < sysconf(_SC_OPEN_MAX); i++) {
 			if (i != worker->sockpair[1]) {
@@ -999,7 +1089,7 @@ int run_as_create_worker_no_lock(const char *procname,
 			ret = -1;
 			goto error_fork;
 		}
-		global_worker = worker;
+		slot->worker = worker;
 	}
 end:
 	return ret;
@@ -1023,9 +1113,9 @@ error_procname_alloc:
 }
 
 static
-void run_as_destroy_worker_no_lock(void)
+void run_as_destroy_worker_no_lock(struct run_as_worker_slot *slot)
 {
-	struct run_as_worker *worker = global_worker;
+	struct run_as_worker *worker = slot->worker;
 
 	DBG("Destroying run_as worker");
 	if (!worker) {
@@ -1064,44 +1154,86 @@ void run_as_destroy_worker_no_lock(void)
 	}
 	free(worker->procname);
 	free(worker);
-	global_worker = NULL;
+	slot->worker = NULL;
 }
 
 static
-int run_as_restart_worker(struct run_as_worker *worker)
+int run_as_restart_worker(struct run_as_worker_slot *slot)
 {
 	int ret = 0;
 	char *procname = NULL;
 
-	procname = worker->procname;
+	procname = strdup(slot->worker->procname);
+	if (!procname) {
+		ret = -1;
+		goto err;
+	}
 
 	/* Close socket to run_as worker process and clean up the zombie process */
-	run_as_destroy_worker_no_lock();
+	run_as_destroy_worker_no_lock(slot);
 
 	/* Create a new run_as worker process*/
-	ret = run_as_create_worker_no_lock(procname, NULL, NULL);
+	ret = run_as_create_worker_no_lock(slot, procname, NULL, NULL);
 	if (ret < 0 ) {
 		ERR("Restarting the worker process failed");
 		ret = -1;
 		goto err;
 	}
 err:
+	free(procname);
 	return ret;
 }
 
+/*
+ * Lock and return the slot of the worker that will execute `cmd`.
+ *
+ * The ELF commands always go to the first worker so that the binaries it
+ * has already parsed are reused. Other commands go to the first idle
+ * worker, or wait on a worker picked in turn if they are all busy.
+ */
+static
+struct run_as_worker_slot *run_as_get_worker_slot(enum run_as_cmd cmd)
+{
+	static unsigned int next_busy_slot;
+	struct run_as_worker_slot *slot;
+	int i;
+
+	switch (cmd) {
+	case RUN_AS_EXTRACT_ELF_SYMBOL_OFFSET:
+	case RUN_AS_EXTRACT_SDT_PROBE_OFFSETS:
+		slot = &worker_pool[0];
+		goto lock;
+	default:
+		break;
+	}
+
+	for (i = 0; i < DEFAULT_RUN_AS_WORKER_POOL_SIZE; i++) {
+		if (!pthread_mutex_trylock(&worker_pool[i].lock)) {
+			return &worker_pool[i];
+		}
+	}
+
+	slot = &worker_pool[uatomic_add_return(&next_busy_slot, 1) %
+			DEFAULT_RUN_AS_WORKER_POOL_SIZE];
+lock:
+	pthread_mutex_lock(&slot->lock);
+	return slot;
+}
+
 static
 int run_as(enum run_as_cmd cmd, struct run_as_data *data,
 		   struct run_as_ret *ret_value, uid_t uid, gid_t gid)
 {
 	int ret, saved_errno;
+	struct run_as_worker_slot *slot;
 
-	pthread_mutex_lock(&worker_lock);
 	if (use_clone()) {
 		DBG("Using run_as worker");
 
-		assert(global_worker);
+		slot = run_as_get_worker_slot(cmd);
+		assert(slot->worker);
 
-		ret = run_as_cmd(global_worker, cmd, data, ret_value, uid, gid);
+		ret = run_as_cmd(slot->worker, cmd, data, ret_value, uid, gid);
 		saved_errno = ret_value->_errno;
 
 		/*
@@ -1111,18 +1243,19 @@ int run_as(enum run_as_cmd cmd, struct run_as_data *data,
 		if (ret == -1 && saved_errno == EIO) {
 			DBG("Socket closed unexpectedly... "
 					"Restarting the worker process");
-			ret = run_as_restart_worker(global_worker);
+			ret = run_as_restart_worker(slot);
 			if (ret == -1) {
 				ERR("Failed to restart worker process.");
-				goto err;
 			}
 		}
+		pthread_mutex_unlock(&slot->lock);
 	} else {
 		DBG("Using run_as without worker");
+		/* The commands change the umask of the process. */
+		pthread_mutex_lock(&worker_pool[0].lock);
 		ret = run_as_noworker(cmd, data, ret_value, uid, gid);
+		pthread_mutex_unlock(&worker_pool[0].lock);
 	}
-err:
-	pthread_mutex_unlock(&worker_lock);
 	return ret;
 }
 
@@ -1201,6 +1334,13 @@ error:
 
 LTTNG_HIDDEN
 int run_as_open(const char *path, int flags, mode_t mode, uid_t uid, gid_t gid)
+{
+	return run_as_openat(AT_FDCWD, path, flags, mode, uid, gid);
+}
+
+LTTNG_HIDDEN
+int run_as_openat(int dirfd, const char *path, int flags, mode_t mode,
+		uid_t uid, gid_t gid)
 {
 	struct run_as_data data;
 	struct run_as_ret ret;
@@ -1208,13 +1348,16 @@ int run_as_open(const char *path, int flags, mode_t mode, uid_t uid, gid_t gid)
 	memset(&data, 0, sizeof(data));
 	memset(&ret, 0, sizeof(ret));
 
-	DBG3("open() %s with flags %X mode %d for uid %d and gid %d",
+	DBG3("openat() fd = %d%s, path = %s, flags = %X, mode = %d, uid = %d, gid = %d",
+			dirfd, dirfd == AT_FDCWD ? " (AT_FDCWD)" : "",
 			path, flags, (int) mode, (int) uid, (int) gid);
 	strncpy(data.u.open.path, path, PATH_MAX - 1);
 	data.u.open.path[PATH_MAX - 1] = '\0';
 	data.u.open.flags = flags;
 	data.u.open.mode = mode;
-	run_as(RUN_AS_OPEN, &data, &ret, uid, gid);
+	data.fd = dirfd;
+	run_as(dirfd == AT_FDCWD ? RUN_AS_OPEN : RUN_AS_OPENAT,
+			&data, &ret, uid, gid);
 	errno = ret._errno;
 	ret.u.open.ret = ret.fd;
 	return ret.u.open.ret;
@@ -1222,6 +1365,12 @@ int run_as_open(const char *path, int flags, mode_t mode, uid_t uid, gid_t gid)
 
 LTTNG_HIDDEN
 int run_as_unlink(const char *path, uid_t uid, gid_t gid)
+{
+	return run_as_unlinkat(AT_FDCWD, path, uid, gid);
+}
+
+LTTNG_HIDDEN
+int run_as_unlinkat(int dirfd, const char *path, uid_t uid, gid_t gid)
 {
 	struct run_as_data data;
 	struct run_as_ret ret;
@@ -1229,11 +1378,14 @@ int run_as_unlink(const char *path, uid_t uid, gid_t gid)
 	memset(&data, 0, sizeof(data));
 	memset(&ret, 0, sizeof(ret));
 
-	DBG3("unlink() %s with for uid %d and gid %d",
+	DBG3("unlinkat() fd = %d%s, path = %s, uid = %d, gid = %d",
+			dirfd, dirfd == AT_FDCWD ? " (AT_FDCWD)" : "",
 			path, (int) uid, (int) gid);
 	strncpy(data.u.unlink.path, path, PATH_MAX - 1);
 	data.u.unlink.path[PATH_MAX - 1] = '\0';
-	run_as(RUN_AS_UNLINK, &data, &ret, uid, gid);
+	data.fd = dirfd;
+	run_as(dirfd == AT_FDCWD ? RUN_AS_UNLINK : RUN_AS_UNLINKAT,
+			&data, &ret, uid, gid);
 	errno = ret._errno;
 	return ret.u.unlink.ret;
 }
@@ -1256,6 +1408,27 @@ int run_as_rmdir_recursive(const char *path, uid_t uid, gid_t gid)
 	return ret.u.rmdir_recursive.ret;
 }
 
+LTTNG_HIDDEN
+int run_as_rename(const char *old_path, const char *new_path,
+		uid_t uid, gid_t gid)
+{
+	struct run_as_data data;
+	struct run_as_ret ret;
+
+	memset(&data, 0, sizeof(data));
+	memset(&ret, 0, sizeof(ret));
+
+	DBG3("rename() %s to %s for uid %d and gid %d",
+			old_path, new_path, (int) uid, (int) gid);
+	strncpy(data.u.rename.old_path, old_path, PATH_MAX - 1);
+	data.u.rename.old_path[PATH_MAX - 1] = '\0';
+	strncpy(data.u.rename.new_path, new_path, PATH_MAX - 1);
+	data.u.rename.new_path[PATH_MAX - 1] = '\0';
+	run_as(RUN_AS_RENAME, &data, &ret, uid, gid);
+	errno = ret._errno;
+	return ret.u.rename.ret;
+}
+
 LTTNG_HIDDEN
 int run_as_extract_elf_symbol_offset(int fd, const char* function,
 		uid_t uid, gid_t gid, uint64_t *offset)
@@ -1334,19 +1507,32 @@ int run_as_create_worker(const char *procname,
 		post_fork_cleanup_cb clean_up_func,
 		void *clean_up_user_data)
 {
-	int ret;
+	int i, ret = 0;
 
-	pthread_mutex_lock(&worker_lock);
-	ret = run_as_create_worker_no_lock(procname, clean_up_func,
-			clean_up_user_data);
-	pthread_mutex_unlock(&worker_lock);
+	for (i = 0; i < DEFAULT_RUN_AS_WORKER_POOL_SIZE; i++) {
+		pthread_mutex_lock(&worker_pool[i].lock);
+		ret = run_as_create_worker_no_lock(&worker_pool[i], procname,
+				clean_up_func, clean_up_user_data);
+		pthread_mutex_unlock(&worker_pool[i].lock);
+		if (ret) {
+			goto error;
+		}
+	}
+	return 0;
+
+error:
+	run_as_destroy_worker();
 	return ret;
 }
 
 LTTNG_HIDDEN
 void run_as_destroy_worker(void)
 {
-	pthread_mutex_lock(&worker_lock);
-	run_as_destroy_worker_no_lock();
-	pthread_mutex_unlock(&worker_lock);
+	int i;
+
+	for (i = 0; i < DEFAULT_RUN_AS_WORKER_POOL_SIZE; i++) {
+		pthread_mutex_lock(&worker_pool[i].lock);
+		run_as_destroy_worker_no_lock(&worker_pool[i]);
+		pthread_mutex_unlock(&worker_pool[i].lock);
+	}
 }
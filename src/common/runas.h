@@ -51,10 +51,18 @@ int run_as_mkdirat(int dirfd, const char *path, mode_t mode,
 LTTNG_HIDDEN
 int run_as_open(const char *path, int flags, mode_t mode, uid_t uid, gid_t gid);
 LTTNG_HIDDEN
+int run_as_openat(int dirfd, const char *path, int flags, mode_t mode,
+		uid_t uid, gid_t gid);
+LTTNG_HIDDEN
 int run_as_unlink(const char *path, uid_t uid, gid_t gid);
 LTTNG_HIDDEN
+int run_as_unlinkat(int dirfd, const char *path, uid_t uid, gid_t gid);
+LTTNG_HIDDEN
 int run_as_rmdir_recursive(const char *path, uid_t uid, gid_t gid);
 LTTNG_HIDDEN
+int run_as_rename(const char *old_path, const char *new_path,
+		uid_t uid, gid_t gid);
+LTTNG_HIDDEN
 int run_as_extract_elf_symbol_offset(int fd, const char* function,
 		uid_t uid, gid_t gid, uint64_t *offset);
 LTTNG_HIDDEN
@@ -253,4 +253,43 @@ struct lttcomm_relayd_mkdir {
 	char path[];
 } LTTNG_PACKED;
 
+/*
+ * Live beacon: empty index telling that a stream had no data up to
+ * timestamp_end.
+ */
+struct lttcomm_relayd_beacon {
+	uint64_t relay_stream_id;
+	/* Sequence number of the last packet sent on the stream. */
+	uint64_t net_seq_num;
+	uint64_t timestamp_end;
+	uint64_t stream_id;
+} LTTNG_PACKED;
+
+struct lttcomm_relayd_beacons {
+	uint32_t count;
+	/* struct lttcomm_relayd_beacon */
+	char beacons[];
+} LTTNG_PACKED;
+
+struct lttcomm_relayd_stream_rotation_position {
+	uint64_t stream_id;
+	uint64_t rotate_at_seq_num;
+} LTTNG_PACKED;
+
+/*
+ * Rotation of a batch of data streams to the same new path, typically
+ * the streams of a channel.
+ */
+struct lttcomm_relayd_rotate_streams {
+	uint32_t stream_count;
+	uint64_t new_chunk_id;
+	/* Includes trailing NULL. */
+	uint32_t pathname_length;
+	/*
+	 * The new path name followed by stream_count
+	 * struct lttcomm_relayd_stream_rotation_position.
+	 */
+	char data[];
+} LTTNG_PACKED;
+
 #endif	/* _RELAYD_COMM */
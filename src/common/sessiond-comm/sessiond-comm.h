@@ -106,7 +106,8 @@ enum lttcomm_sessiond_command {
 	LTTNG_ROTATION_GET_INFO               = 46,
 	LTTNG_ROTATION_SET_SCHEDULE           = 47,
 	LTTNG_SESSION_LIST_ROTATION_SCHEDULES = 48,
-	LTTNG_CREATE_SESSION_EXT              = 49
+	LTTNG_CREATE_SESSION_EXT              = 49,
+	LTTNG_ENABLE_EVENT_BATCH              = 50,
 };
 
 enum lttcomm_relayd_command {
@@ -138,6 +139,10 @@ enum lttcomm_relayd_command {
 	RELAYD_ROTATE_PENDING               = 20,
 	/* Create a folder on the relayd FS (2.11+) */
 	RELAYD_MKDIR                        = 21,
+	/* Batch of live beacons of a channel (2.12+) */
+	RELAYD_SEND_BEACONS                 = 22,
+	/* Ask the relay to rotate a batch of data streams (2.12+) */
+	RELAYD_ROTATE_STREAMS               = 23,
 };
 
 /*
@@ -252,11 +257,44 @@ struct lttcomm_proto_ops {
 			size_t len, int flags);
 };
 
+/* Maximal number of events enabled by a LTTNG_ENABLE_EVENT_BATCH command. */
+#define LTTCOMM_ENABLE_EVENT_BATCH_MAX_COUNT	65536
+
+/*
+ * Event of a LTTNG_ENABLE_EVENT_BATCH command. The reply payload is an array
+ * of uint32_t holding the lttng_error_code of each event.
+ */
+struct lttcomm_event_batch_entry {
+	struct lttng_event event LTTNG_PACKED;
+	/* Length of following filter expression. */
+	uint32_t expression_len;
+	/* Length of following bytecode for filter. */
+	uint32_t bytecode_len;
+	/* Exclusion count (fixed-size strings). */
+	uint32_t exclusion_count;
+	/*
+	 * After this structure, the following variable-length items are
+	 * transmitted:
+	 * - char exclusion_names[LTTNG_SYMBOL_NAME_LEN][exclusion_count]
+	 * - char filter_expression[expression_len]
+	 * - unsigned char filter_bytecode[bytecode_len]
+	 */
+} LTTNG_PACKED;
+
+/*
+ * Keep the client connection open once the reply is sent; the client sends
+ * its next command on the same connection.
+ */
+#define LTTCOMM_SESSION_MSG_FLAG_KEEP_CONNECTION	(1U << 0)
+
 /*
  * Data structure received from lttng client to session daemon.
  */
 struct lttcomm_session_msg {
 	uint32_t cmd_type;	/* enum lttcomm_sessiond_command */
+	/* Echoed back by the session daemon in the reply. */
+	uint64_t correlation_id;
+	uint32_t flags;		/* LTTCOMM_SESSION_MSG_FLAG_* */
 	struct lttng_session session;
 	struct lttng_domain domain;
 	union {
@@ -294,6 +332,12 @@ struct lttcomm_session_msg {
 			 * - unsigned char filter_bytecode[bytecode_len]
 			 */
 		} LTTNG_PACKED disable;
+		/* Enable many events of a channel. */
+		struct {
+			char channel_name[LTTNG_SYMBOL_NAME_LEN];
+			/* Number of lttcomm_event_batch_entry following. */
+			uint32_t count;
+		} LTTNG_PACKED enable_batch;
 		/* Create channel */
 		struct {
 			struct lttng_channel chan LTTNG_PACKED;
@@ -445,6 +489,7 @@ struct lttcomm_lttng_msg {
 	uint32_t pid;		/* pid_t */
 	uint32_t cmd_header_size;
 	uint32_t data_size;
+	uint64_t correlation_id;	/* Of the command being replied to. */
 } LTTNG_PACKED;
 
 struct lttcomm_lttng_output_id {
@@ -638,6 +683,11 @@ struct lttcomm_consumer_msg {
 			uint32_t uid;
 			uint32_t gid;
 		} LTTNG_PACKED mkdir;
+		struct {
+			uint64_t session_id;
+			/* Consumed size triggering a rotation, 0 if disabled. */
+			uint64_t threshold;
+		} LTTNG_PACKED set_session_rotate_threshold;
 	} u;
 } LTTNG_PACKED;
 
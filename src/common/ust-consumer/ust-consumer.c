@@ -1092,6 +1092,7 @@ static int snapshot_channel(struct lttng_consumer_channel *channel,
 	unsigned use_relayd = 0;
 	unsigned long consumed_pos, produced_pos;
 	struct lttng_consumer_stream *stream;
+	struct lttng_directory_handle dir_handle;
 
 	assert(path);
 	assert(ctx);
@@ -1100,6 +1101,20 @@ static int snapshot_channel(struct lttng_consumer_channel *channel,
 
 	if (relayd_id != (uint64_t) -1ULL) {
 		use_relayd = 1;
+	} else {
+		const struct lttng_credentials creds = {
+			.uid = channel->uid,
+			.gid = channel->gid,
+		};
+
+		/* The files of all the streams are created in this directory. */
+		ret = lttng_directory_handle_init_as_user(&dir_handle, path,
+				&creds);
+		if (ret) {
+			ERR("Failed to open snapshot output directory %s", path);
+			rcu_read_unlock();
+			return ret;
+		}
 	}
 
 	assert(!channel->monitor);
@@ -1118,7 +1133,8 @@ static int snapshot_channel(struct lttng_consumer_channel *channel,
 				goto error_unlock;
 			}
 		} else {
-			ret = utils_create_stream_file(path, stream->name,
+			ret = utils_create_stream_file_at(&dir_handle,
+					stream->name,
 					stream->chan->tracefile_size,
 					stream->tracefile_count_current,
 					stream->uid, stream->gid, NULL);
@@ -1227,6 +1243,9 @@ static int snapshot_channel(struct lttng_consumer_channel *channel,
 		pthread_mutex_unlock(&stream->lock);
 	}
 
+	if (!use_relayd) {
+		lttng_directory_handle_fini(&dir_handle);
+	}
 	rcu_read_unlock();
 	return 0;
 
@@ -1238,6 +1257,9 @@ error_close_stream:
 	consumer_stream_close(stream);
 error_unlock:
 	pthread_mutex_unlock(&stream->lock);
+	if (!use_relayd) {
+		lttng_directory_handle_fini(&dir_handle);
+	}
 	rcu_read_unlock();
 	return ret;
 }
@@ -2109,6 +2131,26 @@ int lttng_ustconsumer_recv_cmd(struct lttng_consumer_local_data *ctx,
 		}
 		break;
 	}
+	case LTTNG_CONSUMER_SET_SESSION_ROTATE_THRESHOLD:
+	{
+		ret = lttng_consumer_set_session_rotate_threshold(
+				msg.u.set_session_rotate_threshold.session_id,
+				msg.u.set_session_rotate_threshold.threshold);
+		if (ret < 0) {
+			ERR("Failed to set the rotation threshold of session %" PRIu64,
+					msg.u.set_session_rotate_threshold.session_id);
+			ret_code = LTTCOMM_CONSUMERD_ENOMEM;
+		}
+
+		health_code_update();
+
+		ret = consumer_send_status_msg(sock, ret_code);
+		if (ret < 0) {
+			/* Somehow, the session daemon is not responding anymore. */
+			goto end_nosignal;
+		}
+		break;
+	}
 	default:
 		break;
 	}
@@ -2922,10 +2964,21 @@ int lttng_ustconsumer_on_recv_stream(struct lttng_consumer_stream *stream)
 
 	/* Don't create anything if this is set for streaming. */
 	if (stream->net_seq_idx == (uint64_t) -1ULL && stream->chan->monitor) {
-		ret = utils_create_stream_file(stream->chan->pathname, stream->name,
+		struct lttng_directory_handle *dir_handle;
+
+		pthread_mutex_lock(&stream->chan->output_dir_lock);
+		dir_handle = consumer_channel_get_output_dir_handle(
+				stream->chan);
+		if (!dir_handle) {
+			pthread_mutex_unlock(&stream->chan->output_dir_lock);
+			ret = -1;
+			goto error;
+		}
+		ret = utils_create_stream_file_at(dir_handle, stream->name,
 				stream->chan->tracefile_size, stream->tracefile_count_current,
 				stream->uid, stream->gid, NULL);
 		if (ret < 0) {
+			pthread_mutex_unlock(&stream->chan->output_dir_lock);
 			goto error;
 		}
 		stream->out_fd = ret;
@@ -2934,17 +2987,20 @@ int lttng_ustconsumer_on_recv_stream(struct lttng_consumer_stream *stream)
 		if (!stream->metadata_flag) {
 			struct lttng_index_file *index_file;
 
-			index_file = lttng_index_file_create(stream->chan->pathname,
+			index_file = lttng_index_file_create_from_handle(
+					dir_handle,
 					stream->name, stream->uid, stream->gid,
 					stream->chan->tracefile_size,
 					stream->tracefile_count_current,
 					CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
 			if (!index_file) {
+				pthread_mutex_unlock(&stream->chan->output_dir_lock);
 				goto error;
 			}
 			assert(!stream->index_file);
 			stream->index_file = index_file;
 		}
+		pthread_mutex_unlock(&stream->chan->output_dir_lock);
 	}
 	ret = 0;
 
@@ -717,7 +717,8 @@ int utils_mkdir_recursive(const char *path, mode_t mode, int uid, int gid)
 }
 
 /*
- * path is the output parameter. It needs to be PATH_MAX len.
+ * path is the output parameter. It needs to be PATH_MAX len. A NULL
+ * path_name yields the name of the file relative to its directory.
  *
  * Return 0 on success or else a negative value.
  */
@@ -731,8 +732,13 @@ static int utils_stream_file_name(char *path,
 	char *path_name_suffix = NULL;
 	char *extra = NULL;
 
-	ret = snprintf(full_path, sizeof(full_path), "%s/%s",
-			path_name, file_name);
+	if (path_name) {
+		ret = snprintf(full_path, sizeof(full_path), "%s/%s",
+				path_name, file_name);
+	} else {
+		ret = snprintf(full_path, sizeof(full_path), "%s",
+				file_name);
+	}
 	if (ret < 0) {
 		PERROR("snprintf create output file");
 		goto error;
@@ -818,6 +824,44 @@ error:
 	return ret;
 }
 
+/*
+ * Create the stream file in the directory of a handle. Creating the
+ * files of a stream through the handle of their directory spares a
+ * resolution of the full path for each of them.
+ *
+ * Return the file descriptor on success or else a negative value.
+ */
+LTTNG_HIDDEN
+int utils_create_stream_file_at(const struct lttng_directory_handle *dir_handle,
+		const char *file_name, uint64_t size, uint64_t count,
+		int uid, int gid, const char *suffix)
+{
+	int ret, flags, mode;
+	char path[PATH_MAX];
+	const struct lttng_credentials creds = {
+		.uid = (uid_t) uid,
+		.gid = (gid_t) gid,
+	};
+
+	ret = utils_stream_file_name(path, NULL, file_name,
+			size, count, suffix);
+	if (ret < 0) {
+		goto error;
+	}
+
+	/* Same flags and mode as utils_create_stream_file(). */
+	flags = O_RDWR | O_CREAT | O_TRUNC;
+	mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP;
+
+	ret = lttng_directory_handle_open_file_as_user(dir_handle, path,
+			flags, mode, (uid < 0 || gid < 0) ? NULL : &creds);
+	if (ret < 0) {
+		PERROR("open stream file %s", path);
+	}
+error:
+	return ret;
+}
+
 /*
  * Unlink the stream tracefile from disk.
  *
@@ -849,16 +893,40 @@ error:
 }
 
 /*
- * Change the output tracefile according to the given size and count The
- * new_count pointer is set during this operation.
- *
- * From the consumer, the stream lock MUST be held before calling this function
- * because we are modifying the stream status.
+ * Unlink the stream file from the directory of a handle.
  *
  * Return 0 on success or else a negative value.
  */
 LTTNG_HIDDEN
-int utils_rotate_stream_file(char *path_name, char *file_name, uint64_t size,
+int utils_unlink_stream_file_at(const struct lttng_directory_handle *dir_handle,
+		const char *file_name, uint64_t size, uint64_t count,
+		int uid, int gid, const char *suffix)
+{
+	int ret;
+	char path[PATH_MAX];
+	const struct lttng_credentials creds = {
+		.uid = (uid_t) uid,
+		.gid = (gid_t) gid,
+	};
+
+	ret = utils_stream_file_name(path, NULL, file_name,
+			size, count, suffix);
+	if (ret < 0) {
+		goto error;
+	}
+	ret = lttng_directory_handle_unlink_file_as_user(dir_handle, path,
+			(uid < 0 || gid < 0) ? NULL : &creds);
+error:
+	DBG("utils_unlink_stream_file_at %s returns %d", path, ret);
+	return ret;
+}
+
+/*
+ * Rotate a stream file, found either in the directory of a handle or, when
+ * dir_handle is NULL, in path_name.
+ */
+static int rotate_stream_file(const struct lttng_directory_handle *dir_handle,
+		char *path_name, char *file_name, uint64_t size,
 		uint64_t count, int uid, int gid, int out_fd, uint64_t *new_count,
 		int *stream_fd)
 {
@@ -890,8 +958,15 @@ int utils_rotate_stream_file(char *path_name, char *file_name, uint64_t size,
 		if (new_count) {
 			*new_count = (*new_count + 1) % count;
 		}
-		ret = utils_unlink_stream_file(path_name, file_name, size,
-				new_count ? *new_count : 0, uid, gid, 0);
+		if (dir_handle) {
+			ret = utils_unlink_stream_file_at(dir_handle, file_name,
+					size, new_count ? *new_count : 0,
+					uid, gid, NULL);
+		} else {
+			ret = utils_unlink_stream_file(path_name, file_name,
+					size, new_count ? *new_count : 0,
+					uid, gid, NULL);
+		}
 		if (ret < 0 && errno != ENOENT) {
 			goto error;
 		}
@@ -901,8 +976,13 @@ int utils_rotate_stream_file(char *path_name, char *file_name, uint64_t size,
 		}
 	}
 
-	ret = utils_create_stream_file(path_name, file_name, size,
-			new_count ? *new_count : 0, uid, gid, 0);
+	if (dir_handle) {
+		ret = utils_create_stream_file_at(dir_handle, file_name, size,
+				new_count ? *new_count : 0, uid, gid, NULL);
+	} else {
+		ret = utils_create_stream_file(path_name, file_name, size,
+				new_count ? *new_count : 0, uid, gid, NULL);
+	}
 	if (ret < 0) {
 		goto error;
 	}
@@ -915,6 +995,39 @@ error:
 	return ret;
 }
 
+/*
+ * Change the output tracefile according to the given size and count The
+ * new_count pointer is set during this operation.
+ *
+ * From the consumer, the stream lock MUST be held before calling this function
+ * because we are modifying the stream status.
+ *
+ * Return 0 on success or else a negative value.
+ */
+LTTNG_HIDDEN
+int utils_rotate_stream_file(char *path_name, char *file_name, uint64_t size,
+		uint64_t count, int uid, int gid, int out_fd, uint64_t *new_count,
+		int *stream_fd)
+{
+	return rotate_stream_file(NULL, path_name, file_name, size, count,
+			uid, gid, out_fd, new_count, stream_fd);
+}
+
+/*
+ * Same as utils_rotate_stream_file(), the tracefiles being in the
+ * directory of a handle.
+ *
+ * Return 0 on success or else a negative value.
+ */
+LTTNG_HIDDEN
+int utils_rotate_stream_file_at(const struct lttng_directory_handle *dir_handle,
+		const char *file_name, uint64_t size, uint64_t count,
+		int uid, int gid, int out_fd, uint64_t *new_count,
+		int *stream_fd)
+{
+	return rotate_stream_file(dir_handle, NULL, (char *) file_name, size,
+			count, uid, gid, out_fd, new_count, stream_fd);
+}
 
 /**
  * Parse a string that represents a size in human readable format. It
@@ -1712,3 +1825,29 @@ int utils_get_memory_total(size_t *value)
 {
 	return read_proc_meminfo_field(PROC_MEMINFO_MEMTOTAL_LINE, value);
 }
+
+/*
+ * Sleep before polling again for the completion of an operation, such as
+ * the availability of a session's data or the end of a rotation.
+ *
+ * Most operations complete quickly, so the first waits are short. The
+ * delay then doubles on every call, up to DEFAULT_DATA_AVAILABILITY_WAIT_TIME,
+ * so that long operations are not polled more often than before.
+ * delay_us keeps the state between calls and must initially be 0.
+ *
+ * Return the value returned by usleep(3).
+ */
+LTTNG_HIDDEN
+int utils_wait_before_retry(unsigned int *delay_us)
+{
+	assert(delay_us);
+
+	if (*delay_us == 0) {
+		*delay_us = DEFAULT_DATA_AVAILABILITY_MIN_WAIT_TIME;
+	} else if (*delay_us < DEFAULT_DATA_AVAILABILITY_WAIT_TIME) {
+		*delay_us = min_t(unsigned int, *delay_us * 2,
+				DEFAULT_DATA_AVAILABILITY_WAIT_TIME);
+	}
+
+	return usleep(*delay_us);
+}
@@ -51,6 +51,16 @@ int utils_unlink_stream_file(const char *path_name, char *file_name, uint64_t si
 int utils_rotate_stream_file(char *path_name, char *file_name, uint64_t size,
 		uint64_t count, int uid, int gid, int out_fd, uint64_t *new_count,
 		int *stream_fd);
+int utils_create_stream_file_at(const struct lttng_directory_handle *dir_handle,
+		const char *file_name, uint64_t size, uint64_t count,
+		int uid, int gid, const char *suffix);
+int utils_unlink_stream_file_at(const struct lttng_directory_handle *dir_handle,
+		const char *file_name, uint64_t size, uint64_t count,
+		int uid, int gid, const char *suffix);
+int utils_rotate_stream_file_at(const struct lttng_directory_handle *dir_handle,
+		const char *file_name, uint64_t size, uint64_t count,
+		int uid, int gid, int out_fd, uint64_t *new_count,
+		int *stream_fd);
 int utils_parse_size_suffix(char const * const str, uint64_t * const size);
 int utils_parse_time_suffix(char const * const str, uint64_t * const time_us);
 int utils_get_count_order_u32(uint32_t x);
@@ -67,5 +77,6 @@ int utils_truncate_stream_file(int fd, off_t length);
 int utils_show_help(int section, const char *page_name, const char *help_msg);
 int utils_get_memory_available(size_t *value);
 int utils_get_memory_total(size_t *value);
+int utils_wait_before_retry(unsigned int *delay_us);
 
 #endif /* _COMMON_UTILS_H */
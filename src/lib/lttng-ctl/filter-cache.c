@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2019 - The LTTng-tools authors
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License, version 2.1 only,
+ * as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#define _LGPL_SOURCE
+#include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <urcu/uatomic.h>
+
+#include <common/common.h>
+#include <common/hashtable/utils.h>
+
+#include "filter-cache.h"
+
+#define FILTER_CACHE_BUCKET_COUNT	256
+#define FILTER_CACHE_MAX_ENTRIES	4096
+
+struct filter_cache_entry {
+	struct filter_cache_entry *next;
+	/* Normalized filter expression. */
+	char *filter_expression;
+	unsigned long hash;
+	size_t bytecode_len;
+	struct lttng_filter_bytecode *bytecode;
+};
+
+/*
+ * Entries are never removed before the library is unloaded. Lookups only
+ * take the lock for reading and don't block each other.
+ */
+static struct {
+	pthread_rwlock_t lock;
+	struct filter_cache_entry *buckets[FILTER_CACHE_BUCKET_COUNT];
+	unsigned int entry_count;
+	unsigned long hits;
+	unsigned long misses;
+} filter_cache = {
+	.lock = PTHREAD_RWLOCK_INITIALIZER,
+};
+
+/* String literals are handled as constants. */
+static bool is_identifier_char(char c)
+{
+	return isalnum((unsigned char) c) || c == '_' || c == '$' || c == '.' ||
+			c == ':' || c == '"' || c == '\'';
+}
+
+/*
+ * Strip the white space of a filter expression that doesn't separate tokens
+ * of the same kind: white space between an identifier or a constant and an
+ * operator is dropped while white space between two identifiers or two
+ * operators, which could otherwise be read as a single token, is collapsed
+ * to a single space. String literals, and the escape sequences they contain,
+ * are kept as is.
+ */
+LTTNG_HIDDEN
+char *filter_cache_normalize_expression(const char *filter_expression)
+{
+	const char *in = filter_expression;
+	char *normalized, *out;
+	char quote = '\0';
+	bool pending_space = false;
+
+	normalized = zmalloc(strlen(filter_expression) + 1);
+	if (!normalized) {
+		goto end;
+	}
+
+	out = normalized;
+	for (; *in; in++) {
+		if (quote) {
+			*out++ = *in;
+			if (*in == '\\' && in[1]) {
+				*out++ = *++in;
+			} else if (*in == quote) {
+				quote = '\0';
+			}
+			continue;
+		}
+
+		if (isspace((unsigned char) *in)) {
+			pending_space = out != normalized;
+			continue;
+		}
+
+		if (pending_space && is_identifier_char(out[-1]) ==
+				is_identifier_char(*in)) {
+			*out++ = ' ';
+		}
+		pending_space = false;
+		if (*in == '"' || *in == '\'') {
+			quote = *in;
+		}
+		*out++ = *in;
+	}
+	*out = '\0';
+end:
+	return normalized;
+}
+
+static struct filter_cache_entry *find_entry(const char *filter_expression,
+		unsigned long hash)
+{
+	struct filter_cache_entry *entry;
+
+	for (entry = filter_cache.buckets[hash % FILTER_CACHE_BUCKET_COUNT];
+			entry; entry = entry->next) {
+		if (entry->hash == hash &&
+				!strcmp(entry->filter_expression,
+					filter_expression)) {
+			break;
+		}
+	}
+
+	return entry;
+}
+
+LTTNG_HIDDEN
+struct lttng_filter_bytecode *filter_cache_lookup(
+		const char *filter_expression)
+{
+	char *normalized;
+	unsigned long hash;
+	struct filter_cache_entry *entry;
+	struct lttng_filter_bytecode *bytecode = NULL;
+
+	normalized = filter_cache_normalize_expression(filter_expression);
+	if (!normalized) {
+		goto end;
+	}
+	hash = hash_key_str(normalized, 0);
+
+	pthread_rwlock_rdlock(&filter_cache.lock);
+	entry = find_entry(normalized, hash);
+	if (entry) {
+		bytecode = zmalloc(entry->bytecode_len);
+		if (bytecode) {
+			memcpy(bytecode, entry->bytecode, entry->bytecode_len);
+		}
+	}
+	pthread_rwlock_unlock(&filter_cache.lock);
+
+	if (entry) {
+		uatomic_inc(&filter_cache.hits);
+	} else {
+		uatomic_inc(&filter_cache.misses);
+	}
+end:
+	free(normalized);
+	return bytecode;
+}
+
+LTTNG_HIDDEN
+void filter_cache_add(const char *filter_expression,
+		const struct lttng_filter_bytecode *bytecode)
+{
+	struct filter_cache_entry *entry;
+	size_t bytecode_len = sizeof(*bytecode) + bytecode->len;
+
+	entry = zmalloc(sizeof(*entry));
+	if (!entry) {
+		goto error;
+	}
+
+	entry->filter_expression = filter_cache_normalize_expression(
+			filter_expression);
+	entry->bytecode = zmalloc(bytecode_len);
+	if (!entry->filter_expression || !entry->bytecode) {
+		goto error;
+	}
+	memcpy(entry->bytecode, bytecode, bytecode_len);
+	entry->bytecode_len = bytecode_len;
+	entry->hash = hash_key_str(entry->filter_expression, 0);
+
+	pthread_rwlock_wrlock(&filter_cache.lock);
+	if (filter_cache.entry_count >= FILTER_CACHE_MAX_ENTRIES ||
+			find_entry(entry->filter_expression, entry->hash)) {
+		/* Full or added concurrently. */
+		pthread_rwlock_unlock(&filter_cache.lock);
+		goto error;
+	}
+	entry->next = filter_cache.buckets[
+			entry->hash % FILTER_CACHE_BUCKET_COUNT];
+	filter_cache.buckets[entry->hash % FILTER_CACHE_BUCKET_COUNT] = entry;
+	filter_cache.entry_count++;
+	pthread_rwlock_unlock(&filter_cache.lock);
+	return;
+
+error:
+	if (entry) {
+		free(entry->filter_expression);
+		free(entry->bytecode);
+		free(entry);
+	}
+}
+
+static void __attribute__((destructor)) filter_cache_exit(void)
+{
+	int i;
+
+	DBG("Filter bytecode cache: %lu hits, %lu misses, %u entries",
+			uatomic_read(&filter_cache.hits),
+			uatomic_read(&filter_cache.misses),
+			filter_cache.entry_count);
+
+	for (i = 0; i < FILTER_CACHE_BUCKET_COUNT; i++) {
+		struct filter_cache_entry *entry, *next;
+
+		for (entry = filter_cache.buckets[i]; entry; entry = next) {
+			next = entry->next;
+			free(entry->filter_expression);
+			free(entry->bytecode);
+			free(entry);
+		}
+		filter_cache.buckets[i] = NULL;
+	}
+	filter_cache.entry_count = 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2019 - The LTTng-tools authors
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License, version 2.1 only,
+ * as published by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef LTTNG_CTL_FILTER_CACHE_H
+#define LTTNG_CTL_FILTER_CACHE_H
+
+#include <common/macros.h>
+#include <common/sessiond-comm/sessiond-comm.h>
+
+/*
+ * Process-wide cache of the bytecode compiled from filter expressions. The
+ * expressions are normalized before being used as keys so that white space
+ * which doesn't separate tokens is ignored.
+ */
+
+/*
+ * Return a copy of the bytecode cached for a filter expression, owned by the
+ * caller, or NULL if the expression is not cached.
+ */
+LTTNG_HIDDEN
+struct lttng_filter_bytecode *filter_cache_lookup(
+		const char *filter_expression);
+
+/*
+ * Cache a copy of the bytecode compiled from a filter expression. The cache
+ * is bounded: the bytecode is silently not cached once it is full.
+ */
+LTTNG_HIDDEN
+void filter_cache_add(const char *filter_expression,
+		const struct lttng_filter_bytecode *bytecode);
+
+/*
+ * Normalize a filter expression as done for the cache keys.
+ *
+ * Return a newly allocated string or NULL on error.
+ */
+LTTNG_HIDDEN
+char *filter_cache_normalize_expression(const char *filter_expression);
+
+#endif /* LTTNG_CTL_FILTER_CACHE_H */
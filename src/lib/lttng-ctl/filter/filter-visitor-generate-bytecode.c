@@ -811,6 +811,11 @@ void filter_bytecode_free(struct filter_parser_ctx *ctx)
 	}
 }
 
+/*
+ * Bytecode generated from a filter expression can be saved in session
+ * configurations: bump LTTNG_FILTER_BYTECODE_GENERATOR_VERSION (see
+ * common/filter.h) when changing it.
+ */
 LTTNG_HIDDEN
 int filter_visitor_bytecode_generate(struct filter_parser_ctx *ctx)
 {
@@ -23,7 +23,9 @@
 #define _LGPL_SOURCE
 #include <assert.h>
 #include <grp.h>
+#include <inttypes.h>
 #include <errno.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -50,6 +52,7 @@
 #include "filter/filter-parser.h"
 #include "filter/filter-bytecode.h"
 #include "filter/memstream.h"
+#include "filter-cache.h"
 #include "lttng-ctl-helper.h"
 
 #ifdef DEBUG
@@ -75,6 +78,14 @@ static char sessiond_sock_path[PATH_MAX];
 static char *tracing_group;
 static int connected;
 
+/*
+ * Nesting count of lttng_persistent_connection_open(): the connection to the
+ * session daemon is kept open across commands while it is not zero.
+ */
+static int persistent_connection;
+/* Identifies a command in the reply of the session daemon. */
+static uint64_t next_correlation_id;
+
 /* Global */
 
 /*
@@ -420,6 +431,25 @@ error:
 	return -1;
 }
 
+/*
+ * Check if the session daemon closed a connection kept open across commands.
+ * Nothing is expected from the session daemon between two commands, so any
+ * readiness of the socket means it hung up.
+ */
+static int is_sessiond_connection_closed(void)
+{
+	int ret;
+	struct pollfd pollfd = {
+		.fd = sessiond_socket,
+		.events = POLLIN,
+	};
+
+	ret = poll(&pollfd, 1, 0);
+	return ret != 0;
+}
+
+static int disconnect_sessiond(void);
+
 /*
  * Connect to the LTTng session daemon.
  *
@@ -431,7 +461,12 @@ static int connect_sessiond(void)
 
 	/* Don't try to connect if already connected. */
 	if (connected) {
-		return 0;
+		if (!persistent_connection ||
+				!is_sessiond_connection_closed()) {
+			return 0;
+		}
+		DBG("Session daemon closed the persistent connection, reconnecting");
+		disconnect_sessiond();
 	}
 
 	ret = set_session_daemon_path();
@@ -536,6 +571,8 @@ int lttng_ctl_ask_sessiond_fds_varlen(struct lttcomm_session_msg *lsm,
 	int ret;
 	size_t payload_len;
 	struct lttcomm_lttng_msg llm;
+	/* Only a connection left in a known state can be reused. */
+	int keep_connection = 0;
 
 	ret = connect_sessiond();
 	if (ret < 0) {
@@ -543,6 +580,11 @@ int lttng_ctl_ask_sessiond_fds_varlen(struct lttcomm_session_msg *lsm,
 		goto end;
 	}
 
+	lsm->correlation_id = ++next_correlation_id;
+	if (persistent_connection) {
+		lsm->flags |= LTTCOMM_SESSION_MSG_FLAG_KEEP_CONNECTION;
+	}
+
 	/* Send command to session daemon */
 	ret = send_session_msg(lsm);
 	if (ret < 0) {
@@ -570,8 +612,16 @@ int lttng_ctl_ask_sessiond_fds_varlen(struct lttcomm_session_msg *lsm,
 		goto end;
 	}
 
+	if (llm.correlation_id != lsm->correlation_id) {
+		ERR("Session daemon reply to command %" PRIu64 " received for command %" PRIu64,
+				llm.correlation_id, lsm->correlation_id);
+		ret = -LTTNG_ERR_FATAL;
+		goto end;
+	}
+
 	/* Check error code if OK */
 	if (llm.ret_code != LTTNG_OK) {
+		/* The session daemon closes the connection on error. */
 		ret = -llm.ret_code;
 		goto end;
 	}
@@ -591,9 +641,57 @@ int lttng_ctl_ask_sessiond_fds_varlen(struct lttcomm_session_msg *lsm,
 	}
 
 	ret = llm.data_size;
+	keep_connection = 1;
 
 end:
-	disconnect_sessiond();
+	if (!persistent_connection || !keep_connection) {
+		disconnect_sessiond();
+	}
+	return ret;
+}
+
+/*
+ * Keep the connection to the session daemon open across commands. Calls can be
+ * nested, the connection is kept until the matching number of
+ * lttng_persistent_connection_close() calls is made.
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+int lttng_persistent_connection_open(void)
+{
+	int ret;
+
+	persistent_connection++;
+	ret = connect_sessiond();
+	if (ret < 0) {
+		persistent_connection--;
+		ret = -LTTNG_ERR_NO_SESSIOND;
+	}
+
+	return ret;
+}
+
+/*
+ * Close the persistent connection to the session daemon once the outermost
+ * lttng_persistent_connection_open() call is matched.
+ *
+ * Return 0 on success else a negative LTTng error code.
+ */
+int lttng_persistent_connection_close(void)
+{
+	int ret = 0;
+
+	if (persistent_connection > 0) {
+		persistent_connection--;
+	}
+
+	if (!persistent_connection) {
+		ret = disconnect_sessiond();
+		if (ret < 0) {
+			ret = -LTTNG_ERR_FATAL;
+		}
+	}
+
 	return ret;
 }
 
@@ -689,6 +787,7 @@ static int _lttng_stop_tracing(const char *session_name, int wait)
 {
 	int ret, data_ret;
 	struct lttcomm_session_msg lsm;
+	unsigned int wait_delay_us = 0;
 
 	if (session_name == NULL) {
 		return -LTTNG_ERR_INVALID;
@@ -719,11 +818,11 @@ static int _lttng_stop_tracing(const char *session_name, int wait)
 		}
 
 		/*
-		 * Data sleep time before retrying (in usec). Don't sleep if the
-		 * call returned value indicates availability.
+		 * Wait before retrying. Don't sleep if the call returned value
+		 * indicates availability.
 		 */
 		if (data_ret) {
-			usleep(DEFAULT_DATA_AVAILABILITY_WAIT_TIME);
+			utils_wait_before_retry(&wait_delay_us);
 		}
 	} while (data_ret != 0);
 
@@ -932,21 +1031,19 @@ error:
 }
 
 /*
- * Generate the filter bytecode from a given filter expression string. Put the
- * newly allocated parser context in ctxp and populate the lsm object with the
- * expression len.
+ * Compile a filter expression string to bytecode and put the newly allocated
+ * parser context in ctxp.
  *
  * Return 0 on success else a LTTNG_ERR_* code and ctxp is untouched.
  */
-static int generate_filter(char *filter_expression,
-		struct lttcomm_session_msg *lsm, struct filter_parser_ctx **ctxp)
+static int compile_filter_bytecode(const char *filter_expression,
+		struct filter_parser_ctx **ctxp)
 {
 	int ret;
 	struct filter_parser_ctx *ctx = NULL;
 	FILE *fmem = NULL;
 
 	assert(filter_expression);
-	assert(lsm);
 	assert(ctxp);
 
 	/*
@@ -1023,6 +1120,13 @@ static int generate_filter(char *filter_expression,
 
 	dbg_printf("done\n");
 
+	/* Evaluate constant sub-expressions ahead of the tracer. */
+	ret = filter_visitor_ir_fold_constants(ctx);
+	if (ret) {
+		ret = -LTTNG_ERR_FILTER_INVAL;
+		goto parse_error;
+	}
+
 	dbg_printf("Generating bytecode... ");
 	fflush(stdout);
 	ret = filter_visitor_bytecode_generate(ctx);
@@ -1035,10 +1139,6 @@ static int generate_filter(char *filter_expression,
 	dbg_printf("Size of bytecode generated: %u bytes.\n",
 			bytecode_get_len(&ctx->bytecode->b));
 
-	lsm->u.enable.bytecode_len = sizeof(ctx->bytecode->b)
-		+ bytecode_get_len(&ctx->bytecode->b);
-	lsm->u.enable.expression_len = strlen(filter_expression) + 1;
-
 	/* No need to keep the memory stream. */
 	if (fclose(fmem) != 0) {
 		PERROR("fclose");
@@ -1058,6 +1158,88 @@ error:
 	return ret;
 }
 
+/*
+ * Length of a filter bytecode, header included.
+ */
+static uint32_t get_filter_bytecode_len(struct lttng_filter_bytecode *bytecode)
+{
+	return sizeof(*bytecode) + bytecode_get_len(bytecode);
+}
+
+/*
+ * Get the filter bytecode of a given filter expression string, from the
+ * filter cache or by compiling it. Put the newly allocated bytecode in
+ * bytecodep.
+ *
+ * Return 0 on success else a LTTNG_ERR_* code and bytecodep is untouched.
+ */
+static int generate_filter_bytecode(const char *filter_expression,
+		struct lttng_filter_bytecode **bytecodep)
+{
+	int ret;
+	uint32_t bytecode_len;
+	struct filter_parser_ctx *ctx = NULL;
+	struct lttng_filter_bytecode *bytecode;
+
+	assert(filter_expression);
+	assert(bytecodep);
+
+	bytecode = filter_cache_lookup(filter_expression);
+	if (bytecode) {
+		goto end;
+	}
+
+	ret = compile_filter_bytecode(filter_expression, &ctx);
+	if (ret) {
+		goto error;
+	}
+
+	bytecode_len = get_filter_bytecode_len(&ctx->bytecode->b);
+	bytecode = zmalloc(bytecode_len);
+	if (!bytecode) {
+		ret = -LTTNG_ERR_FILTER_NOMEM;
+		goto error;
+	}
+	memcpy(bytecode, &ctx->bytecode->b, bytecode_len);
+	filter_cache_add(filter_expression, bytecode);
+end:
+	*bytecodep = bytecode;
+	ret = 0;
+error:
+	if (ctx) {
+		filter_bytecode_free(ctx);
+		filter_ir_free(ctx);
+		filter_parser_ctx_free(ctx);
+	}
+	return ret;
+}
+
+/*
+ * Generate the filter bytecode from a given filter expression string. Put the
+ * newly allocated bytecode in bytecodep and populate the lsm object with the
+ * expression len.
+ *
+ * Return 0 on success else a LTTNG_ERR_* code and bytecodep is untouched.
+ */
+static int generate_filter(char *filter_expression,
+		struct lttcomm_session_msg *lsm,
+		struct lttng_filter_bytecode **bytecodep)
+{
+	int ret;
+
+	assert(lsm);
+
+	ret = generate_filter_bytecode(filter_expression, bytecodep);
+	if (ret) {
+		goto end;
+	}
+
+	lsm->u.enable.bytecode_len = get_filter_bytecode_len(*bytecodep);
+	lsm->u.enable.expression_len = strlen(filter_expression) + 1;
+end:
+	return ret;
+}
+
 /*
  * Enable event(s) for a channel, possibly with exclusions and a filter.
  * If no event name is specified, all events are enabled.
@@ -1076,7 +1258,7 @@ int lttng_enable_event_with_exclusions(struct lttng_handle *handle,
 	int ret = 0, i, fd_to_send = -1;
 	bool send_fd = false;
 	unsigned int free_filter_expression = 0;
-	struct filter_parser_ctx *ctx = NULL;
+	struct lttng_filter_bytecode *bytecode = NULL;
 
 	/*
 	 * We have either a filter or some exclusions, so we need to set up
@@ -1162,7 +1344,7 @@ int lttng_enable_event_with_exclusions(struct lttng_handle *handle,
 			}
 		}
 
-		ret = generate_filter(filter_expression, &lsm, &ctx);
+		ret = generate_filter(filter_expression, &lsm, &bytecode);
 		if (ret) {
 			goto filter_error;
 		}
@@ -1206,9 +1388,9 @@ int lttng_enable_event_with_exclusions(struct lttng_handle *handle,
 		}
 	}
 	/* Add filter bytecode next. */
-	if (ctx && lsm.u.enable.bytecode_len != 0) {
+	if (bytecode && lsm.u.enable.bytecode_len != 0) {
 		ret = lttng_dynamic_buffer_append(&send_buffer,
-				&ctx->bytecode->b, lsm.u.enable.bytecode_len);
+				bytecode, lsm.u.enable.bytecode_len);
 		if (ret) {
 			goto mem_error;
 		}
@@ -1246,11 +1428,7 @@ int lttng_enable_event_with_exclusions(struct lttng_handle *handle,
 			send_buffer.size, NULL, NULL, 0);
 
 mem_error:
-	if (filter_expression && ctx) {
-		filter_bytecode_free(ctx);
-		filter_ir_free(ctx);
-		filter_parser_ctx_free(ctx);
-	}
+	free(bytecode);
 filter_error:
 	if (free_filter_expression) {
 		/*
@@ -1273,6 +1451,337 @@ ask_sessiond:
 	return ret;
 }
 
+struct lttng_event_batch {
+	char session_name[LTTNG_NAME_MAX];
+	struct lttng_domain domain;
+	char channel_name[LTTNG_SYMBOL_NAME_LEN];
+	/*
+	 * Serialized struct lttcomm_event_batch_entry along with their
+	 * variable-length data, as sent to the session daemon.
+	 */
+	struct lttng_dynamic_buffer entries;
+	/* Offset (size_t) of each entry in the entries buffer. */
+	struct lttng_dynamic_buffer offsets;
+	/* Status of each event, set by lttng_enable_event_batch(). */
+	int *statuses;
+};
+
+struct lttng_event_batch *lttng_event_batch_create(
+		struct lttng_handle *handle, const char *channel_name)
+{
+	struct lttng_event_batch *batch = NULL;
+
+	if (!handle) {
+		goto end;
+	}
+
+	batch = zmalloc(sizeof(*batch));
+	if (!batch) {
+		goto end;
+	}
+
+	lttng_ctl_copy_string(batch->session_name, handle->session_name,
+			sizeof(batch->session_name));
+	lttng_ctl_copy_lttng_domain(&batch->domain, &handle->domain);
+	/* If no channel name, send empty string. */
+	lttng_ctl_copy_string(batch->channel_name,
+			channel_name ? channel_name : "",
+			sizeof(batch->channel_name));
+	lttng_dynamic_buffer_init(&batch->entries);
+	lttng_dynamic_buffer_init(&batch->offsets);
+end:
+	return batch;
+}
+
+void lttng_event_batch_destroy(struct lttng_event_batch *batch)
+{
+	if (!batch) {
+		return;
+	}
+
+	lttng_dynamic_buffer_reset(&batch->entries);
+	lttng_dynamic_buffer_reset(&batch->offsets);
+	free(batch->statuses);
+	free(batch);
+}
+
+int lttng_event_batch_get_count(const struct lttng_event_batch *batch)
+{
+	if (!batch) {
+		return -LTTNG_ERR_INVALID;
+	}
+
+	return batch->offsets.size / sizeof(size_t);
+}
+
+const char *lttng_event_batch_get_event_name(
+		const struct lttng_event_batch *batch, unsigned int index)
+{
+	const struct lttcomm_event_batch_entry *entry;
+
+	if (!batch ||
+			index >= (unsigned int) lttng_event_batch_get_count(batch)) {
+		return NULL;
+	}
+
+	entry = (const struct lttcomm_event_batch_entry *) (batch->entries.data +
+			((const size_t *) batch->offsets.data)[index]);
+	return entry->event.name;
+}
+
+/*
+ * Add an event to a batch. The filter expression is compiled unless its
+ * bytecode is provided.
+ */
+static int event_batch_add(struct lttng_event_batch *batch,
+		struct lttng_event *ev, const char *original_filter_expression,
+		const struct lttng_filter_bytecode *filter_bytecode,
+		int exclusion_count, char **exclusion_list)
+{
+	int ret, i;
+	size_t offset;
+	struct lttcomm_event_batch_entry entry;
+	struct lttng_filter_bytecode *bytecode = NULL;
+	char *agent_filter = NULL;
+	/*
+	 * Cast as non-const since we may replace the filter expression
+	 * by a dynamically allocated string. Otherwise, the original
+	 * string is not modified.
+	 */
+	char *filter_expression = (char *) original_filter_expression;
+
+	if (!batch || !ev || exclusion_count < 0 ||
+			ev->type == LTTNG_EVENT_USERSPACE_PROBE) {
+		ret = -LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	if (lttng_event_batch_get_count(batch) >=
+			LTTCOMM_ENABLE_EVENT_BATCH_MAX_COUNT) {
+		ret = -LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	/* Same corner-case as lttng_enable_event_with_exclusions(). */
+	if (filter_expression && filter_expression[0] == '\0') {
+		ret = -LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	for (i = 0; i < exclusion_count; i++) {
+		if (lttng_strnlen(exclusion_list[i], LTTNG_SYMBOL_NAME_LEN) ==
+				LTTNG_SYMBOL_NAME_LEN) {
+			/* Exclusion is not NULL-terminated. */
+			ret = -LTTNG_ERR_INVALID;
+			goto end;
+		}
+	}
+
+	memset(&entry, 0, sizeof(entry));
+	/* FIXME: copying non-packed struct to packed struct. */
+	memcpy(&entry.event, ev, sizeof(entry.event));
+	entry.event.extended.ptr = NULL;
+	if (entry.event.name[0] == '\0') {
+		/* Enable all events */
+		lttng_ctl_copy_string(entry.event.name, "*",
+				sizeof(entry.event.name));
+	}
+	entry.exclusion_count = exclusion_count;
+
+	if (batch->domain.type == LTTNG_DOMAIN_JUL ||
+			batch->domain.type == LTTNG_DOMAIN_LOG4J ||
+			batch->domain.type == LTTNG_DOMAIN_PYTHON) {
+		/*
+		 * With an agent filter, the original filter has been added to
+		 * it thus replace the filter expression.
+		 */
+		agent_filter = set_agent_filter(filter_expression, ev);
+		if (agent_filter) {
+			filter_expression = agent_filter;
+		}
+	}
+
+	if (filter_bytecode) {
+		uint32_t len;
+
+		/* The bytecode buffer may not be aligned. */
+		memcpy(&len, &filter_bytecode->len, sizeof(len));
+		entry.bytecode_len = sizeof(*filter_bytecode) + len;
+		entry.expression_len = strlen(filter_expression) + 1;
+	} else if (filter_expression) {
+		ret = generate_filter_bytecode(filter_expression, &bytecode);
+		if (ret) {
+			goto end;
+		}
+		filter_bytecode = bytecode;
+		entry.bytecode_len = get_filter_bytecode_len(bytecode);
+		entry.expression_len = strlen(filter_expression) + 1;
+	}
+
+	offset = batch->entries.size;
+	ret = lttng_dynamic_buffer_append(&batch->entries, &entry,
+			sizeof(entry));
+	if (ret) {
+		goto mem_error;
+	}
+	for (i = 0; i < exclusion_count; i++) {
+		ret = lttng_dynamic_buffer_append(&batch->entries,
+				exclusion_list[i], LTTNG_SYMBOL_NAME_LEN);
+		if (ret) {
+			goto mem_error;
+		}
+	}
+	if (filter_expression) {
+		ret = lttng_dynamic_buffer_append(&batch->entries,
+				filter_expression, entry.expression_len);
+		if (ret) {
+			goto mem_error;
+		}
+		ret = lttng_dynamic_buffer_append(&batch->entries,
+				filter_bytecode, entry.bytecode_len);
+		if (ret) {
+			goto mem_error;
+		}
+	}
+	ret = lttng_dynamic_buffer_append(&batch->offsets, &offset,
+			sizeof(offset));
+	if (ret) {
+		goto mem_error;
+	}
+
+	/* The statuses of a previous enable don't cover the new event. */
+	free(batch->statuses);
+	batch->statuses = NULL;
+	goto end;
+
+mem_error:
+	/* Drop the partially added entry. */
+	(void) lttng_dynamic_buffer_set_size(&batch->entries, offset);
+	ret = -LTTNG_ERR_NOMEM;
+end:
+	free(bytecode);
+	free(agent_filter);
+	return ret;
+}
+
+int lttng_event_batch_add(struct lttng_event_batch *batch,
+		struct lttng_event *ev, const char *filter_expression,
+		int exclusion_count, char **exclusion_list)
+{
+	return event_batch_add(batch, ev, filter_expression, NULL,
+			exclusion_count, exclusion_list);
+}
+
+int lttng_event_batch_add_with_filter_bytecode(
+		struct lttng_event_batch *batch, struct lttng_event *ev,
+		const char *filter_expression, const void *filter_bytecode,
+		size_t filter_bytecode_len, int exclusion_count,
+		char **exclusion_list)
+{
+	struct lttng_filter_bytecode bytecode_header;
+
+	if (!batch || !filter_expression || !filter_bytecode) {
+		return -LTTNG_ERR_INVALID;
+	}
+
+	/*
+	 * The filter of agent events is combined with their log level: the
+	 * bytecode of the expression alone does not apply.
+	 */
+	if (batch->domain.type != LTTNG_DOMAIN_KERNEL &&
+			batch->domain.type != LTTNG_DOMAIN_UST) {
+		return -LTTNG_ERR_INVALID;
+	}
+
+	if (filter_bytecode_len < sizeof(bytecode_header) ||
+			filter_bytecode_len - sizeof(bytecode_header) >
+				LTTNG_FILTER_MAX_LEN) {
+		return -LTTNG_ERR_FILTER_INVAL;
+	}
+
+	/* The bytecode buffer may not be aligned. */
+	memcpy(&bytecode_header, filter_bytecode, sizeof(bytecode_header));
+	if (bytecode_header.len !=
+			filter_bytecode_len - sizeof(bytecode_header) ||
+			bytecode_header.reloc_table_offset >
+				bytecode_header.len) {
+		return -LTTNG_ERR_FILTER_INVAL;
+	}
+
+	return event_batch_add(batch, ev, filter_expression,
+			filter_bytecode, exclusion_count, exclusion_list);
+}
+
+int lttng_enable_event_batch(struct lttng_event_batch *batch)
+{
+	int ret, i, count;
+	struct lttcomm_session_msg lsm;
+	uint32_t *ret_codes = NULL;
+	int *statuses = NULL;
+
+	if (!batch) {
+		ret = -LTTNG_ERR_INVALID;
+		goto end;
+	}
+
+	count = lttng_event_batch_get_count(batch);
+	if (count == 0) {
+		ret = 0;
+		goto end;
+	}
+
+	statuses = zmalloc(count * sizeof(*statuses));
+	if (!statuses) {
+		ret = -LTTNG_ERR_NOMEM;
+		goto end;
+	}
+
+	memset(&lsm, 0, sizeof(lsm));
+	lsm.cmd_type = LTTNG_ENABLE_EVENT_BATCH;
+	lttng_ctl_copy_string(lsm.session.name, batch->session_name,
+			sizeof(lsm.session.name));
+	lttng_ctl_copy_lttng_domain(&lsm.domain, &batch->domain);
+	lttng_ctl_copy_string(lsm.u.enable_batch.channel_name,
+			batch->channel_name,
+			sizeof(lsm.u.enable_batch.channel_name));
+	lsm.u.enable_batch.count = count;
+
+	ret = lttng_ctl_ask_sessiond_varlen_no_cmd_header(&lsm,
+			batch->entries.data, batch->entries.size,
+			(void **) &ret_codes);
+	if (ret < 0) {
+		goto end;
+	}
+	if ((size_t) ret != count * sizeof(*ret_codes)) {
+		ret = -LTTNG_ERR_UNK;
+		goto end;
+	}
+
+	for (i = 0; i < count; i++) {
+		statuses[i] = ret_codes[i] == LTTNG_OK ?
+				0 : -((int) ret_codes[i]);
+	}
+	free(batch->statuses);
+	batch->statuses = statuses;
+	statuses = NULL;
+	ret = 0;
+end:
+	free(ret_codes);
+	free(statuses);
+	return ret;
+}
+
+int lttng_event_batch_get_status(const struct lttng_event_batch *batch,
+		unsigned int index)
+{
+	if (!batch || !batch->statuses ||
+			index >= (unsigned int) lttng_event_batch_get_count(batch)) {
+		return -LTTNG_ERR_INVALID;
+	}
+
+	return batch->statuses[index];
+}
+
 int lttng_disable_event_ext(struct lttng_handle *handle,
 		struct lttng_event *ev, const char *channel_name,
 		const char *original_filter_expression)
@@ -1281,7 +1790,7 @@ int lttng_disable_event_ext(struct lttng_handle *handle,
 	char *varlen_data;
 	int ret = 0;
 	unsigned int free_filter_expression = 0;
-	struct filter_parser_ctx *ctx = NULL;
+	struct lttng_filter_bytecode *bytecode = NULL;
 	/*
 	 * Cast as non-const since we may replace the filter expression
 	 * by a dynamically allocated string. Otherwise, the original
@@ -1372,7 +1881,7 @@ int lttng_disable_event_ext(struct lttng_handle *handle,
 			}
 		}
 
-		ret = generate_filter(filter_expression, &lsm, &ctx);
+		ret = generate_filter(filter_expression, &lsm, &bytecode);
 		if (ret) {
 			goto filter_error;
 		}
@@ -1392,10 +1901,10 @@ int lttng_disable_event_ext(struct lttng_handle *handle,
 			lsm.u.disable.expression_len);
 	}
 	/* Add filter bytecode next. */
-	if (ctx && lsm.u.disable.bytecode_len != 0) {
+	if (bytecode && lsm.u.disable.bytecode_len != 0) {
 		memcpy(varlen_data
 			+ lsm.u.disable.expression_len,
-			&ctx->bytecode->b,
+			bytecode,
 			lsm.u.disable.bytecode_len);
 	}
 
@@ -1404,11 +1913,7 @@ int lttng_disable_event_ext(struct lttng_handle *handle,
 	free(varlen_data);
 
 mem_error:
-	if (filter_expression && ctx) {
-		filter_bytecode_free(ctx);
-		filter_ir_free(ctx);
-		filter_parser_ctx_free(ctx);
-	}
+	free(bytecode);
 filter_error:
 	if (free_filter_expression) {
 		/*
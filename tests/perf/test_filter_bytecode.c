@@ -0,0 +1,892 @@
+/*
+ * Copyright (C) 2019 - The LTTng-tools authors
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License, version 2 only, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Filter bytecode benchmark.
+ *
+ * Each filter expression is compiled through the same pipeline as
+ * liblttng-ctl and the resulting bytecode is run by a reference
+ * interpreter over a set of synthetic events. The result of every
+ * evaluation is checked against the same expression written in C, and
+ * the size of the bytecode is checked against a budget so that
+ * regressions in the generator are caught.
+ *
+ * The number of ops and the time spent per event are reported as TAP
+ * diagnostics. The following environment variables control the run:
+ *
+ *   FILTER_BENCH_ITER: number of passes over the events (default 200),
+ *   FILTER_BENCH_MAX_NS: when set, fail any expression which takes more
+ *                        than this many nanoseconds per event.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <common/error.h>
+#include <tap/tap.h>
+
+#include "filter-ast.h"
+#include "filter-bytecode.h"
+#include "memstream.h"
+
+/* For error.h */
+int lttng_opt_quiet = 1;
+int lttng_opt_verbose;
+int lttng_opt_mi;
+
+#define NR_EVENTS		1024
+#define DEFAULT_NR_ITER		200
+#define INTERPRETER_STACK_LEN	16
+
+enum value_type {
+	VALUE_S64,
+	VALUE_DOUBLE,
+	VALUE_STRING,
+	VALUE_STRING_LITERAL,
+	VALUE_STAR_GLOB_STRING,
+};
+
+struct value {
+	enum value_type type;
+	union {
+		int64_t s64;
+		double d;
+		const char *str;
+	} u;
+};
+
+/* Synthetic event payload and context. */
+struct bench_event {
+	int64_t intfield;
+	int64_t longfield;
+	double floatfield;
+	const char *stringfield;
+	int64_t vpid;
+	const char *procname;
+};
+
+struct bench_field {
+	const char *name;
+	enum value_type type;
+	size_t offset;
+};
+
+static const struct bench_field bench_fields[] = {
+	{ "intfield", VALUE_S64, offsetof(struct bench_event, intfield) },
+	{ "longfield", VALUE_S64, offsetof(struct bench_event, longfield) },
+	{ "floatfield", VALUE_DOUBLE, offsetof(struct bench_event, floatfield) },
+	{ "stringfield", VALUE_STRING, offsetof(struct bench_event, stringfield) },
+	{ "$ctx.vpid", VALUE_S64, offsetof(struct bench_event, vpid) },
+	{ "$ctx.procname", VALUE_STRING, offsetof(struct bench_event, procname) },
+};
+
+#define NR_BENCH_FIELDS	(sizeof(bench_fields) / sizeof(bench_fields[0]))
+
+static const char *bench_strings[] = {
+	"hello", "test", "testing", "tester42", "world",
+};
+
+static const char *bench_procnames[] = {
+	"lttng-sessiond", "bash", "test-app",
+};
+
+static struct bench_event bench_events[NR_EVENTS];
+
+static bool expect_eq(const struct bench_event *ev)
+{
+	return ev->intfield == 42;
+}
+
+static bool expect_range(const struct bench_event *ev)
+{
+	return ev->intfield > 10 && ev->intfield < 20;
+}
+
+static bool expect_set(const struct bench_event *ev)
+{
+	return ev->intfield == 1 || ev->intfield == 2 || ev->intfield == 3;
+}
+
+static bool expect_glob(const struct bench_event *ev)
+{
+	return strncmp(ev->stringfield, "test", 4) == 0;
+}
+
+static bool expect_star_glob(const struct bench_event *ev)
+{
+	size_t len = strlen(ev->stringfield);
+
+	return len >= 2 && strcmp(ev->stringfield + len - 2, "42") == 0;
+}
+
+static bool expect_string_and_float(const struct bench_event *ev)
+{
+	return strcmp(ev->stringfield, "hello") == 0 && ev->floatfield > 1.5;
+}
+
+static bool expect_context(const struct bench_event *ev)
+{
+	return ev->vpid == 1000 || !(ev->intfield & 0x1);
+}
+
+static bool expect_shift(const struct bench_event *ev)
+{
+	return (ev->intfield >> 2) == 3;
+}
+
+static bool expect_constant_folding(const struct bench_event *ev)
+{
+	return ev->longfield > -1;
+}
+
+static bool expect_procname(const struct bench_event *ev)
+{
+	return strcmp(ev->procname, "bash") != 0 && ev->intfield <= 4;
+}
+
+static bool expect_logical_result(const struct bench_event *ev)
+{
+	return ev->intfield != 0 || ev->longfield == 1;
+}
+
+static bool expect_never(const struct bench_event *ev)
+{
+	return false;
+}
+
+static bool expect_always(const struct bench_event *ev)
+{
+	return true;
+}
+
+struct filter_case {
+	const char *expression;
+	/*
+	 * Bytecode size budget, relocation table included. Update it when
+	 * the generator gets better.
+	 */
+	uint32_t max_len;
+	bool (*expected)(const struct bench_event *ev);
+};
+
+static const struct filter_case filter_cases[] = {
+	{ "intfield == 42", 25, expect_eq },
+	{ "intfield > 10 && intfield < 20", 52, expect_range },
+	{ "intfield == 1 || intfield == 2 || intfield == 3", 79, expect_set },
+	{ "stringfield == \"test*\"", 26, expect_glob },
+	{ "stringfield == \"*42\"", 24, expect_star_glob },
+	{ "stringfield == \"hello\" && floatfield > 1.5", 55, expect_string_and_float },
+	{ "$ctx.vpid == 1000 || !(intfield & 0x1)", 54, expect_context },
+	{ "(intfield >> 2) == 3", 35, expect_shift },
+	{ "1 && longfield > -(1)", 26, expect_constant_folding },
+	{ "$ctx.procname != \"bash\" && intfield <= 4", 54, expect_procname },
+	/* Logical operators evaluate to 0 or 1 when they short-circuit. */
+	{ "(intfield || longfield) == 1", 45, expect_logical_result },
+	{ "(2 || intfield) == 2", 10, expect_never },
+	{ "(3 && 5) == 5", 10, expect_always },
+};
+
+#define NR_FILTER_CASES	(sizeof(filter_cases) / sizeof(filter_cases[0]))
+
+/* Number of TAP tests per filter case, excluding the optional timing check. */
+#define NR_TESTS_PER_CASE	3
+
+/*
+ * Same passes, in the same order, as the expression compilation done by
+ * liblttng-ctl.
+ */
+static struct filter_parser_ctx *compile_filter(const char *expression)
+{
+	int ret;
+	struct filter_parser_ctx *ctx = NULL;
+	FILE *fmem;
+
+	fmem = lttng_fmemopen((void *) expression, strlen(expression), "r");
+	if (!fmem) {
+		return NULL;
+	}
+	ctx = filter_parser_ctx_alloc(fmem);
+	if (!ctx) {
+		goto end;
+	}
+	ret = filter_parser_ctx_append_ast(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_generate(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_check_binary_op_nesting(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_normalize_glob_patterns(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_validate_string(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_validate_globbing(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_fold_constants(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_bytecode_generate(ctx);
+	if (ret) {
+		goto error;
+	}
+	goto end;
+
+error:
+	filter_ir_free(ctx);
+	filter_parser_ctx_free(ctx);
+	ctx = NULL;
+end:
+	fclose(fmem);
+	return ctx;
+}
+
+static void free_filter(struct filter_parser_ctx *ctx)
+{
+	filter_bytecode_free(ctx);
+	filter_ir_free(ctx);
+	filter_parser_ctx_free(ctx);
+}
+
+static int find_field(const char *name)
+{
+	unsigned int i;
+
+	for (i = 0; i < NR_BENCH_FIELDS; i++) {
+		if (!strcmp(bench_fields[i].name, name)) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Return a copy of the instructions with every field reference resolved
+ * to an index in bench_fields, the way the tracer links field references
+ * to their offset in the event payload.
+ */
+static char *link_bytecode(const struct lttng_filter_bytecode *bytecode)
+{
+	char *insns;
+	uint32_t offset = bytecode->reloc_table_offset;
+
+	insns = malloc(bytecode->reloc_table_offset);
+	if (!insns) {
+		return NULL;
+	}
+	memcpy(insns, bytecode->data, bytecode->reloc_table_offset);
+
+	while (offset < bytecode->len) {
+		uint16_t insn_offset;
+		const char *name;
+		struct field_ref ref;
+		int field;
+
+		memcpy(&insn_offset, bytecode->data + offset,
+				sizeof(insn_offset));
+		name = bytecode->data + offset + sizeof(insn_offset);
+		offset += sizeof(insn_offset) + strlen(name) + 1;
+
+		switch ((filter_opcode_t) insns[insn_offset]) {
+		case FILTER_OP_LOAD_FIELD_REF:
+		case FILTER_OP_GET_CONTEXT_REF:
+			break;
+		default:
+			diag("Unsupported relocation for symbol `%s`", name);
+			goto error;
+		}
+		field = find_field(name);
+		if (field < 0) {
+			diag("Unknown field `%s`", name);
+			goto error;
+		}
+		ref.offset = (uint16_t) field;
+		memcpy(insns + insn_offset + sizeof(struct load_op), &ref,
+				sizeof(ref));
+	}
+	return insns;
+
+error:
+	free(insns);
+	return NULL;
+}
+
+/* Star-only globbing, '\' escapes the next character. */
+static bool star_glob_match(const char *pattern, const char *str)
+{
+	for (;;) {
+		switch (*pattern) {
+		case '\0':
+			return *str == '\0';
+		case '*':
+			pattern++;
+			do {
+				if (star_glob_match(pattern, str)) {
+					return true;
+				}
+			} while (*str++ != '\0');
+			return false;
+		case '\\':
+			pattern++;
+			if (*pattern == '\0') {
+				return false;
+			}
+			/* Fall-through. */
+		default:
+			if (*pattern != *str) {
+				return false;
+			}
+			pattern++;
+			str++;
+		}
+	}
+}
+
+/*
+ * Plain string literals keep the legacy semantics of the tracer: a '*'
+ * matches any suffix and '\' escapes the next character.
+ */
+static int legacy_strcmp(const struct value *l, const struct value *r)
+{
+	const char *p = l->u.str, *q = r->u.str;
+	bool p_literal = l->type == VALUE_STRING_LITERAL;
+	bool q_literal = r->type == VALUE_STRING_LITERAL;
+
+	for (;;) {
+		if ((p_literal && *p == '*') || (q_literal && *q == '*')) {
+			return 0;
+		}
+		if (p_literal && *p == '\\') {
+			p++;
+		}
+		if (q_literal && *q == '\\') {
+			q++;
+		}
+		if (*p != *q || *p == '\0') {
+			return (unsigned char) *p - (unsigned char) *q;
+		}
+		p++;
+		q++;
+	}
+}
+
+static bool is_string(const struct value *v)
+{
+	return v->type == VALUE_STRING || v->type == VALUE_STRING_LITERAL;
+}
+
+static int compare_values(filter_opcode_t op, const struct value *l,
+		const struct value *r, int64_t *result)
+{
+	int cmp;
+
+	if (l->type == VALUE_STAR_GLOB_STRING || r->type == VALUE_STAR_GLOB_STRING) {
+		const struct value *pattern = l->type == VALUE_STAR_GLOB_STRING ? l : r;
+		const struct value *str = pattern == l ? r : l;
+		bool match;
+
+		if (!is_string(str)) {
+			return -1;
+		}
+		match = star_glob_match(pattern->u.str, str->u.str);
+		switch (op) {
+		case FILTER_OP_EQ:
+			*result = match;
+			return 0;
+		case FILTER_OP_NE:
+			*result = !match;
+			return 0;
+		default:
+			return -1;
+		}
+	}
+
+	if (is_string(l) || is_string(r)) {
+		if (!is_string(l) || !is_string(r)) {
+			return -1;
+		}
+		cmp = legacy_strcmp(l, r);
+	} else if (l->type == VALUE_S64 && r->type == VALUE_S64) {
+		cmp = (l->u.s64 > r->u.s64) - (l->u.s64 < r->u.s64);
+	} else {
+		double ld = l->type == VALUE_S64 ? (double) l->u.s64 : l->u.d;
+		double rd = r->type == VALUE_S64 ? (double) r->u.s64 : r->u.d;
+
+		cmp = (ld > rd) - (ld < rd);
+	}
+
+	switch (op) {
+	case FILTER_OP_EQ:
+		*result = cmp == 0;
+		break;
+	case FILTER_OP_NE:
+		*result = cmp != 0;
+		break;
+	case FILTER_OP_GT:
+		*result = cmp > 0;
+		break;
+	case FILTER_OP_LT:
+		*result = cmp < 0;
+		break;
+	case FILTER_OP_GE:
+		*result = cmp >= 0;
+		break;
+	case FILTER_OP_LE:
+		*result = cmp <= 0;
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+static int bitwise_values(filter_opcode_t op, const struct value *l,
+		const struct value *r, int64_t *result)
+{
+	uint64_t lv, rv;
+
+	if (l->type != VALUE_S64 || r->type != VALUE_S64) {
+		return -1;
+	}
+	lv = (uint64_t) l->u.s64;
+	rv = (uint64_t) r->u.s64;
+
+	switch (op) {
+	case FILTER_OP_BIT_RSHIFT:
+		if (r->u.s64 < 0 || r->u.s64 >= 64) {
+			return -1;
+		}
+		*result = (int64_t) (lv >> rv);
+		break;
+	case FILTER_OP_BIT_LSHIFT:
+		if (r->u.s64 < 0 || r->u.s64 >= 64) {
+			return -1;
+		}
+		*result = (int64_t) (lv << rv);
+		break;
+	case FILTER_OP_BIT_AND:
+		*result = (int64_t) (lv & rv);
+		break;
+	case FILTER_OP_BIT_OR:
+		*result = (int64_t) (lv | rv);
+		break;
+	case FILTER_OP_BIT_XOR:
+		*result = (int64_t) (lv ^ rv);
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+static void load_field(const struct bench_event *ev, uint16_t index,
+		struct value *value)
+{
+	const struct bench_field *field = &bench_fields[index];
+	const char *p = (const char *) ev + field->offset;
+
+	value->type = field->type;
+	switch (field->type) {
+	case VALUE_S64:
+		memcpy(&value->u.s64, p, sizeof(value->u.s64));
+		break;
+	case VALUE_DOUBLE:
+		memcpy(&value->u.d, p, sizeof(value->u.d));
+		break;
+	default:
+		memcpy(&value->u.str, p, sizeof(value->u.str));
+		break;
+	}
+}
+
+/*
+ * Reference interpreter for the instructions emitted by the bytecode
+ * generator. The typed stack is a simplified model of the tracer's
+ * register stack, and the logical operators short-circuit the same
+ * way: the result is 0 when AND short-circuits and 1 when OR does.
+ *
+ * Returns 0 and sets *record on success, -1 if the bytecode is
+ * rejected, in which case the tracer would discard the event.
+ */
+static int interpret(const char *insns, uint32_t len,
+		const struct bench_event *ev, bool *record,
+		unsigned long *nr_ops)
+{
+	struct value stack[INTERPRETER_STACK_LEN];
+	int top = -1;
+	uint32_t pc = 0;
+	unsigned long ops = 0;
+	int ret = -1;
+
+	while (pc < len) {
+		filter_opcode_t op = (filter_opcode_t) insns[pc];
+		const struct load_op *load = (const struct load_op *) &insns[pc];
+
+		ops++;
+		switch (op) {
+		case FILTER_OP_RETURN:
+			if (top < 0 || stack[top].type != VALUE_S64) {
+				goto end;
+			}
+			*record = stack[top].u.s64 != 0;
+			ret = 0;
+			goto end;
+
+		case FILTER_OP_EQ:
+		case FILTER_OP_NE:
+		case FILTER_OP_GT:
+		case FILTER_OP_LT:
+		case FILTER_OP_GE:
+		case FILTER_OP_LE:
+		case FILTER_OP_BIT_RSHIFT:
+		case FILTER_OP_BIT_LSHIFT:
+		case FILTER_OP_BIT_AND:
+		case FILTER_OP_BIT_OR:
+		case FILTER_OP_BIT_XOR:
+		{
+			int64_t result;
+
+			if (top < 1) {
+				goto end;
+			}
+			if (op >= FILTER_OP_EQ) {
+				ret = compare_values(op, &stack[top - 1],
+						&stack[top], &result);
+			} else {
+				ret = bitwise_values(op, &stack[top - 1],
+						&stack[top], &result);
+			}
+			if (ret) {
+				goto end;
+			}
+			ret = -1;
+			top--;
+			stack[top].type = VALUE_S64;
+			stack[top].u.s64 = result;
+			pc += sizeof(struct binary_op);
+			break;
+		}
+
+		case FILTER_OP_UNARY_PLUS:
+		case FILTER_OP_UNARY_MINUS:
+		case FILTER_OP_UNARY_NOT:
+		case FILTER_OP_UNARY_BIT_NOT:
+		{
+			struct value *v;
+
+			if (top < 0) {
+				goto end;
+			}
+			v = &stack[top];
+			if (v->type == VALUE_S64) {
+				if (op == FILTER_OP_UNARY_MINUS) {
+					v->u.s64 = (int64_t) -(uint64_t) v->u.s64;
+				} else if (op == FILTER_OP_UNARY_NOT) {
+					v->u.s64 = !v->u.s64;
+				} else if (op == FILTER_OP_UNARY_BIT_NOT) {
+					v->u.s64 = (int64_t) ~(uint64_t) v->u.s64;
+				}
+			} else if (v->type == VALUE_DOUBLE) {
+				if (op == FILTER_OP_UNARY_MINUS) {
+					v->u.d = -v->u.d;
+				} else if (op == FILTER_OP_UNARY_NOT) {
+					v->type = VALUE_S64;
+					v->u.s64 = v->u.d == 0.0;
+				} else if (op == FILTER_OP_UNARY_BIT_NOT) {
+					goto end;
+				}
+			} else {
+				goto end;
+			}
+			pc += sizeof(struct unary_op);
+			break;
+		}
+
+		case FILTER_OP_AND:
+		case FILTER_OP_OR:
+		{
+			const struct logical_op *insn =
+				(const struct logical_op *) &insns[pc];
+			uint16_t skip_offset;
+			bool short_circuit;
+
+			if (top < 0 || stack[top].type != VALUE_S64) {
+				goto end;
+			}
+			memcpy(&skip_offset, &insn->skip_offset,
+					sizeof(skip_offset));
+			if (op == FILTER_OP_AND) {
+				short_circuit = stack[top].u.s64 == 0;
+			} else {
+				short_circuit = stack[top].u.s64 != 0;
+			}
+			if (short_circuit) {
+				if (skip_offset <= pc) {
+					goto end;
+				}
+				if (op == FILTER_OP_OR) {
+					stack[top].u.s64 = 1;
+				}
+				pc = skip_offset;
+			} else {
+				top--;
+				pc += sizeof(struct logical_op);
+			}
+			break;
+		}
+
+		case FILTER_OP_LOAD_FIELD_REF:
+		case FILTER_OP_GET_CONTEXT_REF:
+		{
+			struct field_ref ref;
+
+			if (top + 1 >= INTERPRETER_STACK_LEN) {
+				goto end;
+			}
+			memcpy(&ref, load->data, sizeof(ref));
+			load_field(ev, ref.offset, &stack[++top]);
+			pc += sizeof(struct load_op) + sizeof(struct field_ref);
+			break;
+		}
+
+		case FILTER_OP_LOAD_STRING:
+		case FILTER_OP_LOAD_STAR_GLOB_STRING:
+			if (top + 1 >= INTERPRETER_STACK_LEN) {
+				goto end;
+			}
+			top++;
+			stack[top].type = op == FILTER_OP_LOAD_STRING ?
+				VALUE_STRING_LITERAL : VALUE_STAR_GLOB_STRING;
+			stack[top].u.str = load->data;
+			pc += sizeof(struct load_op) + strlen(load->data) + 1;
+			break;
+
+		case FILTER_OP_LOAD_S64:
+		{
+			struct literal_numeric literal;
+
+			if (top + 1 >= INTERPRETER_STACK_LEN) {
+				goto end;
+			}
+			memcpy(&literal, load->data, sizeof(literal));
+			top++;
+			stack[top].type = VALUE_S64;
+			stack[top].u.s64 = literal.v;
+			pc += sizeof(struct load_op) + sizeof(literal);
+			break;
+		}
+
+		case FILTER_OP_LOAD_DOUBLE:
+		{
+			struct literal_double literal;
+
+			if (top + 1 >= INTERPRETER_STACK_LEN) {
+				goto end;
+			}
+			memcpy(&literal, load->data, sizeof(literal));
+			top++;
+			stack[top].type = VALUE_DOUBLE;
+			stack[top].u.d = literal.v;
+			pc += sizeof(struct load_op) + sizeof(literal);
+			break;
+		}
+
+		case FILTER_OP_CAST_TO_S64:
+		case FILTER_OP_CAST_DOUBLE_TO_S64:
+			if (top < 0) {
+				goto end;
+			}
+			if (stack[top].type == VALUE_DOUBLE) {
+				stack[top].type = VALUE_S64;
+				stack[top].u.s64 = (int64_t) stack[top].u.d;
+			} else if (stack[top].type != VALUE_S64) {
+				goto end;
+			}
+			pc += sizeof(struct cast_op);
+			break;
+
+		case FILTER_OP_CAST_NOP:
+			pc += sizeof(struct cast_op);
+			break;
+
+		default:
+			diag("Unsupported filter op %u at offset %" PRIu32,
+					(unsigned int) op, pc);
+			goto end;
+		}
+	}
+
+end:
+	*nr_ops += ops;
+	return ret;
+}
+
+static void generate_events(void)
+{
+	uint64_t state = 0x9e3779b97f4a7c15ULL;
+	unsigned int i;
+
+	for (i = 0; i < NR_EVENTS; i++) {
+		struct bench_event *ev = &bench_events[i];
+
+		/* xorshift64 */
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+
+		ev->intfield = (int64_t) (state % 48);
+		ev->longfield = (int64_t) (state >> 16) - (1LL << 46);
+		ev->floatfield = (double) ((state >> 8) % 400) / 100.0;
+		ev->stringfield = bench_strings[(state >> 24) %
+			(sizeof(bench_strings) / sizeof(bench_strings[0]))];
+		ev->vpid = ((state >> 32) & 1) ? 1000 : 2000;
+		ev->procname = bench_procnames[(state >> 40) %
+			(sizeof(bench_procnames) / sizeof(bench_procnames[0]))];
+	}
+}
+
+static uint64_t elapsed_ns(const struct timespec *begin,
+		const struct timespec *end)
+{
+	return (uint64_t) (end->tv_sec - begin->tv_sec) * 1000000000ULL
+		+ end->tv_nsec - begin->tv_nsec;
+}
+
+static void run_case(const struct filter_case *fcase, unsigned long nr_iter,
+		double max_ns)
+{
+	struct filter_parser_ctx *ctx;
+	struct lttng_filter_bytecode *bytecode;
+	char *insns = NULL;
+	unsigned long nr_ops = 0, nr_errors = 0, nr_mismatches = 0;
+	unsigned long i, j;
+	struct timespec begin, end;
+	double ns_per_event;
+
+	ctx = compile_filter(fcase->expression);
+	ok(ctx != NULL, "Compile filter `%s`", fcase->expression);
+	if (!ctx) {
+		skip(NR_TESTS_PER_CASE - 1 + (max_ns > 0),
+				"Filter does not compile");
+		return;
+	}
+	bytecode = &ctx->bytecode->b;
+	ok(bytecode_get_len(bytecode) <= fcase->max_len,
+			"Bytecode of `%s` is %u bytes (budget: %" PRIu32 ")",
+			fcase->expression, bytecode_get_len(bytecode),
+			fcase->max_len);
+
+	insns = link_bytecode(bytecode);
+	if (!insns) {
+		fail("Link bytecode of `%s`", fcase->expression);
+		if (max_ns > 0) {
+			skip(1, "Bytecode cannot be linked");
+		}
+		goto end;
+	}
+
+	/* Validation pass, also used to count the ops. */
+	for (i = 0; i < NR_EVENTS; i++) {
+		bool record = false;
+
+		if (interpret(insns, bytecode->reloc_table_offset,
+				&bench_events[i], &record, &nr_ops)) {
+			nr_errors++;
+			continue;
+		}
+		if (record != fcase->expected(&bench_events[i])) {
+			nr_mismatches++;
+		}
+	}
+	ok(nr_errors == 0 && nr_mismatches == 0,
+			"Bytecode of `%s` matches the expected result (%lu errors, %lu mismatches)",
+			fcase->expression, nr_errors, nr_mismatches);
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (j = 0; j < nr_iter; j++) {
+		for (i = 0; i < NR_EVENTS; i++) {
+			bool record;
+			unsigned long ops = 0;
+
+			(void) interpret(insns, bytecode->reloc_table_offset,
+					&bench_events[i], &record, &ops);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ns_per_event = (double) elapsed_ns(&begin, &end) /
+			(double) (nr_iter * NR_EVENTS);
+
+	diag("%-50s %4u bytes %6.2f ops/event %8.1f ns/event",
+			fcase->expression, bytecode_get_len(bytecode),
+			(double) nr_ops / NR_EVENTS, ns_per_event);
+	if (max_ns > 0) {
+		ok(ns_per_event <= max_ns,
+				"Evaluation of `%s` takes %.1f ns/event (budget: %.1f)",
+				fcase->expression, ns_per_event, max_ns);
+	}
+end:
+	free(insns);
+	free_filter(ctx);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long nr_iter = DEFAULT_NR_ITER;
+	double max_ns = 0;
+	const char *env;
+	unsigned int i;
+
+	env = getenv("FILTER_BENCH_ITER");
+	if (env) {
+		nr_iter = strtoul(env, NULL, 10);
+		if (!nr_iter) {
+			nr_iter = DEFAULT_NR_ITER;
+		}
+	}
+	env = getenv("FILTER_BENCH_MAX_NS");
+	if (env) {
+		max_ns = strtod(env, NULL);
+	}
+
+	plan_tests(NR_FILTER_CASES * (NR_TESTS_PER_CASE + (max_ns > 0)));
+
+	diag("Filter bytecode benchmark: %d events, %lu iterations",
+			NR_EVENTS, nr_iter);
+	generate_events();
+	for (i = 0; i < NR_FILTER_CASES; i++) {
+		run_case(&filter_cases[i], nr_iter, max_ns);
+	}
+
+	return exit_status();
+}
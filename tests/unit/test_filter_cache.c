@@ -0,0 +1,127 @@
+/*
+ * test_filter_cache.c
+ *
+ * Unit tests for the filter bytecode cache of liblttng-ctl.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by as
+ * published by the Free Software Foundation; only version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <tap/tap.h>
+
+#include <common/common.h>
+#include <common/sessiond-comm/sessiond-comm.h>
+#include <lib/lttng-ctl/filter-cache.h>
+
+/* For error.h */
+int lttng_opt_quiet = 1;
+int lttng_opt_verbose;
+int lttng_opt_mi;
+
+struct normalize_test {
+	const char *input;
+	const char *expected;
+};
+
+static const struct normalize_test normalize_tests[] = {
+	{ "a == 1", "a==1" },
+	{ "  a\t==\n1  ", "a==1" },
+	{ "$ctx.procname == \"my app\"", "$ctx.procname==\"my app\"" },
+	/* White space within string literals is significant. */
+	{ "name == \"a  b \"", "name==\"a  b \"" },
+	{ "name == 'a  b '", "name=='a  b '" },
+	/* Operators must not be merged into a different one. */
+	{ "a - -1", "a- -1" },
+	{ "a--1", "a--1" },
+	{ "a & &b", "a& &b" },
+	{ "a && b", "a&&b" },
+	/* Escaped quotes don't end a string literal. */
+	{ "msg == \"say \\\"hi  there\\\"  now\"",
+		"msg==\"say \\\"hi  there\\\"  now\"" },
+	{ "msg == \"back\\\\\" && b == 1", "msg==\"back\\\\\"&&b==1" },
+	{ "msg == 'it\\'s  ok' || c", "msg=='it\\'s  ok'||c" },
+};
+
+#define NUM_NORMALIZE_TESTS \
+	(sizeof(normalize_tests) / sizeof(normalize_tests[0]))
+#define NUM_TESTS (NUM_NORMALIZE_TESTS + 5)
+
+static void test_normalize(void)
+{
+	size_t i;
+
+	for (i = 0; i < NUM_NORMALIZE_TESTS; i++) {
+		char *normalized;
+
+		normalized = filter_cache_normalize_expression(
+				normalize_tests[i].input);
+		ok(normalized && !strcmp(normalized,
+				normalize_tests[i].expected),
+				"Normalize '%s' to '%s' (got '%s')",
+				normalize_tests[i].input,
+				normalize_tests[i].expected,
+				normalized ? normalized : "(null)");
+		free(normalized);
+	}
+}
+
+static void test_lookup(void)
+{
+	const char data[] = "bytecode";
+	struct lttng_filter_bytecode *bytecode, *cached;
+
+	bytecode = zmalloc(sizeof(*bytecode) + sizeof(data));
+	if (!bytecode) {
+		skip(5, "Bytecode allocation failed");
+		return;
+	}
+	bytecode->len = sizeof(data);
+	memcpy(bytecode->data, data, sizeof(data));
+
+	ok(!filter_cache_lookup("x - -1"), "Expression not cached yet");
+
+	filter_cache_add("x - -1", bytecode);
+	cached = filter_cache_lookup("x- -1");
+	ok(cached && cached != bytecode &&
+			!memcmp(cached, bytecode,
+				sizeof(*bytecode) + sizeof(data)),
+			"Copy of the bytecode found for an equivalent expression");
+	free(cached);
+
+	cached = filter_cache_lookup("x--1");
+	ok(!cached, "Bytecode not found for a different expression");
+	free(cached);
+
+	cached = filter_cache_lookup("x == \"- -1\"");
+	ok(!cached, "Bytecode not found for a string literal");
+	free(cached);
+
+	/* Adding an expression twice keeps the first bytecode. */
+	bytecode->data[0] = 'B';
+	filter_cache_add("x-  -1", bytecode);
+	cached = filter_cache_lookup("x - -1");
+	ok(cached && cached->data[0] == 'b',
+			"Bytecode of an expression is only cached once");
+	free(cached);
+	free(bytecode);
+}
+
+int main(void)
+{
+	plan_tests(NUM_TESTS);
+
+	diag("Filter bytecode cache unit tests");
+
+	test_normalize();
+	test_lookup();
+	return exit_status();
+}
@@ -0,0 +1,306 @@
+/*
+ * test_filter_fold_constants.c
+ *
+ * Unit tests for the constant folding pass of the filter compiler.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by as
+ * published by the Free Software Foundation; only version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <tap/tap.h>
+
+#include <common/common.h>
+
+#include "filter-ast.h"
+#include "filter-bytecode.h"
+#include "filter-ir.h"
+#include "memstream.h"
+
+/* For error.h */
+int lttng_opt_quiet = 1;
+int lttng_opt_verbose;
+int lttng_opt_mi;
+
+#define STACK_LEN	16
+
+struct fold_test {
+	const char *expression;
+	/* Value the tracer returns for this expression. */
+	int64_t expected;
+};
+
+/*
+ * The left operand of each logical operator is a constant other than 0
+ * or 1, so the value of a short-circuited operator shows up in the
+ * result. The field references are never evaluated.
+ */
+static const struct fold_test fold_tests[] = {
+	{ "(2 || intfield) == 2", 0 },
+	{ "(2 || intfield) == 1", 1 },
+	{ "(4 || intfield) & 4", 0 },
+	{ "!(-3 || intfield)", 0 },
+	{ "(0 && intfield) == 0", 1 },
+	{ "(3 && 5) == 5", 1 },
+	{ "(0 || 6) == 6", 1 },
+	{ "(7 && 0) | 8", 8 },
+};
+
+#define NUM_FOLD_TESTS	(sizeof(fold_tests) / sizeof(fold_tests[0]))
+#define NUM_TESTS	(NUM_FOLD_TESTS * 2)
+
+static struct filter_parser_ctx *compile_filter(const char *expression,
+		bool fold)
+{
+	int ret;
+	struct filter_parser_ctx *ctx = NULL;
+	FILE *fmem;
+
+	fmem = lttng_fmemopen((void *) expression, strlen(expression), "r");
+	if (!fmem) {
+		return NULL;
+	}
+	ctx = filter_parser_ctx_alloc(fmem);
+	if (!ctx) {
+		goto end;
+	}
+	ret = filter_parser_ctx_append_ast(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_generate(ctx);
+	if (ret) {
+		goto error;
+	}
+	ret = filter_visitor_ir_check_binary_op_nesting(ctx);
+	if (ret) {
+		goto error;
+	}
+	if (fold) {
+		ret = filter_visitor_ir_fold_constants(ctx);
+		if (ret) {
+			goto error;
+		}
+	}
+	ret = filter_visitor_bytecode_generate(ctx);
+	if (ret) {
+		goto error;
+	}
+	goto end;
+
+error:
+	filter_ir_free(ctx);
+	filter_parser_ctx_free(ctx);
+	ctx = NULL;
+end:
+	fclose(fmem);
+	return ctx;
+}
+
+static void free_filter(struct filter_parser_ctx *ctx)
+{
+	filter_bytecode_free(ctx);
+	filter_ir_free(ctx);
+	filter_parser_ctx_free(ctx);
+}
+
+/*
+ * Run integer-only bytecode the way the tracer does and return the value
+ * left on the stack. Loading a field is an error: every field reference
+ * of the tests must be skipped by a short-circuited logical operator.
+ */
+static int evaluate(const struct lttng_filter_bytecode *bytecode,
+		int64_t *result)
+{
+	const char *insns = bytecode->data;
+	uint32_t len = bytecode->reloc_table_offset;
+	int64_t stack[STACK_LEN];
+	int top = -1;
+	uint32_t pc = 0;
+
+	while (pc < len) {
+		filter_opcode_t op = (filter_opcode_t) insns[pc];
+
+		switch (op) {
+		case FILTER_OP_RETURN:
+			if (top < 0) {
+				return -1;
+			}
+			*result = stack[top];
+			return 0;
+
+		case FILTER_OP_EQ:
+		case FILTER_OP_NE:
+		case FILTER_OP_GT:
+		case FILTER_OP_LT:
+		case FILTER_OP_GE:
+		case FILTER_OP_LE:
+		case FILTER_OP_BIT_AND:
+		case FILTER_OP_BIT_OR:
+		case FILTER_OP_BIT_XOR:
+		{
+			int64_t l, r;
+
+			if (top < 1) {
+				return -1;
+			}
+			l = stack[top - 1];
+			r = stack[top];
+			top--;
+			switch (op) {
+			case FILTER_OP_EQ:
+				stack[top] = l == r;
+				break;
+			case FILTER_OP_NE:
+				stack[top] = l != r;
+				break;
+			case FILTER_OP_GT:
+				stack[top] = l > r;
+				break;
+			case FILTER_OP_LT:
+				stack[top] = l < r;
+				break;
+			case FILTER_OP_GE:
+				stack[top] = l >= r;
+				break;
+			case FILTER_OP_LE:
+				stack[top] = l <= r;
+				break;
+			case FILTER_OP_BIT_AND:
+				stack[top] = l & r;
+				break;
+			case FILTER_OP_BIT_OR:
+				stack[top] = l | r;
+				break;
+			default:
+				stack[top] = l ^ r;
+				break;
+			}
+			pc += sizeof(struct binary_op);
+			break;
+		}
+
+		case FILTER_OP_UNARY_PLUS:
+		case FILTER_OP_UNARY_MINUS:
+		case FILTER_OP_UNARY_NOT:
+		case FILTER_OP_UNARY_BIT_NOT:
+			if (top < 0) {
+				return -1;
+			}
+			if (op == FILTER_OP_UNARY_MINUS) {
+				stack[top] = (int64_t) -(uint64_t) stack[top];
+			} else if (op == FILTER_OP_UNARY_NOT) {
+				stack[top] = !stack[top];
+			} else if (op == FILTER_OP_UNARY_BIT_NOT) {
+				stack[top] = (int64_t) ~(uint64_t) stack[top];
+			}
+			pc += sizeof(struct unary_op);
+			break;
+
+		case FILTER_OP_AND:
+		case FILTER_OP_OR:
+		{
+			struct logical_op insn;
+
+			if (top < 0) {
+				return -1;
+			}
+			memcpy(&insn, &insns[pc], sizeof(insn));
+			if (op == FILTER_OP_AND && stack[top] == 0) {
+				pc = insn.skip_offset;
+			} else if (op == FILTER_OP_OR && stack[top] != 0) {
+				stack[top] = 1;
+				pc = insn.skip_offset;
+			} else {
+				top--;
+				pc += sizeof(struct logical_op);
+			}
+			break;
+		}
+
+		case FILTER_OP_LOAD_S64:
+		{
+			struct literal_numeric literal;
+
+			if (top + 1 >= STACK_LEN) {
+				return -1;
+			}
+			memcpy(&literal, &insns[pc + sizeof(struct load_op)],
+					sizeof(literal));
+			stack[++top] = literal.v;
+			pc += sizeof(struct load_op) + sizeof(literal);
+			break;
+		}
+
+		case FILTER_OP_CAST_TO_S64:
+		case FILTER_OP_CAST_NOP:
+			pc += sizeof(struct cast_op);
+			break;
+
+		default:
+			diag("Unexpected filter op %u at offset %" PRIu32,
+					(unsigned int) op, pc);
+			return -1;
+		}
+	}
+	return -1;
+}
+
+static void test_fold(const struct fold_test *test)
+{
+	struct filter_parser_ctx *folded, *unfolded;
+	int64_t folded_result = 0, unfolded_result = 0;
+	int ret_folded, ret_unfolded;
+
+	folded = compile_filter(test->expression, true);
+	unfolded = compile_filter(test->expression, false);
+	if (!folded || !unfolded) {
+		fail("Compile filter `%s`", test->expression);
+		skip(1, "Filter does not compile");
+		goto end;
+	}
+
+	ok(folded->ir_root->u.root.child->op == IR_OP_LOAD,
+			"Fold `%s` to a constant", test->expression);
+
+	ret_folded = evaluate(&folded->bytecode->b, &folded_result);
+	ret_unfolded = evaluate(&unfolded->bytecode->b, &unfolded_result);
+	ok(!ret_folded && !ret_unfolded &&
+			folded_result == unfolded_result &&
+			folded_result == test->expected,
+			"Folded `%s` evaluates to %" PRId64 " (unfolded: %" PRId64
+			", expected: %" PRId64 ")", test->expression,
+			folded_result, unfolded_result, test->expected);
+end:
+	if (folded) {
+		free_filter(folded);
+	}
+	if (unfolded) {
+		free_filter(unfolded);
+	}
+}
+
+int main(void)
+{
+	size_t i;
+
+	plan_tests(NUM_TESTS);
+
+	diag("Filter constant folding unit tests");
+
+	for (i = 0; i < NUM_FOLD_TESTS; i++) {
+		test_fold(&fold_tests[i]);
+	}
+	return exit_status();
+}
@@ -0,0 +1,250 @@
+/*
+ * test_index.c
+ *
+ * Unit tests for the timestamp lookup of index files.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by as
+ * published by the Free Software Foundation; only version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <tap/tap.h>
+
+#include <bin/lttng-relayd/tracefile-array.h>
+#include <common/common.h>
+#include <common/compat/endian.h>
+#include <common/defaults.h>
+#include <common/index/index.h>
+#include <common/utils.h>
+
+/* For error.h */
+int lttng_opt_quiet = 1;
+int lttng_opt_verbose;
+int lttng_opt_mi;
+
+#define STREAM_NAME		"chan_0"
+#define TRACEFILE_COUNT		3
+#define PACKETS_PER_FILE	4
+/*
+ * Enough packets to overwrite the first two trace files: the oldest packets
+ * on disk are in the last trace file and the newest in the second one.
+ */
+#define NR_PACKETS		18
+
+#define NUM_TESTS 19
+
+static char trace_dir[] = "/tmp/test_index_XXXXXX";
+
+/* Packet "seq" spans ]10 * seq, 10 * (seq + 1)]. */
+static uint64_t packet_end(uint64_t seq)
+{
+	return 10 * (seq + 1);
+}
+
+static int write_packet_index(struct lttng_index_file *index_file,
+		uint64_t seq)
+{
+	struct ctf_packet_index index;
+
+	memset(&index, 0, sizeof(index));
+	index.offset = htobe64(seq * 4096);
+	index.packet_size = htobe64(4096 * CHAR_BIT);
+	index.content_size = htobe64(4096 * CHAR_BIT);
+	index.timestamp_begin = htobe64(packet_end(seq) - 9);
+	index.timestamp_end = htobe64(packet_end(seq));
+	return lttng_index_file_write(index_file, &index);
+}
+
+static struct lttng_index_file *create_index_file(uint64_t file_index)
+{
+	/* Any non-zero tracefile size selects the per-file naming. */
+	return lttng_index_file_create(trace_dir, STREAM_NAME, -1, -1, 1,
+			file_index, CTF_INDEX_MAJOR, CTF_INDEX_MINOR);
+}
+
+/*
+ * Find the sequence number of the first packet ending at or after
+ * "timestamp" by walking the trace files from the oldest to the newest, as a
+ * live viewer seek does. Return -1ULL when every packet ends before it.
+ */
+static uint64_t find_timestamp_seq(struct tracefile_array *tfa,
+		uint64_t timestamp)
+{
+	uint64_t i, file_index, seq = -1ULL;
+
+	file_index = tracefile_array_get_file_index_tail(tfa);
+	for (i = 0; i < TRACEFILE_COUNT; i++,
+			file_index = (file_index + 1) % TRACEFILE_COUNT) {
+		struct lttng_index_file *index_file;
+		uint64_t seq_head, seq_tail, pos;
+		int ret;
+
+		seq_head = tracefile_array_get_file_seq_head(tfa, file_index);
+		seq_tail = tracefile_array_get_file_seq_tail(tfa, file_index);
+		if (seq_head == -1ULL || seq_tail == -1ULL) {
+			continue;
+		}
+
+		index_file = lttng_index_file_open(trace_dir, STREAM_NAME,
+				TRACEFILE_COUNT, file_index);
+		if (!index_file) {
+			break;
+		}
+		ret = lttng_index_file_find_timestamp(index_file,
+				seq_head - seq_tail + 1, timestamp, &pos);
+		lttng_index_file_put(index_file);
+		if (ret) {
+			break;
+		}
+		if (pos <= seq_head - seq_tail) {
+			seq = seq_tail + pos;
+			break;
+		}
+	}
+	return seq;
+}
+
+static void test_find_timestamp_single_file(void)
+{
+	int ret;
+	uint64_t seq, pos;
+	struct lttng_index_file *index_file;
+
+	index_file = create_index_file(0);
+	assert(index_file);
+	for (seq = 0; seq < PACKETS_PER_FILE; seq++) {
+		ret = write_packet_index(index_file, seq);
+		assert(!ret);
+	}
+	lttng_index_file_put(index_file);
+
+	index_file = lttng_index_file_open(trace_dir, STREAM_NAME,
+			TRACEFILE_COUNT, 0);
+	ok(index_file, "Open index file");
+	if (!index_file) {
+		skip(5, "No index file to search");
+		return;
+	}
+
+	ret = lttng_index_file_find_timestamp(index_file, 0, 0, &pos);
+	ok(!ret && pos == 0, "Empty index file yields position 0");
+	ret = lttng_index_file_find_timestamp(index_file, PACKETS_PER_FILE,
+			0, &pos);
+	ok(!ret && pos == 0, "Timestamp before the first packet yields the first packet");
+	ret = lttng_index_file_find_timestamp(index_file, PACKETS_PER_FILE,
+			packet_end(2), &pos);
+	ok(!ret && pos == 2, "End timestamp of a packet yields that packet");
+	ret = lttng_index_file_find_timestamp(index_file, PACKETS_PER_FILE,
+			packet_end(2) + 1, &pos);
+	ok(!ret && pos == 3, "Timestamp past the end of a packet yields the next packet");
+	ret = lttng_index_file_find_timestamp(index_file, PACKETS_PER_FILE,
+			packet_end(PACKETS_PER_FILE - 1) + 1, &pos);
+	ok(!ret && pos == PACKETS_PER_FILE,
+			"Timestamp past the last packet yields the entry count");
+	lttng_index_file_put(index_file);
+}
+
+static void test_find_timestamp_wrap_around(void)
+{
+	int ret;
+	uint64_t seq;
+	unsigned int i;
+	struct tracefile_array *tfa;
+	struct lttng_index_file *index_file;
+	const struct {
+		uint64_t timestamp;
+		uint64_t seq;
+	} tests[] = {
+		/* Packets 0 to 7 were overwritten; packet 8 is the oldest. */
+		{ 0, 8 },
+		{ packet_end(4), 8 },
+		{ packet_end(8), 8 },
+		{ packet_end(8) + 1, 9 },
+		{ packet_end(10) - 5, 10 },
+		{ packet_end(11), 11 },
+		/* Across the wrap-around, in the first trace file. */
+		{ packet_end(11) + 1, 12 },
+		{ packet_end(13), 13 },
+		{ packet_end(15), 15 },
+		/* Across the next trace file. */
+		{ packet_end(15) + 1, 16 },
+		{ packet_end(17), 17 },
+		{ packet_end(17) + 1, -1ULL },
+	};
+
+	tfa = tracefile_array_create(TRACEFILE_COUNT);
+	assert(tfa);
+	index_file = create_index_file(0);
+	assert(index_file);
+	for (seq = 0; seq < NR_PACKETS; seq++) {
+		if (seq && !(seq % PACKETS_PER_FILE)) {
+			tracefile_array_file_rotate(tfa);
+			lttng_index_file_put(index_file);
+			index_file = create_index_file(
+					tracefile_array_get_file_index_head(tfa));
+			assert(index_file);
+		}
+		ret = write_packet_index(index_file, seq);
+		assert(!ret);
+		tracefile_array_commit_seq(tfa);
+	}
+	lttng_index_file_put(index_file);
+
+	ok(tracefile_array_get_file_index_tail(tfa) == 2 &&
+			tracefile_array_get_file_index_head(tfa) == 1 &&
+			tracefile_array_get_seq_tail(tfa) == 8,
+			"Trace files wrapped around");
+
+	for (i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		seq = find_timestamp_seq(tfa, tests[i].timestamp);
+		ok(seq == tests[i].seq,
+				"Timestamp %" PRIu64 " found in packet %" PRId64
+				" (expected %" PRId64 ")", tests[i].timestamp,
+				(int64_t) seq, (int64_t) tests[i].seq);
+	}
+	tracefile_array_destroy(tfa);
+}
+
+static void cleanup(void)
+{
+	int i;
+	char path[PATH_MAX];
+
+	for (i = 0; i < TRACEFILE_COUNT; i++) {
+		snprintf(path, sizeof(path), "%s/" DEFAULT_INDEX_DIR "/%s_%d"
+				DEFAULT_INDEX_FILE_SUFFIX, trace_dir,
+				STREAM_NAME, i);
+		(void) unlink(path);
+	}
+	(void) utils_recursive_rmdir(trace_dir);
+}
+
+int main(void)
+{
+	plan_tests(NUM_TESTS);
+
+	diag("Index file timestamp lookup unit tests");
+
+	if (!mkdtemp(trace_dir)) {
+		diag("Failed to create temporary directory");
+		return EXIT_FAILURE;
+	}
+
+	test_find_timestamp_single_file();
+	test_find_timestamp_wrap_around();
+	cleanup();
+	return exit_status();
+}